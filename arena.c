@@ -0,0 +1,246 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the arena allocator used for storing
+// the data of a server
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "arena.h"
+
+// the chunk header is rounded up, so the blocks stay aligned to 16 bytes
+#define ARENA_HEADER_SIZE ((sizeof(arena_chunk) + 15) & ~(size_t)15)
+
+// function which initialises the arena and returns it
+arena* create_arena() {
+	arena* pool = calloc(1, sizeof(arena));
+	DIE(pool == NULL, "Error");
+
+	pool->next_chunk_size = ARENA_MIN_CHUNK;
+
+	return pool;
+}
+
+// function which returns the size class of a block with the given size
+unsigned int arena_size_class(size_t size) {
+	if (size <= 64)
+		return size <= 16 ? 0 : (size + 15) / 16 - 1;
+
+	// find k such that 2^k < size <= 2^(k + 1); the classes between
+	// the two powers of 2 are 2^k + i * 2^(k - 2), with i from 1 to 4
+	unsigned int k = 63 - __builtin_clzll(size - 1);
+	size_t step = (size_t)1 << (k - 2);
+	unsigned int i = (size - ((size_t)1 << k) + step - 1) / step;
+
+	return 4 + (k - 6) * 4 + (i - 1);
+}
+
+// function which returns the size of the blocks of a size class
+size_t arena_class_size(unsigned int size_class) {
+	if (size_class < 4)
+		return 16 * (size_class + 1);
+
+	unsigned int k = (size_class - 4) / 4 + 6;
+	unsigned int i = (size_class - 4) % 4 + 1;
+
+	return ((size_t)1 << k) + i * ((size_t)1 << (k - 2));
+}
+
+// function which maps a new chunk of the given size and links it
+// at the beginning of a list of chunks
+arena_chunk* arena_map_chunk(arena* pool, arena_chunk** list, size_t size) {
+	arena_chunk* chunk = mmap(NULL, size, PROT_READ | PROT_WRITE,
+							  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	DIE(chunk == MAP_FAILED, "mmap");
+
+	chunk->size = size;
+	chunk->prev = NULL;
+	chunk->next = *list;
+	if (*list != NULL)
+		(*list)->prev = chunk;
+	*list = chunk;
+	pool->bytes_reserved += size;
+
+	return chunk;
+}
+
+// function which allocates a block from the arena
+void* arena_alloc(arena* pool, size_t size) {
+	// blocks larger than the greatest class get a chunk of their own
+	if (size > ARENA_MAX_CLASS_SIZE) {
+		arena_chunk* chunk = arena_map_chunk(pool, &pool->large_chunks,
+											 ARENA_HEADER_SIZE + size);
+		pool->bytes_allocated += size;
+		return (char*)chunk + ARENA_HEADER_SIZE;
+	}
+
+	unsigned int size_class = arena_size_class(size);
+	size_t class_size = arena_class_size(size_class);
+	pool->bytes_allocated += class_size;
+
+	// reuse a freed block of the same class, if there is one
+	arena_free_block* block = pool->free_lists[size_class];
+	if (block != NULL) {
+		pool->free_lists[size_class] = block->next;
+		return block;
+	}
+
+	// if the block doesn't fit in the current chunk, map a new one;
+	// the space left at the end of the current chunk is not used
+	if (pool->bump == NULL || (size_t)(pool->end - pool->bump) < class_size) {
+		while (pool->next_chunk_size < ARENA_HEADER_SIZE + class_size)
+			pool->next_chunk_size *= 2;
+
+		arena_chunk* chunk = arena_map_chunk(pool, &pool->chunks,
+											 pool->next_chunk_size);
+		pool->bump = (char*)chunk + ARENA_HEADER_SIZE;
+		pool->end = (char*)chunk + chunk->size;
+
+		if (pool->next_chunk_size < ARENA_MAX_CHUNK)
+			pool->next_chunk_size *= 2;
+	}
+
+	void* new_block = pool->bump;
+	pool->bump += class_size;
+
+	return new_block;
+}
+
+// function which unlinks the chunk of a large block from the list of
+// large chunks of its arena and returns it
+arena_chunk* arena_unlink_large(arena* pool, void* block) {
+	arena_chunk* chunk = (arena_chunk*)((char*)block - ARENA_HEADER_SIZE);
+	if (chunk->prev != NULL)
+		chunk->prev->next = chunk->next;
+	else
+		pool->large_chunks = chunk->next;
+	if (chunk->next != NULL)
+		chunk->next->prev = chunk->prev;
+
+	return chunk;
+}
+
+// function which gives a block back to the arena
+void arena_free(arena* pool, void* block, size_t size) {
+	if (block == NULL)
+		return;
+
+	// the chunk of a large block is unlinked and unmapped
+	if (size > ARENA_MAX_CLASS_SIZE) {
+		arena_chunk* chunk = arena_unlink_large(pool, block);
+		pool->bytes_allocated -= size;
+		pool->bytes_reserved -= chunk->size;
+		munmap(chunk, chunk->size);
+		return;
+	}
+
+	// add the block at the beginning of its class' free list
+	unsigned int size_class = arena_size_class(size);
+	arena_free_block* free_block = block;
+	free_block->next = pool->free_lists[size_class];
+	pool->free_lists[size_class] = free_block;
+	pool->bytes_allocated -= arena_class_size(size_class);
+}
+
+// function which changes the size of a block
+void* arena_realloc(arena* pool, void* block, size_t old_size,
+					size_t new_size) {
+	// the block can be kept if the new size has the same class
+	if (old_size <= ARENA_MAX_CLASS_SIZE && new_size <= ARENA_MAX_CLASS_SIZE &&
+		arena_size_class(old_size) == arena_size_class(new_size))
+		return block;
+
+	void* new_block = arena_alloc(pool, new_size);
+	memcpy(new_block, block, old_size < new_size ? old_size : new_size);
+	arena_free(pool, block, old_size);
+
+	return new_block;
+}
+
+// function which allocates a block and copies the given data in it
+void* arena_copy(arena* pool, const void* data, size_t size) {
+	void* block = arena_alloc(pool, size);
+	memcpy(block, data, size);
+
+	return block;
+}
+
+// function which moves the accounting of a block between arenas; a
+// large block has a chunk of its own, so its chunk moves with it
+void arena_transfer(arena* from, arena* to, void* block, size_t size) {
+	size_t block_size = size;
+
+	if (size <= ARENA_MAX_CLASS_SIZE) {
+		block_size = arena_class_size(arena_size_class(size));
+	} else {
+		arena_chunk* chunk = arena_unlink_large(from, block);
+		chunk->prev = NULL;
+		chunk->next = to->large_chunks;
+		if (to->large_chunks != NULL)
+			to->large_chunks->prev = chunk;
+		to->large_chunks = chunk;
+
+		from->bytes_reserved -= chunk->size;
+		to->bytes_reserved += chunk->size;
+	}
+
+	from->bytes_allocated -= block_size;
+	to->bytes_allocated += block_size;
+}
+
+// function which adds a list of chunks at the beginning of another list
+void arena_splice_chunks(arena_chunk** to, arena_chunk* from) {
+	if (from == NULL)
+		return;
+
+	arena_chunk* last = from;
+	while (last->next != NULL)
+		last = last->next;
+
+	last->next = *to;
+	if (*to != NULL)
+		(*to)->prev = last;
+	*to = from;
+}
+
+// function which moves all the chunks and free blocks of an arena
+// into another arena
+void arena_adopt(arena* to, arena* from) {
+	arena_splice_chunks(&to->chunks, from->chunks);
+	arena_splice_chunks(&to->large_chunks, from->large_chunks);
+
+	// the free blocks of each class are added to the receiving free list
+	for (int i = 0; i < ARENA_CLASSES; i++) {
+		arena_free_block* block = from->free_lists[i];
+		while (block != NULL) {
+			arena_free_block* next = block->next;
+			block->next = to->free_lists[i];
+			to->free_lists[i] = block;
+			block = next;
+		}
+	}
+
+	to->bytes_reserved += from->bytes_reserved;
+	to->bytes_allocated += from->bytes_allocated;
+
+	// the space left in the current chunk of the moved arena is not used
+	memset(from, 0, sizeof(arena));
+	from->next_chunk_size = ARENA_MIN_CHUNK;
+}
+
+// function which unmaps all the chunks of a list
+void arena_unmap_chunks(arena_chunk* chunk) {
+	while (chunk != NULL) {
+		arena_chunk* next = chunk->next;
+		munmap(chunk, chunk->size);
+		chunk = next;
+	}
+}
+
+// function which frees all the memory of the arena; the blocks are not
+// visited, only the chunks are unmapped
+void free_arena(arena* pool) {
+	arena_unmap_chunks(pool->chunks);
+	arena_unmap_chunks(pool->large_chunks);
+	free(pool);
+}
@@ -0,0 +1,115 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the arena allocator
+// used for storing the data of a server
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+
+#include "utils.h"
+
+// size of the first chunk of an arena; each new chunk is twice as large
+// as the previous one, until reaching ARENA_MAX_CHUNK bytes
+#define ARENA_MIN_CHUNK (64 * 1024)
+#define ARENA_MAX_CHUNK (64 * 1024 * 1024)
+
+// number of size classes; the classes are 16, 32, 48 and 64 bytes, then
+// four classes between each two consecutive powers of 2, up to 128 KB
+#define ARENA_CLASSES 48
+#define ARENA_MAX_CLASS_SIZE (128 * 1024)
+
+// memory region obtained with mmap; the blocks of an arena are
+// bump-allocated from its chunks
+typedef struct arena_chunk arena_chunk;
+struct arena_chunk {
+	arena_chunk* next;
+	arena_chunk* prev;
+	// size of the chunk, including this header
+	size_t size;
+};
+
+// block which was freed; it is reused by the next allocation of its class
+typedef struct arena_free_block arena_free_block;
+struct arena_free_block {
+	arena_free_block* next;
+};
+
+// arena allocator: blocks are bump-allocated from large chunks and the
+// freed blocks are kept on a free list for each size class; freeing the
+// arena unmaps its chunks, without visiting the blocks
+typedef struct arena arena;
+struct arena {
+	// chunks used for the size classes
+	arena_chunk* chunks;
+	// blocks larger than the greatest size class, each one with its chunk
+	arena_chunk* large_chunks;
+	// bump pointer and end of the free space of the current chunk
+	char* bump;
+	char* end;
+	// size of the next chunk which will be allocated
+	size_t next_chunk_size;
+	arena_free_block* free_lists[ARENA_CLASSES];
+	// bytes obtained with mmap
+	size_t bytes_reserved;
+	// bytes of the blocks which are in use
+	size_t bytes_allocated;
+};
+
+// function which initialises and returns an empty arena
+arena* create_arena();
+
+// arena_alloc() - Allocates a block from the arena.
+// @arg1: Arena from which the block is allocated.
+// @arg2: Size of the block.
+//
+// Return: Pointer to the block (aligned to 16 bytes).
+void* arena_alloc(arena* pool, size_t size);
+
+// arena_free() - Gives a block back to the arena.
+// @arg1: Arena from which the block was allocated.
+// @arg2: Pointer to the block.
+// @arg3: Size with which the block was allocated.
+void arena_free(arena* pool, void* block, size_t size);
+
+// arena_realloc() - Changes the size of a block; the block is kept if
+// the new size is in the same size class.
+// @arg1: Arena from which the block was allocated.
+// @arg2: Pointer to the block.
+// @arg3: Size with which the block was allocated.
+// @arg4: New size of the block.
+//
+// Return: Pointer to the block, whose content is kept up to the smaller
+//         of the two sizes.
+void* arena_realloc(arena* pool, void* block, size_t old_size,
+					size_t new_size);
+
+// function which allocates a block and copies the given data in it
+void* arena_copy(arena* pool, const void* data, size_t size);
+
+// arena_transfer() - Moves the accounting of a block between arenas,
+// when the ownership of the block is given to the user of another arena.
+// @arg1: Arena which accounted the block.
+// @arg2: Arena which accounts the block from now on.
+// @arg3: Pointer to the block.
+// @arg4: Size with which the block was allocated.
+//
+// A block of a size class stays in the chunk from which it was allocated,
+// so that chunk must not be unmapped while the block is in use (see
+// arena_adopt); a larger block has a chunk of its own, which is moved to
+// the second arena. The block can then be freed to the second arena.
+void arena_transfer(arena* from, arena* to, void* block, size_t size);
+
+// arena_adopt() - Moves all the chunks and free blocks of an arena
+// into another arena, leaving the first one empty.
+// @arg1: Arena which receives the chunks.
+// @arg2: Arena whose chunks are moved.
+//
+// It is used when the blocks of an arena were transferred to the users of
+// other arenas, so its chunks must live as long as the receiving arena.
+void arena_adopt(arena* to, arena* from);
+
+// function which frees all the memory of the arena
+void free_arena(arena* pool);
+
+#endif  // ARENA_H_
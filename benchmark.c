@@ -0,0 +1,2477 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing benchmarks for the load balancer's components
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "load_balancer.h"
+#include "circular_doubly_linked_list.h"
+#include "intrusive_list.h"
+#include "command_io.h"
+#include "command_log.h"
+#include "utils.h"
+
+#define BENCHMARK_KEY_LENGTH 32
+#define BENCHMARK_KEYS 1000
+#define BENCHMARK_RING_WORK 20000000
+#define BENCHMARK_DISTRIBUTION_SERVERS 100
+#define BENCHMARK_DISTRIBUTION_KEYS 200000
+#define BENCHMARK_BACKEND_KEYS 1000000
+#define BENCHMARK_SCALEOUT_KEYS 1000000
+#define BENCHMARK_MEMORY_SERVERS 10
+#define BENCHMARK_MEMORY_KEYS 100000
+#define BENCHMARK_MEMORY_CYCLES 20
+// every BENCHMARK_MEMORY_LARGE_EVERY-th key has a value larger than the
+// greatest size class of the arenas, which gets a chunk of its own
+#define BENCHMARK_MEMORY_LARGE_EVERY 1000
+#define BENCHMARK_MEMORY_LARGE_VALUE (200 * 1024)
+#define BENCHMARK_BATCH_SERVERS 100
+#define BENCHMARK_BATCH_KEYS 1000000
+#define BENCHMARK_BATCH_SIZE 4096
+#define BENCHMARK_STRESS_THREADS 8
+#define BENCHMARK_STRESS_SERVERS 20
+#define BENCHMARK_STRESS_KEYS 5000
+#define BENCHMARK_STRESS_OPERATIONS 200000
+#define BENCHMARK_THREADS_SERVERS 100
+#define BENCHMARK_THREADS_KEYS 1000000
+#define BENCHMARK_THREADS_OPERATIONS 1000000
+#define BENCHMARK_THREADS_MAX 32
+#define BENCHMARK_ROUTING_SERVERS 100
+#define BENCHMARK_ROUTING_LABELS 10
+#define BENCHMARK_ROUTING_KEYS 1000000
+#define BENCHMARK_BOUNDED_SERVERS 100
+#define BENCHMARK_BOUNDED_KEYS 200000
+#define BENCHMARK_BOUNDED_CHURN 20
+#define BENCHMARK_HASH_KEYS 1000000
+#define BENCHMARK_HASH_ROUNDS 10
+#define BENCHMARK_HASH_BUCKETS 65536
+#define BENCHMARK_REPLAY_COMMANDS 1000000
+#define BENCHMARK_REPLAY_ROUNDS 5
+// the large values check stores BENCHMARK_LARGE_KEYS values larger than
+// the greatest size class of the arenas, from a command file
+#define BENCHMARK_LARGE_KEYS 20
+#define BENCHMARK_LARGE_VALUE (200 * 1024)
+#define BENCHMARK_LARGE_SERVERS 10
+// the keys check overwrites a key with values of these lengths, next to
+// BENCHMARK_KEYS_NEIGHBOURS other keys
+#define BENCHMARK_KEYS_NEIGHBOURS 100
+#define BENCHMARK_KEYS_MAX_VALUE (200 * 1024)
+// then it stores BENCHMARK_KEYS_CHAINS chains of BENCHMARK_KEYS_DEPTH keys,
+// each key being a prefix of the next one
+#define BENCHMARK_KEYS_CHAINS 500
+#define BENCHMARK_KEYS_DEPTH 8
+// exit code of a child of the commands check which applied its commands
+#define BENCHMARK_ACCEPTED 100
+#define BENCHMARK_SNAPSHOT_SERVERS 100
+#define BENCHMARK_SNAPSHOT_KEYS 2000000
+#define BENCHMARK_SNAPSHOT_VALUE 100
+#define BENCHMARK_SNAPSHOT_LOOKUPS 10000
+#define BENCHMARK_WAL_SERVERS 100
+#define BENCHMARK_WAL_KEYS 100000
+#define BENCHMARK_WAL_OPERATIONS 400000
+#define BENCHMARK_WAL_SYNCED_OPERATIONS 4000
+#define BENCHMARK_WAL_THREADS 8
+#define BENCHMARK_REPLICATION_SERVERS 20
+#define BENCHMARK_REPLICATION_KEYS 100000
+#define BENCHMARK_REPLICATION_READS 1000000
+#define BENCHMARK_REPLICATION_THETA 0.99
+#define BENCHMARK_CACHE_SERVERS 100
+#define BENCHMARK_CACHE_KEYS 500000
+#define BENCHMARK_CACHE_READS 2000000
+#define BENCHMARK_CACHE_THETA 0.99
+#define BENCHMARK_CACHE_HOT_KEYS 20000
+#define BENCHMARK_FILTER_SERVERS 100
+#define BENCHMARK_FILTER_ADDED_SERVERS 20
+#define BENCHMARK_FILTER_KEYS 500000
+#define BENCHMARK_FILTER_READS 2000000
+#define BENCHMARK_TTL_SERVERS 100
+#define BENCHMARK_TTL_ADDED_SERVERS 10
+#define BENCHMARK_TTL_STORES 1000000
+#define BENCHMARK_TTL_STORES_PER_MS 50
+#define BENCHMARK_TTL_MS 1000
+#define BENCHMARK_BUDGET_SERVERS 20
+#define BENCHMARK_BUDGET_KEYS 200000
+#define BENCHMARK_BUDGET_READS 2000000
+#define BENCHMARK_BUDGET_THETA 0.99
+#define BENCHMARK_COMPRESS_SERVERS 10
+#define BENCHMARK_COMPRESS_KEYS 10000
+#define BENCHMARK_COMPRESS_READS 200000
+#define BENCHMARK_COMPRESS_MIN_VALUE 1024
+#define BENCHMARK_COMPRESS_MAX_VALUE 8192
+#define BENCHMARK_COMPRESS_THRESHOLD 512
+#define BENCHMARK_CONTAINERS_ELEMENTS 1000000
+
+// results of the benchmarked calls are stored here, so the compiler
+// can't optimise the calls away
+volatile unsigned long benchmark_sink;
+
+// function which returns the current time in nanoseconds
+double benchmark_now() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+// function which generates a set of keys used for lookups
+char** benchmark_generate_keys(int no_keys) {
+	char** keys = malloc(no_keys * sizeof(char*));
+	DIE(keys == NULL, "Error");
+
+	for (int i = 0; i < no_keys; i++) {
+		keys[i] = malloc(BENCHMARK_KEY_LENGTH);
+		DIE(keys[i] == NULL, "Error");
+		snprintf(keys[i], BENCHMARK_KEY_LENGTH, "key_%d_%d", i, rand());
+	}
+
+	return keys;
+}
+
+// function which frees the generated keys
+void benchmark_free_keys(char** keys, int no_keys) {
+	for (int i = 0; i < no_keys; i++)
+		free(keys[i]);
+	free(keys);
+}
+
+// comparison function used for sorting labels by their hash
+int compare_label_hashes(const void* a, const void* b) {
+	unsigned int label_a = *(unsigned int*)a, label_b = *(unsigned int*)b;
+	unsigned int hash_a = hash_function_servers(&label_a);
+	unsigned int hash_b = hash_function_servers(&label_b);
+
+	return (hash_a > hash_b) - (hash_a < hash_b);
+}
+
+// the routing done by the cdll hashring: walk the list, hashing the key
+// and each label on every step, then walk it again to reach the position
+unsigned int cdll_route(cdll_list* ring, char* key) {
+	cdll_node* current = ring->head;
+	unsigned int position = 0;
+
+	for (int i = 0; i < (int)ring->size; i++) {
+		if (hash_function_key(key) <= hash_function_servers(current->data)) {
+			position = i;
+			break;
+		}
+		current = current->next;
+	}
+
+	return *(unsigned int*)get_node(ring, position)->data % MAX_HASH;
+}
+
+// the routing done by the sorted array hashring
+unsigned int array_route(hashring* ring, char* key) {
+	unsigned int position = hashring_key_position(ring, hash_function_key(key));
+	return ring->labels[position].server_id;
+}
+
+// benchmark which compares the cdll hashring with the sorted array hashring
+// for different numbers of servers (each server has 3 labels)
+void benchmark_ring() {
+	int no_servers[] = {10, 1000, 50000};
+	char** keys = benchmark_generate_keys(BENCHMARK_KEYS);
+
+	printf("%10s %10s %16s %16s %10s\n", "servers", "labels",
+		   "cdll ns/lookup", "array ns/lookup", "speedup");
+
+	for (int s = 0; s < (int)(sizeof(no_servers) / sizeof(int)); s++) {
+		int no_labels = 3 * no_servers[s];
+		unsigned int* labels = malloc(no_labels * sizeof(unsigned int));
+		DIE(labels == NULL, "Error");
+
+		// create both hashrings with the same labels
+		hashring* ring = create_hashring();
+		for (int i = 0; i < no_servers[s]; i++) {
+			hashring_add_server(ring, i, 3);
+			for (int j = 0; j < 3; j++)
+				labels[3 * i + j] = j * MAX_HASH + i;
+		}
+
+		// the cdll is built from the sorted labels, adding each one at the
+		// end, because searching the position of each label is quadratic
+		qsort(labels, no_labels, sizeof(unsigned int), compare_label_hashes);
+		cdll_list* list = create_list(sizeof(unsigned int));
+		for (int i = 0; i < no_labels; i++)
+			add_node(list, list->size, &labels[i]);
+
+		// the cdll lookups are linear, so do fewer of them on larger rings
+		int no_lookups = BENCHMARK_RING_WORK / no_labels;
+		if (no_lookups < BENCHMARK_KEYS)
+			no_lookups = BENCHMARK_KEYS;
+
+		// both hashrings must route the keys to the same servers
+		for (int i = 0; i < BENCHMARK_KEYS; i++)
+			DIE(cdll_route(list, keys[i]) != array_route(ring, keys[i]),
+				"hashrings differ");
+
+		unsigned long checksum = 0;
+		double start = benchmark_now();
+		for (int i = 0; i < no_lookups; i++)
+			checksum += cdll_route(list, keys[i % BENCHMARK_KEYS]);
+		double cdll_time = (benchmark_now() - start) / no_lookups;
+
+		int no_array_lookups = no_lookups * 100;
+		start = benchmark_now();
+		for (int i = 0; i < no_array_lookups; i++)
+			checksum += array_route(ring, keys[i % BENCHMARK_KEYS]);
+		double array_time = (benchmark_now() - start) / no_array_lookups;
+
+		benchmark_sink = checksum;
+
+		printf("%10d %10d %16.1f %16.1f %9.1fx\n", no_servers[s], no_labels,
+			   cdll_time, array_time, cdll_time / array_time);
+
+		cdll_free(&list);
+		free_hashring(ring);
+		free(labels);
+	}
+
+	benchmark_free_keys(keys, BENCHMARK_KEYS);
+}
+
+// benchmark which reports how evenly the objects are distributed
+// between the servers for different numbers of labels per server
+void benchmark_distribution() {
+	unsigned int vnodes[] = {DEFAULT_VNODES, 10, 100, 1000};
+	char** keys = benchmark_generate_keys(BENCHMARK_DISTRIBUTION_KEYS);
+
+	printf("%10s %10s %10s %10s %14s %10s\n", "vnodes", "servers",
+		   "min keys", "max keys", "max/mean", "stddev");
+
+	for (int v = 0; v < (int)(sizeof(vnodes) / sizeof(unsigned int)); v++) {
+		load_balancer* main_server = init_load_balancer();
+		for (int i = 0; i < BENCHMARK_DISTRIBUTION_SERVERS; i++)
+			loader_add_server_weighted(main_server, i, vnodes[v]);
+
+		for (int i = 0; i < BENCHMARK_DISTRIBUTION_KEYS; i++) {
+			int server_id = 0;
+			loader_store(main_server, keys[i], keys[i], &server_id);
+		}
+
+		distribution_stats stats;
+		loader_distribution_stats(main_server, &stats);
+		printf("%10u %10u %10u %10u %14.3f %10.1f\n", vnodes[v],
+			   stats.no_servers, stats.min_keys, stats.max_keys,
+			   stats.max_mean_ratio, stats.stddev);
+
+		free_load_balancer(main_server);
+	}
+
+	benchmark_free_keys(keys, BENCHMARK_DISTRIBUTION_KEYS);
+}
+
+// function which returns the number of heap bytes in use
+long benchmark_heap_bytes() {
+	struct mallinfo2 info = mallinfo2();
+	return (long)(info.uordblks + info.hblkhd);
+}
+
+// benchmark which compares the server memory backends: the time of the
+// stores, lookups, removals and of freeing the server and the bytes
+// used per stored object
+void benchmark_backend() {
+	server_backend backends[] = {SERVER_BACKEND_CHAINED, SERVER_BACKEND_FLAT};
+	char* names[] = {"chained", "flat"};
+	char** keys = benchmark_generate_keys(BENCHMARK_BACKEND_KEYS);
+	char** missing = benchmark_generate_keys(BENCHMARK_BACKEND_KEYS);
+	char value[] = "value";
+
+	// the missing keys get a prefix which is never stored
+	for (int i = 0; i < BENCHMARK_BACKEND_KEYS; i++)
+		missing[i][0] = 'K';
+
+	printf("%10s %10s %10s %10s %10s %10s %12s %8s %8s %12s\n", "backend",
+		   "keys", "store ns", "hit ns", "miss ns", "remove ns", "bytes/obj",
+		   "load", "longest", "teardown ms");
+
+	for (int b = 0; b < (int)(sizeof(backends) / sizeof(server_backend));
+		 b++) {
+		long heap_before = benchmark_heap_bytes();
+		server_memory* server = init_server_memory_backend(backends[b]);
+
+		double start = benchmark_now();
+		for (int i = 0; i < BENCHMARK_BACKEND_KEYS; i++)
+			server_store(server, keys[i], value);
+		double store_time = (benchmark_now() - start) /
+							BENCHMARK_BACKEND_KEYS;
+		long heap_bytes = benchmark_heap_bytes() - heap_before +
+						  (long)server->pool->bytes_reserved;
+
+		unsigned long checksum = 0;
+		start = benchmark_now();
+		for (int i = 0; i < BENCHMARK_BACKEND_KEYS; i++)
+			checksum += (unsigned long)server_retrieve(server, keys[i]);
+		double hit_time = (benchmark_now() - start) / BENCHMARK_BACKEND_KEYS;
+
+		start = benchmark_now();
+		for (int i = 0; i < BENCHMARK_BACKEND_KEYS; i++)
+			checksum += (unsigned long)server_retrieve(server, missing[i]);
+		double miss_time = (benchmark_now() - start) /
+						   BENCHMARK_BACKEND_KEYS;
+		benchmark_sink = checksum;
+
+		server_stats stats;
+		server_get_stats(server, &stats);
+
+		// remove half of the keys, then free the server with the rest
+		start = benchmark_now();
+		for (int i = 0; i < BENCHMARK_BACKEND_KEYS / 2; i++)
+			server_remove(server, keys[i]);
+		double remove_time = (benchmark_now() - start) /
+							 (BENCHMARK_BACKEND_KEYS / 2);
+		DIE(server->size != BENCHMARK_BACKEND_KEYS / 2, "wrong size");
+
+		start = benchmark_now();
+		free_server_memory(server);
+		double teardown_time = (benchmark_now() - start) / 1e6;
+
+		printf("%10s %10d %10.1f %10.1f %10.1f %10.1f %12.1f %8.2f %8u "
+			   "%12.3f\n", names[b], BENCHMARK_BACKEND_KEYS, store_time,
+			   hit_time, miss_time, remove_time,
+			   (double)heap_bytes / BENCHMARK_BACKEND_KEYS,
+			   stats.load_factor, stats.longest_chain, teardown_time);
+	}
+
+	benchmark_free_keys(keys, BENCHMARK_BACKEND_KEYS);
+	benchmark_free_keys(missing, BENCHMARK_BACKEND_KEYS);
+}
+
+// benchmark which measures the time of adding a server to a load balancer
+// storing BENCHMARK_SCALEOUT_KEYS keys, for different numbers of servers;
+// the time should be proportional to the number of keys which move
+void benchmark_scaleout() {
+	int no_servers[] = {10, 100, 1000};
+	char** keys = benchmark_generate_keys(BENCHMARK_SCALEOUT_KEYS);
+
+	printf("%10s %10s %12s %14s %14s\n", "servers", "keys", "keys moved",
+		   "add ms", "ns/moved key");
+
+	for (int s = 0; s < (int)(sizeof(no_servers) / sizeof(int)); s++) {
+		load_balancer* main_server = init_load_balancer();
+		for (int i = 0; i < no_servers[s]; i++)
+			loader_add_server(main_server, i);
+
+		for (int i = 0; i < BENCHMARK_SCALEOUT_KEYS; i++) {
+			int server_id = 0;
+			loader_store(main_server, keys[i], keys[i], &server_id);
+		}
+
+		double start = benchmark_now();
+		loader_add_server(main_server, no_servers[s]);
+		double add_time = benchmark_now() - start;
+
+		unsigned int moved = loader_get_server(main_server,
+											   no_servers[s])->size;
+		printf("%10d %10d %12u %14.3f %14.1f\n", no_servers[s],
+			   BENCHMARK_SCALEOUT_KEYS, moved, add_time / 1e6,
+			   moved ? add_time / moved : 0);
+
+		free_load_balancer(main_server);
+	}
+
+	benchmark_free_keys(keys, BENCHMARK_SCALEOUT_KEYS);
+}
+
+// function which returns the value stored at a key by the memory check:
+// the key itself, or the key followed by 'v' bytes for the large values
+char* benchmark_memory_value(char** keys, int i, char* large_value) {
+	if (i % BENCHMARK_MEMORY_LARGE_EVERY != 1)
+		return keys[i];
+
+	memset(large_value, 'v', BENCHMARK_MEMORY_LARGE_VALUE);
+	memcpy(large_value, keys[i], strlen(keys[i]));
+	large_value[BENCHMARK_MEMORY_LARGE_VALUE] = '\0';
+	return large_value;
+}
+
+// check which adds and removes servers on a load balancer storing
+// BENCHMARK_MEMORY_KEYS keys; the objects are moved between servers
+// without being copied, so the memory used must not change; in the end,
+// the large values are replaced by small ones
+void benchmark_memory() {
+	server_backend backends[] = {SERVER_BACKEND_CHAINED, SERVER_BACKEND_FLAT};
+	char* names[] = {"chained", "flat"};
+	char** keys = benchmark_generate_keys(BENCHMARK_MEMORY_KEYS);
+
+	// every tenth key is long, so it is stored outside the flat slots
+	char long_key[2 * KEY_LENGTH];
+	memset(long_key, 'k', sizeof(long_key) - BENCHMARK_KEY_LENGTH);
+	char* large_value = malloc(BENCHMARK_MEMORY_LARGE_VALUE + 1);
+	DIE(large_value == NULL, "Error");
+
+	printf("%10s %6s %10s %14s %16s %16s\n", "backend", "cycle", "keys",
+		   "bytes used", "bytes allocated", "bytes reserved");
+
+	for (int b = 0; b < (int)(sizeof(backends) / sizeof(server_backend));
+		 b++) {
+		load_balancer_config config;
+		default_load_balancer_config(&config);
+		config.backend = backends[b];
+		load_balancer* main_server = init_load_balancer_config(&config);
+
+		for (int i = 0; i < BENCHMARK_MEMORY_SERVERS; i++)
+			loader_add_server(main_server, i);
+		for (int i = 0; i < BENCHMARK_MEMORY_KEYS; i++) {
+			int server_id = 0;
+			char* key = keys[i];
+			if (i % 10 == 0) {
+				strcpy(long_key + sizeof(long_key) - BENCHMARK_KEY_LENGTH,
+					   keys[i]);
+				key = long_key;
+			}
+			loader_store(main_server, key,
+						 benchmark_memory_value(keys, i, large_value),
+						 &server_id);
+		}
+
+		memory_stats initial;
+		loader_memory_stats(main_server, &initial);
+		DIE(initial.total_keys != BENCHMARK_MEMORY_KEYS, "keys lost");
+
+		// each cycle adds a new server and removes the oldest one
+		for (int c = 0; c <= BENCHMARK_MEMORY_CYCLES; c++) {
+			if (c > 0) {
+				loader_add_server(main_server,
+								  BENCHMARK_MEMORY_SERVERS + c - 1);
+				loader_remove_server(main_server, c - 1);
+			}
+
+			memory_stats stats;
+			loader_memory_stats(main_server, &stats);
+			printf("%10s %6d %10u %14zu %16zu %16zu\n", names[b], c,
+				   stats.total_keys, stats.bytes_used, stats.bytes_allocated,
+				   stats.bytes_reserved);
+			DIE(stats.total_keys != initial.total_keys, "keys lost");
+			DIE(stats.bytes_used != initial.bytes_used, "bytes used changed");
+			DIE(stats.bytes_allocated != initial.bytes_allocated,
+				"bytes allocated changed");
+		}
+
+		// every object must still be found with its value
+		for (int i = 0; i < BENCHMARK_MEMORY_KEYS; i++) {
+			int server_id = 0;
+			char* key = keys[i];
+			if (i % 10 == 0) {
+				strcpy(long_key + sizeof(long_key) - BENCHMARK_KEY_LENGTH,
+					   keys[i]);
+				key = long_key;
+			}
+			char* value = loader_retrieve(main_server, key, &server_id);
+			DIE(value == NULL ||
+				strcmp(value, benchmark_memory_value(keys, i, large_value)),
+				"object lost");
+		}
+
+		// the moved large values are freed by the servers which own them
+		for (int i = 1; i < BENCHMARK_MEMORY_KEYS;
+			 i += BENCHMARK_MEMORY_LARGE_EVERY) {
+			int server_id = 0;
+			loader_store(main_server, keys[i], keys[i], &server_id);
+			char* value = loader_retrieve(main_server, keys[i], &server_id);
+			DIE(value == NULL || strcmp(value, keys[i]), "object lost");
+		}
+
+		free_load_balancer(main_server);
+	}
+
+	free(large_value);
+	benchmark_free_keys(keys, BENCHMARK_MEMORY_KEYS);
+}
+
+// benchmark which compares storing and retrieving BENCHMARK_BATCH_KEYS
+// keys one by one and in batches of BENCHMARK_BATCH_SIZE keys
+void benchmark_batch() {
+	server_backend backends[] = {SERVER_BACKEND_CHAINED, SERVER_BACKEND_FLAT};
+	char* names[] = {"chained", "flat"};
+	char** keys = benchmark_generate_keys(BENCHMARK_BATCH_KEYS);
+	char** values = malloc(BENCHMARK_BATCH_KEYS * sizeof(char*));
+	int* server_ids = malloc(BENCHMARK_BATCH_KEYS * sizeof(int));
+	DIE(values == NULL || server_ids == NULL, "Error");
+
+	printf("%10s %10s %12s %12s %12s %12s\n", "backend", "keys", "store ns",
+		   "batch ns", "retrieve ns", "batch ns");
+
+	for (int b = 0; b < (int)(sizeof(backends) / sizeof(server_backend));
+		 b++) {
+		double times[4];
+
+		// the same load balancer is filled one by one, then in batches
+		for (int batched = 0; batched < 2; batched++) {
+			load_balancer_config config;
+			default_load_balancer_config(&config);
+			config.backend = backends[b];
+			load_balancer* main_server = init_load_balancer_config(&config);
+			for (int i = 0; i < BENCHMARK_BATCH_SERVERS; i++)
+				loader_add_server(main_server, i);
+
+			double start = benchmark_now();
+			for (int i = 0; i < BENCHMARK_BATCH_KEYS;
+				 i += BENCHMARK_BATCH_SIZE) {
+				int count = BENCHMARK_BATCH_KEYS - i < BENCHMARK_BATCH_SIZE ?
+							BENCHMARK_BATCH_KEYS - i : BENCHMARK_BATCH_SIZE;
+				if (batched) {
+					loader_store_batch(main_server, keys + i, keys + i,
+									   server_ids + i, count);
+					continue;
+				}
+				for (int j = i; j < i + count; j++)
+					loader_store(main_server, keys[j], keys[j],
+								 &server_ids[j]);
+			}
+			times[2 * batched] = (benchmark_now() - start) /
+								 BENCHMARK_BATCH_KEYS;
+
+			start = benchmark_now();
+			for (int i = 0; i < BENCHMARK_BATCH_KEYS;
+				 i += BENCHMARK_BATCH_SIZE) {
+				int count = BENCHMARK_BATCH_KEYS - i < BENCHMARK_BATCH_SIZE ?
+							BENCHMARK_BATCH_KEYS - i : BENCHMARK_BATCH_SIZE;
+				if (batched) {
+					loader_retrieve_batch(main_server, keys + i, values + i,
+										  server_ids + i, count);
+					continue;
+				}
+				for (int j = i; j < i + count; j++)
+					values[j] = loader_retrieve(main_server, keys[j],
+												&server_ids[j]);
+			}
+			times[2 * batched + 1] = (benchmark_now() - start) /
+									 BENCHMARK_BATCH_KEYS;
+
+			for (int i = 0; i < BENCHMARK_BATCH_KEYS; i++)
+				DIE(values[i] == NULL || strcmp(values[i], keys[i]),
+					"wrong value");
+
+			free_load_balancer(main_server);
+		}
+
+		printf("%10s %10d %12.1f %12.1f %12.1f %12.1f\n", names[b],
+			   BENCHMARK_BATCH_KEYS, times[0], times[2], times[1], times[3]);
+	}
+
+	free(values);
+	free(server_ids);
+	benchmark_free_keys(keys, BENCHMARK_BATCH_KEYS);
+}
+
+// arguments of a thread of the stress test or of the scaling benchmark
+typedef struct benchmark_thread benchmark_thread;
+struct benchmark_thread {
+	pthread_t thread;
+	load_balancer* main_server;
+	int id;
+	unsigned int seed;
+	// number of operations done by the thread
+	int operations;
+	// keys used by the scaling benchmark
+	char** keys;
+	// latest version stored at each key of the stress test (0 if the key
+	// was never stored)
+	int* versions;
+	// set by the stress test once the threads are finished
+	atomic_int* done;
+};
+
+// function which builds the key and the value of a stress test object
+void stress_key_value(char* key, char* value, int thread, int index,
+					  int version) {
+	snprintf(key, BENCHMARK_KEY_LENGTH, "stress_%d_%d", thread, index);
+	if (value)
+		snprintf(value, BENCHMARK_KEY_LENGTH, "value_%d_%d_%d", thread, index,
+				 version);
+}
+
+// thread of the stress test; it stores and retrieves its own keys and
+// checks that it always reads the value it stored last
+void* stress_worker(void* arg) {
+	benchmark_thread* args = arg;
+	char key[BENCHMARK_KEY_LENGTH], value[BENCHMARK_KEY_LENGTH];
+	char expected[BENCHMARK_KEY_LENGTH];
+
+	for (int i = 0; i < args->operations; i++) {
+		int index = rand_r(&args->seed) % BENCHMARK_STRESS_KEYS;
+		int server_id = 0;
+
+		if (rand_r(&args->seed) % 2) {
+			args->versions[index]++;
+			stress_key_value(key, value, args->id, index,
+							 args->versions[index]);
+			loader_store(args->main_server, key, value, &server_id);
+			continue;
+		}
+
+		stress_key_value(key, expected, args->id, index,
+						 args->versions[index]);
+		int found = loader_retrieve_copy(args->main_server, key, value,
+										 sizeof(value), &server_id);
+		DIE(found != (args->versions[index] > 0), "wrong key presence");
+		DIE(found && strcmp(value, expected), "stale value");
+	}
+
+	return NULL;
+}
+
+// thread of the stress test which adds and removes servers until the
+// other threads are finished
+void* stress_churn(void* arg) {
+	benchmark_thread* args = arg;
+
+	// servers [first, first + BENCHMARK_STRESS_SERVERS) are on the load
+	// balancer; each step adds a server and removes the oldest one
+	int first = 0;
+	while (!atomic_load(args->done)) {
+		loader_add_server(args->main_server,
+						  first + BENCHMARK_STRESS_SERVERS);
+		loader_remove_server(args->main_server, first);
+		first++;
+		args->operations++;
+	}
+
+	return NULL;
+}
+
+// stress test of a thread safe load balancer: several threads store and
+// retrieve objects while another thread adds and removes servers; it
+// stops with an error if a thread reads a stale value or loses a key
+void benchmark_stress() {
+	server_backend backends[] = {SERVER_BACKEND_CHAINED, SERVER_BACKEND_FLAT,
+								 SERVER_BACKEND_CHAINED, SERVER_BACKEND_CHAINED,
+								 SERVER_BACKEND_CHAINED};
+	routing_strategy strategies[] = {ROUTING_RING, ROUTING_RING,
+									 ROUTING_MAGLEV, ROUTING_JUMP,
+									 ROUTING_RENDEZVOUS};
+	char* names[] = {"chained", "flat", "maglev", "jump", "rendezvous"};
+
+	printf("%10s %10s %12s %14s %10s\n", "backend", "threads", "operations",
+		   "server churns", "keys");
+
+	for (int b = 0; b < (int)(sizeof(backends) / sizeof(server_backend));
+		 b++) {
+		load_balancer_config config;
+		default_load_balancer_config(&config);
+		config.backend = backends[b];
+		config.routing = strategies[b];
+		config.thread_safe = 1;
+		load_balancer* main_server = init_load_balancer_config(&config);
+		for (int i = 0; i < BENCHMARK_STRESS_SERVERS; i++)
+			loader_add_server(main_server, i);
+
+		benchmark_thread threads[BENCHMARK_STRESS_THREADS + 1];
+		atomic_int done = 0;
+		for (int t = 0; t <= BENCHMARK_STRESS_THREADS; t++) {
+			threads[t].main_server = main_server;
+			threads[t].id = t;
+			threads[t].seed = t + 1;
+			threads[t].operations = t < BENCHMARK_STRESS_THREADS ?
+									BENCHMARK_STRESS_OPERATIONS : 0;
+			threads[t].versions = calloc(BENCHMARK_STRESS_KEYS, sizeof(int));
+			DIE(threads[t].versions == NULL, "Error");
+			threads[t].done = &done;
+		}
+
+		// the last thread changes the servers
+		for (int t = 0; t <= BENCHMARK_STRESS_THREADS; t++)
+			DIE(pthread_create(&threads[t].thread, NULL,
+							   t < BENCHMARK_STRESS_THREADS ? stress_worker :
+							   stress_churn, &threads[t]), "pthread_create");
+		for (int t = 0; t < BENCHMARK_STRESS_THREADS; t++)
+			pthread_join(threads[t].thread, NULL);
+		atomic_store(&done, 1);
+		pthread_join(threads[BENCHMARK_STRESS_THREADS].thread, NULL);
+
+		// every stored key must still be found, with its latest value
+		unsigned int stored = 0;
+		char key[BENCHMARK_KEY_LENGTH], value[BENCHMARK_KEY_LENGTH];
+		char expected[BENCHMARK_KEY_LENGTH];
+		for (int t = 0; t < BENCHMARK_STRESS_THREADS; t++) {
+			for (int i = 0; i < BENCHMARK_STRESS_KEYS; i++) {
+				if (threads[t].versions[i] == 0)
+					continue;
+				stored++;
+				int server_id = 0;
+				stress_key_value(key, expected, t, i, threads[t].versions[i]);
+				DIE(!loader_retrieve_copy(main_server, key, value,
+										  sizeof(value), &server_id) ||
+					strcmp(value, expected), "object lost");
+			}
+		}
+
+		memory_stats stats;
+		loader_memory_stats(main_server, &stats);
+		DIE(stats.total_keys != stored, "wrong number of keys");
+
+		printf("%10s %10d %12d %14d %10u\n", names[b],
+			   BENCHMARK_STRESS_THREADS,
+			   BENCHMARK_STRESS_THREADS * BENCHMARK_STRESS_OPERATIONS,
+			   threads[BENCHMARK_STRESS_THREADS].operations, stored);
+
+		for (int t = 0; t <= BENCHMARK_STRESS_THREADS; t++)
+			free(threads[t].versions);
+		free_load_balancer(main_server);
+	}
+}
+
+// thread of the scaling benchmark; 90% of its operations are retrieves
+// and 10% are stores
+void* threads_worker(void* arg) {
+	benchmark_thread* args = arg;
+	char value[BENCHMARK_KEY_LENGTH];
+	unsigned long found = 0;
+
+	for (int i = 0; i < args->operations; i++) {
+		char* key = args->keys[rand_r(&args->seed) % BENCHMARK_THREADS_KEYS];
+		int server_id = 0;
+
+		if (rand_r(&args->seed) % 10 == 0)
+			loader_store(args->main_server, key, key, &server_id);
+		else
+			found += loader_retrieve_copy(args->main_server, key, value,
+										  sizeof(value), &server_id);
+	}
+	benchmark_sink = found;
+
+	return NULL;
+}
+
+// benchmark which measures the throughput of a thread safe load balancer
+// for 1 to BENCHMARK_THREADS_MAX threads, which share
+// BENCHMARK_THREADS_OPERATIONS operations
+void benchmark_threads() {
+	char** keys = benchmark_generate_keys(BENCHMARK_THREADS_KEYS);
+
+	load_balancer_config config;
+	default_load_balancer_config(&config);
+	config.thread_safe = 1;
+	load_balancer* main_server = init_load_balancer_config(&config);
+	for (int i = 0; i < BENCHMARK_THREADS_SERVERS; i++)
+		loader_add_server(main_server, i);
+	for (int i = 0; i < BENCHMARK_THREADS_KEYS; i++) {
+		int server_id = 0;
+		loader_store(main_server, keys[i], keys[i], &server_id);
+	}
+
+	printf("%10s %12s %12s %10s\n", "threads", "operations", "Mops/s",
+		   "speedup");
+
+	double single_rate = 0;
+	for (int no_threads = 1; no_threads <= BENCHMARK_THREADS_MAX;
+		 no_threads *= 2) {
+		benchmark_thread threads[BENCHMARK_THREADS_MAX];
+
+		double start = benchmark_now();
+		for (int t = 0; t < no_threads; t++) {
+			threads[t].main_server = main_server;
+			threads[t].seed = t + 1;
+			threads[t].keys = keys;
+			threads[t].operations = BENCHMARK_THREADS_OPERATIONS / no_threads;
+			DIE(pthread_create(&threads[t].thread, NULL, threads_worker,
+							   &threads[t]), "pthread_create");
+		}
+		for (int t = 0; t < no_threads; t++)
+			pthread_join(threads[t].thread, NULL);
+		double rate = BENCHMARK_THREADS_OPERATIONS /
+					  (benchmark_now() - start) * 1e3;
+
+		if (no_threads == 1)
+			single_rate = rate;
+		printf("%10d %12d %12.2f %10.2f\n", no_threads,
+			   BENCHMARK_THREADS_OPERATIONS, rate, rate / single_rate);
+	}
+
+	free_load_balancer(main_server);
+	benchmark_free_keys(keys, BENCHMARK_THREADS_KEYS);
+}
+
+// function which routes all the key hashes and returns the ratio between
+// the most loaded server and the mean
+double routing_route_all(router* routes, unsigned int* hashes,
+						 unsigned int* servers) {
+	unsigned int* load = calloc(MAX_HASH, sizeof(unsigned int));
+	DIE(load == NULL, "Error");
+
+	unsigned int max_load = 0;
+	for (int i = 0; i < BENCHMARK_ROUTING_KEYS; i++) {
+		servers[i] = router_route(routes, hashes[i]);
+		if (++load[servers[i]] > max_load)
+			max_load = load[servers[i]];
+	}
+	free(load);
+
+	return max_load / ((double)BENCHMARK_ROUTING_KEYS /
+					   router_no_servers(routes));
+}
+
+// function which returns the percentage of keys whose server changed
+double routing_moved(router* routes, unsigned int* hashes,
+					 unsigned int* servers) {
+	unsigned int moved = 0;
+
+	for (int i = 0; i < BENCHMARK_ROUTING_KEYS; i++)
+		moved += router_route(routes, hashes[i]) != servers[i];
+
+	return 100.0 * moved / BENCHMARK_ROUTING_KEYS;
+}
+
+// benchmark which compares the routing strategies: lookup time, memory,
+// balance and the keys moved when a server is added or removed
+void benchmark_routing() {
+	routing_strategy strategies[] = {ROUTING_RING, ROUTING_MAGLEV,
+									 ROUTING_JUMP, ROUTING_RENDEZVOUS};
+	char* names[] = {"ring", "maglev", "jump", "rendezvous"};
+	char** keys = benchmark_generate_keys(BENCHMARK_ROUTING_KEYS);
+	unsigned int* hashes = malloc(BENCHMARK_ROUTING_KEYS *
+								  sizeof(unsigned int));
+	unsigned int* servers = malloc(BENCHMARK_ROUTING_KEYS *
+								   sizeof(unsigned int));
+	DIE(hashes == NULL || servers == NULL, "Error");
+	for (int i = 0; i < BENCHMARK_ROUTING_KEYS; i++)
+		hashes[i] = hash_function_key(keys[i]);
+
+	printf("%d servers with %d labels, %d keys; ideal moves %.2f%% on add, "
+		   "%.2f%% on remove\n", BENCHMARK_ROUTING_SERVERS,
+		   BENCHMARK_ROUTING_LABELS, BENCHMARK_ROUTING_KEYS,
+		   100.0 / (BENCHMARK_ROUTING_SERVERS + 1),
+		   100.0 / BENCHMARK_ROUTING_SERVERS);
+	printf("%12s %10s %12s %10s %12s %12s %12s\n", "strategy", "lookup ns",
+		   "bytes", "max/mean", "add moves %", "remove moves %",
+		   "change ms");
+
+	for (int s = 0; s < (int)(sizeof(strategies) / sizeof(routing_strategy));
+		 s++) {
+		router* routes = create_router(strategies[s]);
+		for (int i = 0; i < BENCHMARK_ROUTING_SERVERS; i++)
+			router_add_server(routes, i, BENCHMARK_ROUTING_LABELS);
+
+		unsigned long checksum = 0;
+		double start = benchmark_now();
+		for (int i = 0; i < BENCHMARK_ROUTING_KEYS; i++)
+			checksum += router_route(routes, hashes[i]);
+		double lookup_time = (benchmark_now() - start) /
+							 BENCHMARK_ROUTING_KEYS;
+		benchmark_sink = checksum;
+
+		double max_mean = routing_route_all(routes, hashes, servers);
+
+		start = benchmark_now();
+		router_add_server(routes, BENCHMARK_ROUTING_SERVERS,
+						  BENCHMARK_ROUTING_LABELS);
+		double change_time = benchmark_now() - start;
+		double added = routing_moved(routes, hashes, servers);
+
+		routing_route_all(routes, hashes, servers);
+		start = benchmark_now();
+		router_remove_server(routes, 0);
+		change_time = (change_time + benchmark_now() - start) / 2;
+		double removed = routing_moved(routes, hashes, servers);
+
+		printf("%12s %10.1f %12zu %10.3f %12.2f %12.2f %12.3f\n", names[s],
+			   lookup_time, router_bytes(routes), max_mean, added, removed,
+			   change_time / 1e6);
+
+		free_router(routes);
+	}
+
+	free(hashes);
+	free(servers);
+	benchmark_free_keys(keys, BENCHMARK_ROUTING_KEYS);
+}
+
+// function which returns the number of objects the most loaded server
+// has over its bound (the servers have the same weight)
+unsigned int bounded_excess(load_balancer* main_server, double epsilon)
+{
+	distribution_stats stats;
+	loader_distribution_stats(main_server, &stats);
+
+	unsigned int bound = (unsigned int)ceil((1 + epsilon) * stats.mean);
+	return stats.max_keys > bound ? stats.max_keys - bound : 0;
+}
+
+// benchmark which compares the plain hashring with bounded loads: the
+// store and lookup times, the balance and the balance after servers are
+// added and removed; it stops with an error if the bound is broken
+void benchmark_bounded() {
+	double epsilons[] = {-1, 1, 0.25, 0.1};
+	char** keys = benchmark_generate_keys(BENCHMARK_BOUNDED_KEYS);
+	char** missing = benchmark_generate_keys(BENCHMARK_BOUNDED_KEYS);
+	// the missing keys get a prefix which is never stored
+	for (int i = 0; i < BENCHMARK_BOUNDED_KEYS; i++)
+		missing[i][0] = 'K';
+
+	printf("%d servers with %d labels, %d keys\n", BENCHMARK_BOUNDED_SERVERS,
+		   DEFAULT_VNODES, BENCHMARK_BOUNDED_KEYS);
+	printf("%10s %10s %12s %12s %10s %14s\n", "epsilon", "store ns",
+		   "lookup ns", "missing ns", "max/mean", "churn max/mean");
+
+	for (int e = 0; e < (int)(sizeof(epsilons) / sizeof(double)); e++) {
+		load_balancer_config config;
+		default_load_balancer_config(&config);
+		if (epsilons[e] >= 0) {
+			config.bounded_loads = 1;
+			config.load_epsilon = epsilons[e];
+		}
+		load_balancer* main_server = init_load_balancer_config(&config);
+		for (int i = 0; i < BENCHMARK_BOUNDED_SERVERS; i++)
+			loader_add_server(main_server, i);
+
+		int server_id = 0;
+		double start = benchmark_now();
+		for (int i = 0; i < BENCHMARK_BOUNDED_KEYS; i++)
+			loader_store(main_server, keys[i], keys[i], &server_id);
+		double store_time = (benchmark_now() - start) /
+							BENCHMARK_BOUNDED_KEYS;
+
+		unsigned long found = 0;
+		start = benchmark_now();
+		for (int i = 0; i < BENCHMARK_BOUNDED_KEYS; i++)
+			found += loader_retrieve(main_server, keys[i], &server_id) != NULL;
+		double lookup_time = (benchmark_now() - start) /
+							 BENCHMARK_BOUNDED_KEYS;
+		DIE(found != BENCHMARK_BOUNDED_KEYS, "bounded loads lost a key");
+
+		start = benchmark_now();
+		for (int i = 0; i < BENCHMARK_BOUNDED_KEYS; i++)
+			found += loader_retrieve(main_server, missing[i], &server_id) !=
+					 NULL;
+		double missing_time = (benchmark_now() - start) /
+							  BENCHMARK_BOUNDED_KEYS;
+		DIE(found != BENCHMARK_BOUNDED_KEYS, "bounded loads found a key "
+			"which was not stored");
+
+		distribution_stats stats;
+		loader_distribution_stats(main_server, &stats);
+		double max_mean = stats.max_mean_ratio;
+
+		// replace the servers one by one, checking the bound each time
+		for (int i = 0; i < BENCHMARK_BOUNDED_CHURN; i++) {
+			loader_add_server(main_server, BENCHMARK_BOUNDED_SERVERS + i);
+			loader_remove_server(main_server, i);
+			DIE(epsilons[e] >= 0 && bounded_excess(main_server, epsilons[e]),
+				"a server went over its bound");
+		}
+		loader_distribution_stats(main_server, &stats);
+
+		char name[16] = "none";
+		if (epsilons[e] >= 0)
+			snprintf(name, sizeof(name), "%.2f", epsilons[e]);
+		printf("%10s %10.1f %12.1f %12.1f %10.3f %14.3f\n", name,
+			   store_time, lookup_time, missing_time, max_mean,
+			   stats.max_mean_ratio);
+
+		free_load_balancer(main_server);
+	}
+
+	benchmark_free_keys(keys, BENCHMARK_BOUNDED_KEYS);
+	benchmark_free_keys(missing, BENCHMARK_BOUNDED_KEYS);
+}
+
+// the key hash used before key_hash64 (djb2, one step for each byte)
+unsigned int benchmark_djb2(char* key) {
+	unsigned char* bytes = (unsigned char*)key;
+	unsigned int hash = 5381;
+	int c;
+
+	while ((c = *bytes++))
+		hash = ((hash << 5u) + hash) + c;
+
+	return hash;
+}
+
+// function which generates keys with the given length, or the keys of
+// the other benchmarks if the length is 0
+char** benchmark_hash_keys(int length) {
+	if (length == 0)
+		return benchmark_generate_keys(BENCHMARK_HASH_KEYS);
+
+	char** keys = malloc(BENCHMARK_HASH_KEYS * sizeof(char*));
+	DIE(keys == NULL, "Error");
+	for (int i = 0; i < BENCHMARK_HASH_KEYS; i++) {
+		keys[i] = malloc(length + 1);
+		DIE(keys[i] == NULL, "Error");
+		memset(keys[i], 'x', length);
+		keys[i][length] = 0;
+
+		// the number goes at the end, as in generated ids
+		char number[16];
+		int digits = snprintf(number, sizeof(number), "%d", i);
+		if (digits > length)
+			digits = length;
+		memcpy(keys[i] + length - digits, number + strlen(number) - digits,
+			   digits);
+	}
+
+	return keys;
+}
+
+// function which returns the ratio between the fullest bucket and the
+// mean, when the keys are spread on buckets by the low bits of the hashes
+double benchmark_hash_spread(unsigned int* hashes) {
+	unsigned int* load = calloc(BENCHMARK_HASH_BUCKETS, sizeof(unsigned int));
+	DIE(load == NULL, "Error");
+
+	unsigned int max_load = 0;
+	for (int i = 0; i < BENCHMARK_HASH_KEYS; i++) {
+		unsigned int bucket = hashes[i] & (BENCHMARK_HASH_BUCKETS - 1);
+		if (++load[bucket] > max_load)
+			max_load = load[bucket];
+	}
+	free(load);
+
+	return max_load / ((double)BENCHMARK_HASH_KEYS / BENCHMARK_HASH_BUCKETS);
+}
+
+// benchmark which compares djb2 with the word at a time key hash for the
+// key lengths used by the load balancer: the time per key (measuring the
+// key included) and how evenly the low bits spread the keys on buckets
+void benchmark_hash() {
+	int lengths[] = {0, 8, 16, 32, 64, KEY_LENGTH - 1};
+	unsigned int* hashes = malloc(BENCHMARK_HASH_KEYS * sizeof(unsigned int));
+	DIE(hashes == NULL, "Error");
+
+	printf("%10s %12s %12s %10s %14s %14s\n", "key bytes", "djb2 ns",
+		   "key_hash ns", "speedup", "djb2 max/mean", "hash max/mean");
+
+	for (int l = 0; l < (int)(sizeof(lengths) / sizeof(int)); l++) {
+		char** keys = benchmark_hash_keys(lengths[l]);
+		size_t bytes = 0;
+		for (int i = 0; i < BENCHMARK_HASH_KEYS; i++)
+			bytes += strlen(keys[i]);
+
+		double hashed = (double)BENCHMARK_HASH_ROUNDS * BENCHMARK_HASH_KEYS;
+		unsigned long checksum = 0;
+		double start = benchmark_now();
+		for (int r = 0; r < BENCHMARK_HASH_ROUNDS; r++)
+			for (int i = 0; i < BENCHMARK_HASH_KEYS; i++)
+				checksum += benchmark_djb2(keys[i]);
+		double djb2_time = (benchmark_now() - start) / hashed;
+
+		start = benchmark_now();
+		for (int r = 0; r < BENCHMARK_HASH_ROUNDS; r++)
+			for (int i = 0; i < BENCHMARK_HASH_KEYS; i++)
+				checksum += hash_function_key(keys[i]);
+		double hash_time = (benchmark_now() - start) / hashed;
+		benchmark_sink = checksum;
+
+		for (int i = 0; i < BENCHMARK_HASH_KEYS; i++)
+			hashes[i] = benchmark_djb2(keys[i]);
+		double djb2_spread = benchmark_hash_spread(hashes);
+		for (int i = 0; i < BENCHMARK_HASH_KEYS; i++)
+			hashes[i] = hash_function_key(keys[i]);
+		double hash_spread = benchmark_hash_spread(hashes);
+
+		printf("%10.1f %12.1f %12.1f %9.1fx %14.2f %14.2f\n",
+			   (double)bytes / BENCHMARK_HASH_KEYS, djb2_time, hash_time,
+			   djb2_time / hash_time, djb2_spread, hash_spread);
+
+		benchmark_free_keys(keys, BENCHMARK_HASH_KEYS);
+	}
+
+	free(hashes);
+}
+
+// function which writes the commands of the replay benchmark in a
+// temporary file, as text or as a command log (with or without hashes)
+void benchmark_replay_file(char* path, int binary, int hashed) {
+	int fd = mkstemp(path);
+	DIE(fd < 0, "mkstemp");
+	FILE* file = fdopen(fd, "wb");
+	DIE(file == NULL, "fdopen");
+	output_writer output;
+	init_output_writer(&output, file);
+	if (binary)
+		write_log_header(&output);
+
+	// the same commands are generated for each file
+	srand(42);
+	char key[BENCHMARK_KEY_LENGTH];
+	char value[64];
+	for (int i = 0; i < BENCHMARK_REPLAY_COMMANDS; i++) {
+		command request;
+		request.type = rand() % 2 ? COMMAND_STORE : COMMAND_RETRIEVE;
+		snprintf(key, sizeof(key), "key_%d_%d", rand() % 100000, rand());
+		key_descriptor_init(&request.key, key);
+
+		// values of 8 to 63 bytes
+		request.value_length = 8 + rand() % (sizeof(value) - 8);
+		for (unsigned int j = 0; j < request.value_length; j++)
+			value[j] = 'a' + rand() % 26;
+		value[request.value_length] = 0;
+		request.value = value;
+
+		if (binary)
+			write_log_command(&output, &request, hashed);
+		else
+			write_text_command(&output, &request);
+	}
+
+	free_output_writer(&output);
+	DIE(fclose(file) != 0, "fclose");
+}
+
+// benchmark which compares reading the same commands from a text command
+// file and from a command log (the files are in the page cache, so this
+// is the cost of parsing them, without applying the commands)
+void benchmark_replay() {
+	char* names[] = {"text", "log, no hashes", "log, hashes"};
+
+	printf("%16s %12s %14s %10s\n", "format", "bytes",
+		   "ns / command", "MB/s");
+
+	for (int f = 0; f < 3; f++) {
+		char path[] = "/tmp/benchmark_replayXXXXXX";
+		benchmark_replay_file(path, f > 0, f == 2);
+
+		double elapsed = 0;
+		size_t size = 0;
+		for (int r = 0; r < BENCHMARK_REPLAY_ROUNDS; r++) {
+			// the file is opened again, since reading it changes it
+			command_file input;
+			open_command_file(&input, path);
+			size = input.size;
+
+			double start = benchmark_now();
+			command_reader reader;
+			init_command_reader(&reader, &input);
+			command request;
+			unsigned long checksum = 0;
+			while (next_command(&reader, &request))
+				checksum += request.key.hash + request.value_length;
+			elapsed += benchmark_now() - start;
+			benchmark_sink = checksum;
+
+			close_command_file(&input);
+		}
+		unlink(path);
+
+		elapsed /= BENCHMARK_REPLAY_ROUNDS;
+		printf("%16s %12zu %14.1f %10.0f\n", names[f], size,
+			   elapsed / BENCHMARK_REPLAY_COMMANDS, size / elapsed * 1e3);
+	}
+}
+
+// function which writes the commands of the large values check: the
+// large values are stored on two servers, moved by the added servers,
+// read back, replaced by small values and read back again
+void benchmark_large_file(char* path) {
+	int fd = mkstemp(path);
+	DIE(fd < 0, "mkstemp");
+	FILE* file = fdopen(fd, "wb");
+	DIE(file == NULL, "fdopen");
+	output_writer output;
+	init_output_writer(&output, file);
+
+	char* large_value = malloc(BENCHMARK_LARGE_VALUE + 1);
+	DIE(large_value == NULL, "Error");
+	memset(large_value, 'v', BENCHMARK_LARGE_VALUE);
+	large_value[BENCHMARK_LARGE_VALUE] = '\0';
+	char key[BENCHMARK_KEY_LENGTH];
+
+	command request;
+	request.weight = -1;
+	request.type = COMMAND_ADD_SERVER;
+	for (int i = 0; i < BENCHMARK_LARGE_SERVERS; i++) {
+		request.server_id = i;
+		write_text_command(&output, &request);
+
+		// the phases are written after the first two servers
+		for (int phase = 0; i == 1 && phase < 3; phase++) {
+			for (int k = 0; k < BENCHMARK_LARGE_KEYS; k++) {
+				command value_request;
+				snprintf(key, sizeof(key), "large_%d", k);
+				key_descriptor_init(&value_request.key, key);
+				value_request.type = phase == 0 ? COMMAND_STORE :
+												  COMMAND_RETRIEVE;
+				value_request.value = large_value;
+				value_request.value_length = BENCHMARK_LARGE_VALUE;
+				write_text_command(&output, &value_request);
+			}
+		}
+	}
+
+	// the moved values are checked, then replaced by their keys
+	for (int phase = 0; phase < 3; phase++) {
+		for (int k = 0; k < BENCHMARK_LARGE_KEYS; k++) {
+			snprintf(key, sizeof(key), "large_%d", k);
+			key_descriptor_init(&request.key, key);
+			request.type = phase == 1 ? COMMAND_STORE : COMMAND_RETRIEVE;
+			request.value = key;
+			request.value_length = strlen(key);
+			write_text_command(&output, &request);
+		}
+	}
+
+	free(large_value);
+	free_output_writer(&output);
+	DIE(fclose(file) != 0, "fclose");
+}
+
+// check which replays a command file with values of 200 KB through both
+// backends: the values get chunks of their own in the arenas, which must
+// follow them when the added servers take them over; it stops with an
+// error if a retrieve doesn't return the last value stored at its key
+void benchmark_large() {
+	server_backend backends[] = {SERVER_BACKEND_CHAINED, SERVER_BACKEND_FLAT};
+	char* names[] = {"chained", "flat"};
+	char path[] = "/tmp/benchmark_largeXXXXXX";
+	benchmark_large_file(path);
+
+	printf("%10s %10s %12s %16s %16s\n", "backend", "commands", "time ms",
+		   "bytes allocated", "bytes reserved");
+
+	for (int b = 0; b < (int)(sizeof(backends) / sizeof(server_backend));
+		 b++) {
+		load_balancer_config config;
+		default_load_balancer_config(&config);
+		config.backend = backends[b];
+		load_balancer* main_server = init_load_balancer_config(&config);
+
+		// the file is opened again, since reading it changes it
+		command_file input;
+		open_command_file(&input, path);
+		command_reader reader;
+		init_command_reader(&reader, &input);
+
+		double start = benchmark_now();
+		unsigned int no_commands = 0, small_values = 0;
+		command request;
+		while (next_command(&reader, &request)) {
+			int server_id = 0;
+			no_commands++;
+			if (request.type == COMMAND_ADD_SERVER) {
+				loader_add_server(main_server, request.server_id);
+			} else if (request.type == COMMAND_STORE) {
+				small_values += request.value_length < BENCHMARK_LARGE_VALUE;
+				loader_store_key(main_server, &request.key, request.value,
+								 &server_id);
+			} else {
+				// the retrieves read the large values until they are
+				// replaced by the keys themselves
+				char* value = loader_retrieve_key(main_server, &request.key,
+												  &server_id);
+				DIE(value == NULL, "object lost");
+				DIE(small_values ? strcmp(value, request.key.key) != 0 :
+					strlen(value) != BENCHMARK_LARGE_VALUE, "wrong value");
+			}
+		}
+		double elapsed = benchmark_now() - start;
+
+		memory_stats stats;
+		loader_memory_stats(main_server, &stats);
+		printf("%10s %10u %12.3f %16zu %16zu\n", names[b], no_commands,
+			   elapsed / 1e6, stats.bytes_allocated, stats.bytes_reserved);
+
+		close_command_file(&input);
+		free_load_balancer(main_server);
+	}
+
+	unlink(path);
+}
+
+// function which checks that the neighbours stored by the keys check
+// still have their values
+void benchmark_keys_neighbours(server_memory* server) {
+	char key[BENCHMARK_KEY_LENGTH];
+
+	for (int i = 0; i < BENCHMARK_KEYS_NEIGHBOURS; i++) {
+		snprintf(key, sizeof(key), "neighbour_%d", i);
+		char* value = server_retrieve(server, key);
+		DIE(value == NULL || strcmp(value, key), "neighbour changed");
+	}
+}
+
+// function which writes the key of the keys check with the given chain
+// and depth: the key of a chain is a prefix of its keys of greater depth
+void benchmark_keys_prefix(char* key, int chain, int depth) {
+	int length = snprintf(key, BENCHMARK_KEY_LENGTH, "p%d_", chain);
+	memset(key + length, 'x', depth);
+	key[length + depth] = '\0';
+}
+
+// function which checks that keys which are prefixes of each other are
+// told apart by lookups and removals; with many chains of keys, some
+// keys share their bucket with their prefixes
+void benchmark_keys_prefixes(server_memory* server) {
+	char key[BENCHMARK_KEY_LENGTH];
+	char value[2 * BENCHMARK_KEY_LENGTH];
+
+	// the longer keys are stored first, so a bucket lists them before
+	// their prefixes
+	for (int c = 0; c < BENCHMARK_KEYS_CHAINS; c++) {
+		for (int d = BENCHMARK_KEYS_DEPTH - 1; d >= 0; d--) {
+			benchmark_keys_prefix(key, c, d);
+			snprintf(value, sizeof(value), "value_of_%s", key);
+			server_store(server, key, value);
+		}
+	}
+
+	// the missing keys extend the stored ones; every other key is removed
+	// (the removal of a missing key must not remove its prefix)
+	for (int c = 0; c < BENCHMARK_KEYS_CHAINS; c++) {
+		benchmark_keys_prefix(key, c, BENCHMARK_KEYS_DEPTH);
+		DIE(server_retrieve(server, key) != NULL, "missing key found");
+		server_remove(server, key);
+		for (int d = 1; d < BENCHMARK_KEYS_DEPTH; d += 2) {
+			benchmark_keys_prefix(key, c, d);
+			server_remove(server, key);
+		}
+	}
+
+	for (int c = 0; c < BENCHMARK_KEYS_CHAINS; c++) {
+		for (int d = 0; d < BENCHMARK_KEYS_DEPTH; d++) {
+			benchmark_keys_prefix(key, c, d);
+			snprintf(value, sizeof(value), "value_of_%s", key);
+			char* stored = server_retrieve(server, key);
+			if (d % 2)
+				DIE(stored != NULL, "removed key found");
+			else
+				DIE(stored == NULL || strcmp(stored, value), "wrong value");
+			server_remove(server, key);
+		}
+	}
+}
+
+// check of the key lookups of both backends: a key is overwritten with
+// longer and shorter values (up to BENCHMARK_KEYS_MAX_VALUE bytes, so
+// past the greatest arena size class) while other keys are stored next
+// to it, then keys which are prefixes of each other are stored, looked up
+// and removed; it stops with an error if a value or a neighbour is wrong
+void benchmark_keys() {
+	server_backend backends[] = {SERVER_BACKEND_CHAINED, SERVER_BACKEND_FLAT};
+	char* names[] = {"chained", "flat"};
+	size_t lengths[] = {8, 1000, BENCHMARK_KEYS_MAX_VALUE, 16, 64 * 1024, 8};
+	int no_lengths = sizeof(lengths) / sizeof(size_t);
+	char key[BENCHMARK_KEY_LENGTH];
+
+	char* value = malloc(BENCHMARK_KEYS_MAX_VALUE + 1);
+	DIE(value == NULL, "Error");
+
+	for (int b = 0; b < (int)(sizeof(backends) / sizeof(server_backend));
+		 b++) {
+		server_memory* server = init_server_memory_backend(backends[b]);
+		for (int i = 0; i < BENCHMARK_KEYS_NEIGHBOURS; i++) {
+			snprintf(key, sizeof(key), "neighbour_%d", i);
+			server_store(server, key, key);
+		}
+
+		// each overwrite has a different length and a different content
+		for (int l = 0; l < no_lengths; l++) {
+			memset(value, 'a' + l, lengths[l]);
+			value[lengths[l]] = '\0';
+			server_store(server, "overwritten", value);
+
+			char* stored = server_retrieve(server, "overwritten");
+			DIE(stored == NULL || strcmp(stored, value), "wrong value");
+			benchmark_keys_neighbours(server);
+		}
+		DIE(server->size != BENCHMARK_KEYS_NEIGHBOURS + 1, "wrong size");
+
+		benchmark_keys_prefixes(server);
+		benchmark_keys_neighbours(server);
+		DIE(server->size != BENCHMARK_KEYS_NEIGHBOURS + 1, "wrong size");
+
+		printf("%10s: %d overwrites of 8 to %d bytes, prefix keys ok\n",
+			   names[b], no_lengths, BENCHMARK_KEYS_MAX_VALUE);
+		free_server_memory(server);
+	}
+
+	free(value);
+}
+
+// function which applies the commands of a command file in a child
+// process and returns 1 if the child stopped with an error (a rejected
+// command), 0 if it applied all of them; the file is removed
+int benchmark_rejects(const char* path) {
+	fflush(stdout);
+	pid_t pid = fork();
+	DIE(pid < 0, "fork");
+	if (pid == 0) {
+		// the error message of a rejected command is expected
+		DIE(freopen("/dev/null", "w", stderr) == NULL, "freopen");
+
+		command_file input;
+		open_command_file(&input, path);
+		command_reader reader;
+		init_command_reader(&reader, &input);
+		load_balancer* main_server = init_load_balancer();
+
+		command request;
+		while (next_command(&reader, &request)) {
+			int server_id = 0;
+			if (request.type == COMMAND_ADD_SERVER)
+				loader_add_server_weighted(main_server, request.server_id,
+										   request.weight >= 0 ?
+										   request.weight : DEFAULT_VNODES);
+			else if (request.type == COMMAND_REMOVE_SERVER)
+				loader_remove_server(main_server, request.server_id);
+			else if (request.type == COMMAND_STORE)
+				loader_store_key(main_server, &request.key, request.value,
+								 &server_id);
+			else
+				loader_retrieve_key(main_server, &request.key, &server_id);
+		}
+
+		free_load_balancer(main_server);
+		close_command_file(&input);
+		_exit(BENCHMARK_ACCEPTED);
+	}
+
+	int status;
+	DIE(waitpid(pid, &status, 0) != pid, "waitpid");
+	unlink(path);
+
+	return !WIFEXITED(status) || WEXITSTATUS(status) != BENCHMARK_ACCEPTED;
+}
+
+// function which writes a temporary command file with the given text
+void benchmark_text_file(char* path, const char* text) {
+	int fd = mkstemp(path);
+	DIE(fd < 0, "mkstemp");
+	DIE(write(fd, text, strlen(text)) != (ssize_t)strlen(text), "write");
+	DIE(close(fd) != 0, "close");
+}
+
+// function which writes a temporary command log with one add_server
+// command; the log isn't checked by the text parser
+void benchmark_log_file(char* path, int server_id, int weight) {
+	int fd = mkstemp(path);
+	DIE(fd < 0, "mkstemp");
+	FILE* file = fdopen(fd, "wb");
+	DIE(file == NULL, "fdopen");
+	output_writer output;
+	init_output_writer(&output, file);
+	write_log_header(&output);
+
+	command request;
+	request.type = COMMAND_ADD_SERVER;
+	request.server_id = server_id;
+	request.weight = weight;
+	write_log_command(&output, &request, 1);
+
+	free_output_writer(&output);
+	DIE(fclose(file) != 0, "fclose");
+}
+
+// check of the validation of the command files: each file is applied in
+// a child process, which must stop with an error exactly for the files
+// with an invalid command
+void benchmark_commands() {
+	char* files[] = {
+		"add_server 1 3\nadd_server 2\nstore \"k\" \"v\"\n"
+		"remove_server 1\n",
+		"add_server 1 0\n",
+		"add_server 1\nadd_server 2 0\nremove_server 2\n",
+		"add_server 100000\n",
+		"add_server 1\nremove_server 4294967297\n",
+	};
+	int rejected[] = {0, 1, 1, 1, 1};
+	char* names[] = {"valid", "weight 0", "weight 0, removed",
+					 "id MAX_HASH", "id 2^32 + 1"};
+
+	for (int i = 0; i < (int)(sizeof(files) / sizeof(char*)); i++) {
+		char path[] = "/tmp/benchmark_commandsXXXXXX";
+		benchmark_text_file(path, files[i]);
+		int result = benchmark_rejects(path);
+		printf("%20s: %s\n", names[i], result ? "rejected" : "accepted");
+		DIE(result != rejected[i], "wrong validation");
+	}
+
+	// the load balancer rejects what a command log gives it
+	char path[] = "/tmp/benchmark_commandsXXXXXX";
+	benchmark_log_file(path, 1, 0);
+	int result = benchmark_rejects(path);
+	printf("%20s: %s\n", "log, weight 0", result ? "rejected" : "accepted");
+	DIE(!result, "wrong validation");
+
+	char id_path[] = "/tmp/benchmark_commandsXXXXXX";
+	benchmark_log_file(id_path, MAX_HASH, 3);
+	result = benchmark_rejects(id_path);
+	printf("%20s: %s\n", "log, id MAX_HASH", result ? "rejected" : "accepted");
+	DIE(!result, "wrong validation");
+}
+
+// function which returns the resident memory of the process, in MB
+double benchmark_rss() {
+	FILE* file = fopen("/proc/self/statm", "r");
+	DIE(file == NULL, "fopen");
+	long pages = 0, resident = 0;
+	DIE(fscanf(file, "%ld %ld", &pages, &resident) != 2, "fscanf");
+	fclose(file);
+
+	return resident * (double)sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+// function which fills a load balancer with the keys of the snapshot
+// benchmark (the value of a key is derived from its index)
+void benchmark_snapshot_fill(load_balancer* main_server, char** keys) {
+	char value[BENCHMARK_SNAPSHOT_VALUE];
+	memset(value, 'v', sizeof(value) - 1);
+	value[sizeof(value) - 1] = 0;
+
+	int server_id;
+	for (int i = 0; i < BENCHMARK_SNAPSHOT_KEYS; i++) {
+		snprintf(value, 16, "%015d", i);
+		value[15] = 'v';
+		loader_store(main_server, keys[i], value, &server_id);
+	}
+}
+
+// benchmark which compares starting a load balancer by replaying the
+// stores of its objects and by restoring a snapshot: the startup time,
+// the resident memory after the startup and the time (and memory) of
+// the first lookups, which fault in the pages of the snapshot
+void benchmark_snapshot() {
+	char** keys = benchmark_generate_keys(BENCHMARK_SNAPSHOT_KEYS);
+	char path[] = "/tmp/benchmark_snapshotXXXXXX";
+	int fd = mkstemp(path);
+	DIE(fd < 0, "mkstemp");
+	close(fd);
+
+	load_balancer* main_server = init_load_balancer();
+	for (int i = 0; i < BENCHMARK_SNAPSHOT_SERVERS; i++)
+		loader_add_server(main_server, i);
+	benchmark_snapshot_fill(main_server, keys);
+	double start = benchmark_now();
+	loader_save_snapshot(main_server, path);
+	double save_time = benchmark_now() - start;
+	free_load_balancer(main_server);
+
+	struct stat status;
+	DIE(stat(path, &status) < 0, "stat");
+	printf("%d objects, snapshot of %.0f MB written in %.0f ms\n",
+		   BENCHMARK_SNAPSHOT_KEYS, status.st_size / (double)(1 << 20),
+		   save_time / 1e6);
+	printf("%10s %12s %10s %14s %12s\n", "startup", "startup ms", "RSS MB",
+		   "lookup ns", "RSS MB");
+
+	for (int restored = 0; restored < 2; restored++) {
+		double rss = benchmark_rss();
+		start = benchmark_now();
+		if (restored) {
+			load_balancer_config config;
+			default_load_balancer_config(&config);
+			main_server = loader_restore_snapshot(&config, path);
+		} else {
+			main_server = init_load_balancer();
+			for (int i = 0; i < BENCHMARK_SNAPSHOT_SERVERS; i++)
+				loader_add_server(main_server, i);
+			benchmark_snapshot_fill(main_server, keys);
+		}
+		double startup_time = benchmark_now() - start;
+		double startup_rss = benchmark_rss() - rss;
+
+		// the first lookups of random keys, checking their values
+		start = benchmark_now();
+		for (int i = 0; i < BENCHMARK_SNAPSHOT_LOOKUPS; i++) {
+			int index = rand() % BENCHMARK_SNAPSHOT_KEYS;
+			int server_id;
+			char* value = loader_retrieve(main_server, keys[index],
+										  &server_id);
+			DIE(value == NULL || atoi(value) != index, "wrong value");
+		}
+		double lookup_time = (benchmark_now() - start) /
+							 BENCHMARK_SNAPSHOT_LOOKUPS;
+
+		printf("%10s %12.1f %10.1f %14.1f %12.1f\n",
+			   restored ? "restore" : "replay", startup_time / 1e6,
+			   startup_rss, lookup_time, benchmark_rss() - rss);
+		free_load_balancer(main_server);
+	}
+
+	unlink(path);
+	benchmark_free_keys(keys, BENCHMARK_SNAPSHOT_KEYS);
+}
+
+// function run by each thread of the write-ahead log benchmark, which
+// stores its share of the operations
+void* wal_worker(void* arg) {
+	benchmark_thread* thread = arg;
+
+	for (int i = 0; i < thread->operations; i++) {
+		char* key = thread->keys[(thread->id * thread->operations + i) %
+								 BENCHMARK_WAL_KEYS];
+		int server_id;
+		loader_store(thread->main_server, key, key, &server_id);
+	}
+
+	return NULL;
+}
+
+// benchmark which measures the stores per second of a thread safe load
+// balancer with a write-ahead log, for each sync policy, with one thread
+// and with BENCHMARK_WAL_THREADS threads (whose records share the syncs)
+void benchmark_wal() {
+	wal_sync_policy policies[] = {WAL_SYNC_NONE, WAL_SYNC_GROUP,
+								  WAL_SYNC_GROUP, WAL_SYNC_ALWAYS};
+	unsigned int group_sizes[] = {0, 64, 1024, 0};
+	char* names[] = {"none", "group 64", "group 1024", "always"};
+	char** keys = benchmark_generate_keys(BENCHMARK_WAL_KEYS);
+
+	printf("%12s %8s %12s %12s %14s\n", "sync", "threads", "operations",
+		   "ops/s", "records/sync");
+
+	for (int p = 0; p < (int)(sizeof(policies) / sizeof(wal_sync_policy));
+		 p++) {
+		for (int no_threads = 1; no_threads <= BENCHMARK_WAL_THREADS;
+			 no_threads *= BENCHMARK_WAL_THREADS) {
+			char path[] = "/tmp/benchmark_walXXXXXX";
+			int fd = mkstemp(path);
+			DIE(fd < 0, "mkstemp");
+			close(fd);
+
+			load_balancer_config config;
+			default_load_balancer_config(&config);
+			config.thread_safe = 1;
+			default_wal_config(&config.wal, path);
+			config.wal.sync = policies[p];
+			config.wal.group_size = group_sizes[p];
+			load_balancer* main_server = init_load_balancer_config(&config);
+			for (int i = 0; i < BENCHMARK_WAL_SERVERS; i++)
+				loader_add_server(main_server, i);
+
+			// each operation of the last policy waits for a sync
+			int operations = policies[p] == WAL_SYNC_ALWAYS ?
+							 BENCHMARK_WAL_SYNCED_OPERATIONS :
+							 BENCHMARK_WAL_OPERATIONS;
+			write_ahead_log* log = loader_get_wal(main_server);
+			unsigned long long syncs = log->syncs;
+			unsigned long long records = log->appended;
+
+			benchmark_thread threads[BENCHMARK_WAL_THREADS];
+			double start = benchmark_now();
+			for (int t = 0; t < no_threads; t++) {
+				threads[t].main_server = main_server;
+				threads[t].id = t;
+				threads[t].keys = keys;
+				threads[t].operations = operations / no_threads;
+				DIE(pthread_create(&threads[t].thread, NULL, wal_worker,
+								   &threads[t]), "pthread_create");
+			}
+			for (int t = 0; t < no_threads; t++)
+				pthread_join(threads[t].thread, NULL);
+			double elapsed = benchmark_now() - start;
+
+			// the syncs of the group policy are counted up to the end
+			// of the operations
+			records = log->appended - records;
+			syncs = log->syncs - syncs;
+			printf("%12s %8d %12d %12.0f %14.1f\n", names[p], no_threads,
+				   operations, operations / elapsed * 1e9,
+				   syncs ? (double)records / syncs : 0.0);
+
+			free_load_balancer(main_server);
+			unlink(path);
+		}
+	}
+
+	benchmark_free_keys(keys, BENCHMARK_WAL_KEYS);
+}
+
+// function which returns the indices of a sequence of reads whose keys
+// follow a Zipfian distribution (key i is read with a probability
+// proportional to 1 / (i + 1)^theta)
+unsigned int* benchmark_zipf_reads(int no_keys, int no_reads, double theta)
+{
+	double* cumulative = malloc(no_keys * sizeof(double));
+	unsigned int* reads = malloc(no_reads * sizeof(unsigned int));
+	DIE(cumulative == NULL || reads == NULL, "Error");
+
+	double sum = 0;
+	for (int i = 0; i < no_keys; i++) {
+		sum += 1 / pow(i + 1, theta);
+		cumulative[i] = sum;
+	}
+
+	// the key of each read is found by binary search in the cumulative
+	// weights
+	for (int i = 0; i < no_reads; i++) {
+		double target = (double)rand() / RAND_MAX * sum;
+		int left = 0, right = no_keys - 1;
+		while (left < right) {
+			int middle = (left + right) / 2;
+			if (cumulative[middle] < target)
+				left = middle + 1;
+			else
+				right = middle;
+		}
+		reads[i] = left;
+	}
+
+	free(cumulative);
+	return reads;
+}
+
+// function which checks that least loaded reads are spread evenly over
+// two replicas of very different weights: each key is on both servers,
+// so each of them should answer half of the reads, whatever its number
+// of labels
+void benchmark_replication_weights(char** keys, unsigned int* reads) {
+	load_balancer_config config;
+	default_load_balancer_config(&config);
+	config.replication_factor = 2;
+	config.replica_reads = REPLICA_READ_LEAST_LOADED;
+	load_balancer* main_server = init_load_balancer_config(&config);
+	loader_add_server_weighted(main_server, 0, 1);
+	loader_add_server_weighted(main_server, 1, 20);
+
+	int server_id;
+	for (int j = 0; j < BENCHMARK_REPLICATION_KEYS; j++)
+		loader_store(main_server, keys[j], keys[j], &server_id);
+
+	unsigned int server_reads[2] = {0, 0};
+	for (int j = 0; j < BENCHMARK_REPLICATION_READS; j++) {
+		benchmark_sink += loader_retrieve(main_server, keys[reads[j]],
+										  &server_id) != NULL;
+		server_reads[server_id]++;
+	}
+
+	double share = (double)server_reads[1] / BENCHMARK_REPLICATION_READS;
+	printf("weights 1 and 20, least loaded: %.3f of the reads on the "
+		   "heavier server\n", share);
+	DIE(share < 0.45 || share > 0.55, "uneven replica reads");
+	free_load_balancer(main_server);
+}
+
+// benchmark which compares replication factors 1, 2 and 3 (with both
+// read policies) for skewed reads: store and read times, the copies
+// stored and the reads answered by the busiest server, which limits the
+// read throughput of the load balancer
+void benchmark_replication() {
+	char** keys = benchmark_generate_keys(BENCHMARK_REPLICATION_KEYS);
+	unsigned int* reads = benchmark_zipf_reads(BENCHMARK_REPLICATION_KEYS,
+											   BENCHMARK_REPLICATION_READS,
+											   BENCHMARK_REPLICATION_THETA);
+	unsigned int* server_reads = malloc(MAX_HASH * sizeof(unsigned int));
+	DIE(server_reads == NULL, "Error");
+	unsigned int factors[] = {1, 2, 2, 3, 3};
+	replica_read_policy policies[] = {
+		REPLICA_READ_ROUND_ROBIN, REPLICA_READ_ROUND_ROBIN,
+		REPLICA_READ_LEAST_LOADED, REPLICA_READ_ROUND_ROBIN,
+		REPLICA_READ_LEAST_LOADED};
+
+	printf("%d keys on %d servers, %d reads (zipf %.2f)\n",
+		   BENCHMARK_REPLICATION_KEYS, BENCHMARK_REPLICATION_SERVERS,
+		   BENCHMARK_REPLICATION_READS, BENCHMARK_REPLICATION_THETA);
+	printf("%7s %13s %10s %10s %10s %12s %10s\n", "factor", "reads",
+		   "store ns", "read ns", "copies", "busiest", "max/mean");
+
+	for (int i = 0; i < (int)(sizeof(factors) / sizeof(unsigned int));
+		 i++) {
+		load_balancer_config config;
+		default_load_balancer_config(&config);
+		config.replication_factor = factors[i];
+		config.replica_reads = policies[i];
+		load_balancer* main_server = init_load_balancer_config(&config);
+		for (int j = 0; j < BENCHMARK_REPLICATION_SERVERS; j++)
+			loader_add_server(main_server, j);
+
+		int server_id;
+		double start = benchmark_now();
+		for (int j = 0; j < BENCHMARK_REPLICATION_KEYS; j++)
+			loader_store(main_server, keys[j], keys[j], &server_id);
+		double store_time = benchmark_now() - start;
+
+		memset(server_reads, 0, MAX_HASH * sizeof(unsigned int));
+		start = benchmark_now();
+		for (int j = 0; j < BENCHMARK_REPLICATION_READS; j++) {
+			char* value = loader_retrieve(main_server, keys[reads[j]],
+										  &server_id);
+			benchmark_sink += value != NULL;
+			server_reads[server_id]++;
+		}
+		double read_time = benchmark_now() - start;
+
+		unsigned int busiest = 0;
+		for (int j = 0; j < BENCHMARK_REPLICATION_SERVERS; j++) {
+			if (server_reads[j] > busiest)
+				busiest = server_reads[j];
+		}
+		memory_stats stats;
+		loader_memory_stats(main_server, &stats);
+
+		char* policy = factors[i] == 1 ? "-" :
+					   policies[i] == REPLICA_READ_ROUND_ROBIN ?
+					   "round robin" : "least loaded";
+		printf("%7u %13s %10.1f %10.1f %10u %12u %10.2f\n", factors[i],
+			   policy,
+			   store_time / BENCHMARK_REPLICATION_KEYS,
+			   read_time / BENCHMARK_REPLICATION_READS, stats.total_keys,
+			   busiest, (double)busiest * BENCHMARK_REPLICATION_SERVERS /
+			   BENCHMARK_REPLICATION_READS);
+		free_load_balancer(main_server);
+	}
+
+	benchmark_replication_weights(keys, reads);
+	free(server_reads);
+	free(reads);
+	benchmark_free_keys(keys, BENCHMARK_REPLICATION_KEYS);
+}
+
+// function which reads keys of a load balancer with a front cache and
+// prints the time per read and the hit ratio; with scan set, every other
+// read is a key of a scan which reads each key once, in order
+void benchmark_cache_reads(load_balancer* main_server, char** keys,
+						   unsigned int* reads, char* name, int scan,
+						   unsigned int size)
+{
+	int server_id;
+	double start = benchmark_now();
+	for (int i = 0; i < BENCHMARK_CACHE_READS; i++) {
+		char* key = scan && i % 2 ? keys[i / 2 % BENCHMARK_CACHE_KEYS]
+								  : keys[reads[i]];
+		benchmark_sink += loader_retrieve(main_server, key,
+										  &server_id) != NULL;
+	}
+	double elapsed = benchmark_now() - start;
+
+	front_cache* cache = loader_get_front_cache(main_server);
+	unsigned long long hits = cache ? cache->hits : 0;
+	printf("%12s %8u %10.1f %10.3f %12llu %12llu\n", name, size,
+		   elapsed / BENCHMARK_CACHE_READS,
+		   (double)hits / BENCHMARK_CACHE_READS, cache ? cache->admitted : 0,
+		   cache ? cache->rejected : 0);
+}
+
+// benchmark which compares reading keys from a load balancer without a
+// front cache and with front caches of several sizes, for Zipfian keys,
+// for Zipfian keys mixed with a scan of all the keys and for a hot set
+// of keys read uniformly
+void benchmark_cache() {
+	char** keys = benchmark_generate_keys(BENCHMARK_CACHE_KEYS);
+	unsigned int* reads = benchmark_zipf_reads(BENCHMARK_CACHE_KEYS,
+											   BENCHMARK_CACHE_READS,
+											   BENCHMARK_CACHE_THETA);
+	unsigned int* hot_reads = malloc(BENCHMARK_CACHE_READS *
+									 sizeof(unsigned int));
+	DIE(hot_reads == NULL, "Error");
+	for (int i = 0; i < BENCHMARK_CACHE_READS; i++)
+		hot_reads[i] = rand() % BENCHMARK_CACHE_HOT_KEYS;
+	unsigned int sizes[] = {0, 4096, 16384, 65536};
+	char* names[] = {"zipf", "zipf + scan", "hot set"};
+
+	printf("%d keys on %d servers, %d reads (zipf %.2f, hot set of %d "
+		   "keys)\n", BENCHMARK_CACHE_KEYS, BENCHMARK_CACHE_SERVERS,
+		   BENCHMARK_CACHE_READS, BENCHMARK_CACHE_THETA,
+		   BENCHMARK_CACHE_HOT_KEYS);
+	printf("%12s %8s %10s %10s %12s %12s\n", "reads", "cache", "read ns",
+		   "hit ratio", "admitted", "rejected");
+
+	for (int workload = 0; workload < 3; workload++) {
+		for (int i = 0; i < (int)(sizeof(sizes) / sizeof(unsigned int));
+			 i++) {
+			load_balancer_config config;
+			default_load_balancer_config(&config);
+			config.front_cache_size = sizes[i];
+			load_balancer* main_server = init_load_balancer_config(&config);
+			for (int j = 0; j < BENCHMARK_CACHE_SERVERS; j++)
+				loader_add_server(main_server, j);
+
+			int server_id;
+			for (int j = 0; j < BENCHMARK_CACHE_KEYS; j++)
+				loader_store(main_server, keys[j], keys[j], &server_id);
+
+			benchmark_cache_reads(main_server, keys, workload == 2 ?
+								  hot_reads : reads, names[workload],
+								  workload == 1, sizes[i]);
+			free_load_balancer(main_server);
+		}
+	}
+
+	free(hot_reads);
+	free(reads);
+	benchmark_free_keys(keys, BENCHMARK_CACHE_KEYS);
+}
+
+// function which reads keys of which the given percentage is missing
+// and prints the time per read and the false positive rate of the filters
+void benchmark_filter_reads(load_balancer* main_server, char** keys,
+							char** missing, char* name, char* backend,
+							int miss_percent)
+{
+	filter_stats before;
+	loader_filter_stats(main_server, &before);
+
+	int server_id;
+	double start = benchmark_now();
+	for (int i = 0; i < BENCHMARK_FILTER_READS; i++) {
+		int index = rand() % BENCHMARK_FILTER_KEYS;
+		char* key = rand() % 100 < miss_percent ? missing[index]
+												: keys[index];
+		benchmark_sink += loader_retrieve(main_server, key,
+										  &server_id) != NULL;
+	}
+	double elapsed = benchmark_now() - start;
+
+	filter_stats stats;
+	loader_filter_stats(main_server, &stats);
+	unsigned long long negatives = stats.negatives - before.negatives;
+	unsigned long long false_positives = stats.false_positives -
+										 before.false_positives;
+	unsigned long long misses = negatives + false_positives;
+	printf("%10s %10s %8d %10.1f %12.5f %12.2f\n", name, backend,
+		   miss_percent, elapsed / BENCHMARK_FILTER_READS,
+		   misses ? (double)false_positives / misses : 0,
+		   (double)stats.bytes / BENCHMARK_FILTER_KEYS);
+}
+
+// benchmark of the lookups of missing keys, which are answered by the
+// filters of the servers, before and after servers are added
+void benchmark_filter() {
+	server_backend backends[] = {SERVER_BACKEND_CHAINED, SERVER_BACKEND_FLAT};
+	char* backend_names[] = {"chained", "flat"};
+	char** keys = benchmark_generate_keys(BENCHMARK_FILTER_KEYS);
+	char** missing = benchmark_generate_keys(BENCHMARK_FILTER_KEYS);
+	int miss_percents[] = {0, 50, 90};
+
+	// the missing keys get a prefix which is never stored
+	for (int i = 0; i < BENCHMARK_FILTER_KEYS; i++)
+		missing[i][0] = 'K';
+
+	printf("%d keys on %d servers (then %d more), %d reads\n",
+		   BENCHMARK_FILTER_KEYS, BENCHMARK_FILTER_SERVERS,
+		   BENCHMARK_FILTER_ADDED_SERVERS, BENCHMARK_FILTER_READS);
+	printf("%10s %10s %8s %10s %12s %12s\n", "servers", "backend",
+		   "miss %", "read ns", "false pos", "filter B/key");
+
+	for (int b = 0; b < (int)(sizeof(backends) / sizeof(server_backend));
+		 b++) {
+		load_balancer_config config;
+		default_load_balancer_config(&config);
+		config.backend = backends[b];
+		load_balancer* main_server = init_load_balancer_config(&config);
+		for (int i = 0; i < BENCHMARK_FILTER_SERVERS; i++)
+			loader_add_server(main_server, i);
+
+		int server_id;
+		for (int i = 0; i < BENCHMARK_FILTER_KEYS; i++)
+			loader_store(main_server, keys[i], keys[i], &server_id);
+
+		for (int i = 0; i < (int)(sizeof(miss_percents) / sizeof(int)); i++)
+			benchmark_filter_reads(main_server, keys, missing, "initial",
+								   backend_names[b], miss_percents[i]);
+
+		// the filters follow the objects moved on the added servers
+		for (int i = 0; i < BENCHMARK_FILTER_ADDED_SERVERS; i++)
+			loader_add_server(main_server, BENCHMARK_FILTER_SERVERS + i);
+		benchmark_filter_reads(main_server, keys, missing, "added",
+							   backend_names[b], 90);
+
+		free_load_balancer(main_server);
+	}
+
+	benchmark_free_keys(missing, BENCHMARK_FILTER_KEYS);
+	benchmark_free_keys(keys, BENCHMARK_FILTER_KEYS);
+}
+
+// fake clock of the ttl benchmark, which advances with the stores
+unsigned long long benchmark_clock_ms;
+
+// function which returns the time of the fake clock
+unsigned long long benchmark_clock() {
+	return benchmark_clock_ms;
+}
+
+// benchmark of a session workload, in which each key is stored once and
+// read back shortly after: without a time to live the servers keep all
+// the keys, with one they keep the keys of the last BENCHMARK_TTL_MS ms
+void benchmark_ttl() {
+	server_backend backends[] = {SERVER_BACKEND_CHAINED, SERVER_BACKEND_FLAT};
+	char* backend_names[] = {"chained", "flat"};
+	char** keys = benchmark_generate_keys(BENCHMARK_TTL_STORES);
+
+	printf("%d session stores on %d servers (%d more halfway), "
+		   "%d stores per ms, ttl %d ms\n", BENCHMARK_TTL_STORES,
+		   BENCHMARK_TTL_SERVERS, BENCHMARK_TTL_ADDED_SERVERS,
+		   BENCHMARK_TTL_STORES_PER_MS, BENCHMARK_TTL_MS);
+	printf("%10s %10s %10s %10s %12s %10s\n", "ttl", "backend", "op ns",
+		   "live keys", "MB used", "expired");
+
+	for (int b = 0; b < (int)(sizeof(backends) / sizeof(server_backend));
+		 b++) {
+		for (int ttl = 0; ttl <= BENCHMARK_TTL_MS; ttl += BENCHMARK_TTL_MS) {
+			load_balancer_config config;
+			default_load_balancer_config(&config);
+			config.backend = backends[b];
+			config.clock = benchmark_clock;
+			benchmark_clock_ms = 1;
+			load_balancer* main_server = init_load_balancer_config(&config);
+			for (int i = 0; i < BENCHMARK_TTL_SERVERS; i++)
+				loader_add_server(main_server, i);
+
+			// each store is followed by a read of a recent key
+			int server_id;
+			double start = benchmark_now();
+			for (int i = 0; i < BENCHMARK_TTL_STORES; i++) {
+				if (i % BENCHMARK_TTL_STORES_PER_MS == 0)
+					benchmark_clock_ms++;
+				if (i == BENCHMARK_TTL_STORES / 2) {
+					for (int j = 0; j < BENCHMARK_TTL_ADDED_SERVERS; j++)
+						loader_add_server(main_server,
+										  BENCHMARK_TTL_SERVERS + j);
+				}
+
+				if (ttl)
+					loader_store_expiring(main_server, keys[i], keys[i], ttl,
+										  &server_id);
+				else
+					loader_store(main_server, keys[i], keys[i], &server_id);
+				benchmark_sink += loader_retrieve(main_server,
+												  keys[i - i % 64],
+												  &server_id) != NULL;
+			}
+			loader_expire(main_server);
+			double elapsed = benchmark_now() - start;
+
+			memory_stats stats;
+			loader_memory_stats(main_server, &stats);
+			printf("%10d %10s %10.1f %10u %12.2f %10llu\n", ttl,
+				   backend_names[b], elapsed / BENCHMARK_TTL_STORES,
+				   stats.total_keys, stats.bytes_used / 1048576.0,
+				   stats.expired);
+
+			free_load_balancer(main_server);
+		}
+	}
+
+	benchmark_free_keys(keys, BENCHMARK_TTL_STORES);
+}
+
+// function which runs the Zipfian reads of a cache tier on servers with
+// the given budget (0 if unlimited): a missed key is stored, as a read
+// through cache does; it prints the hit ratio and the evictions and
+// returns the bytes used at the end
+size_t benchmark_budget_reads(server_backend backend, char* backend_name,
+							  char** keys, unsigned int* reads,
+							  int percent, size_t budget)
+{
+	load_balancer_config config;
+	default_load_balancer_config(&config);
+	config.backend = backend;
+	config.server_budget = budget;
+	load_balancer* main_server = init_load_balancer_config(&config);
+	for (int i = 0; i < BENCHMARK_BUDGET_SERVERS; i++)
+		loader_add_server(main_server, i);
+
+	int server_id;
+	unsigned int hits = 0;
+	double start = benchmark_now();
+	for (int i = 0; i < BENCHMARK_BUDGET_READS; i++) {
+		char* key = keys[reads[i]];
+		if (loader_retrieve(main_server, key, &server_id) != NULL)
+			hits++;
+		else
+			loader_store(main_server, key, key, &server_id);
+	}
+	double elapsed = benchmark_now() - start;
+
+	memory_stats stats;
+	loader_memory_stats(main_server, &stats);
+	printf("%10d %10s %10.1f %10.4f %10u %12.2f %12llu\n", percent,
+		   backend_name, elapsed / BENCHMARK_BUDGET_READS,
+		   (double)hits / BENCHMARK_BUDGET_READS, stats.total_keys,
+		   stats.bytes_used / 1048576.0, stats.evicted);
+
+	free_load_balancer(main_server);
+	return stats.bytes_used;
+}
+
+// benchmark of the load balancer used as a cache tier: Zipfian reads
+// through servers whose budgets hold all the keys and 50%, 20% and 5%
+// of them
+void benchmark_budget() {
+	server_backend backends[] = {SERVER_BACKEND_CHAINED, SERVER_BACKEND_FLAT};
+	char* backend_names[] = {"chained", "flat"};
+	char** keys = benchmark_generate_keys(BENCHMARK_BUDGET_KEYS);
+	unsigned int* reads = benchmark_zipf_reads(BENCHMARK_BUDGET_KEYS,
+											   BENCHMARK_BUDGET_READS,
+											   BENCHMARK_BUDGET_THETA);
+	int percents[] = {50, 20, 5};
+
+	printf("%d keys on %d servers, %d Zipfian reads (theta %.2f)\n",
+		   BENCHMARK_BUDGET_KEYS, BENCHMARK_BUDGET_SERVERS,
+		   BENCHMARK_BUDGET_READS, BENCHMARK_BUDGET_THETA);
+	printf("%10s %10s %10s %10s %10s %12s %12s\n", "budget %", "backend",
+		   "op ns", "hit ratio", "keys", "MB used", "evicted");
+
+	for (int b = 0; b < (int)(sizeof(backends) / sizeof(server_backend));
+		 b++) {
+		// the budgets are shares of the bytes of all the keys
+		size_t total = benchmark_budget_reads(backends[b], backend_names[b],
+											  keys, reads, 100, 0);
+		for (int i = 0; i < (int)(sizeof(percents) / sizeof(int)); i++)
+			benchmark_budget_reads(backends[b], backend_names[b], keys,
+								   reads, percents[i], total / 100 *
+								   percents[i] / BENCHMARK_BUDGET_SERVERS);
+	}
+
+	free(reads);
+	benchmark_free_keys(keys, BENCHMARK_BUDGET_KEYS);
+}
+
+// function which generates a JSON document of about the given length: an
+// array of records, with the repeated field names and the small variety
+// of values of an API response
+char* benchmark_json_value(int length) {
+	static char* names[] = {"alice", "bob", "carol", "dave", "erin", "frank"};
+	static char* states[] = {"active", "pending", "suspended"};
+	char* value = malloc(length + 256);
+	DIE(value == NULL, "Error");
+
+	int written = sprintf(value, "[");
+	for (int i = 0; written < length; i++) {
+		char* name = names[rand() % 6];
+		written += sprintf(value + written, "%s{\"id\":%d,\"user\":\"%s%d\","
+						   "\"email\":\"%s%d@example.com\",\"status\":"
+						   "\"%s\",\"score\":%d.%02d,\"tags\":[\"t%d\","
+						   "\"t%d\"]}", i ? "," : "", rand() % 100000,
+						   name, rand() % 1000, name, rand() % 1000,
+						   states[rand() % 3], rand() % 100, rand() % 100,
+						   rand() % 16, rand() % 16);
+	}
+	sprintf(value + written, "]");
+
+	return value;
+}
+
+// function which generates random printable bytes, which don't compress
+char* benchmark_random_value(int length) {
+	char* value = malloc(length + 1);
+	DIE(value == NULL, "Error");
+
+	for (int i = 0; i < length; i++)
+		value[i] = '!' + rand() % 94;
+	value[length] = '\0';
+
+	return value;
+}
+
+// function which stores the values with the given compression threshold
+// (0 if the values aren't compressed), then copies them back at random;
+// it prints the times of the operations and the compression ratio of all
+// the values
+void benchmark_compress_run(char* payload, char** keys, char** values,
+							size_t total, unsigned int* reads,
+							unsigned int threshold)
+{
+	load_balancer_config config;
+	default_load_balancer_config(&config);
+	config.pack_threshold = threshold;
+	load_balancer* main_server = init_load_balancer_config(&config);
+	for (int i = 0; i < BENCHMARK_COMPRESS_SERVERS; i++)
+		loader_add_server(main_server, i);
+
+	int server_id;
+	double start = benchmark_now();
+	for (int i = 0; i < BENCHMARK_COMPRESS_KEYS; i++)
+		loader_store(main_server, keys[i], values[i], &server_id);
+	double store = benchmark_now() - start;
+
+	char* buffer = malloc(BENCHMARK_COMPRESS_MAX_VALUE + 512);
+	DIE(buffer == NULL, "Error");
+	start = benchmark_now();
+	for (int i = 0; i < BENCHMARK_COMPRESS_READS; i++)
+		benchmark_sink += loader_retrieve_copy(main_server, keys[reads[i]],
+											   buffer,
+											   BENCHMARK_COMPRESS_MAX_VALUE +
+											   512, &server_id);
+	double copy = benchmark_now() - start;
+	free(buffer);
+
+	// the values which weren't packed are stored as they are
+	memory_stats stats;
+	loader_memory_stats(main_server, &stats);
+	size_t stored = total - stats.unpacked_bytes + stats.packed_bytes;
+	printf("%10s %10u %10.1f %10.1f %10.2f %10u %12.2f\n", payload,
+		   threshold, store / BENCHMARK_COMPRESS_KEYS,
+		   copy / BENCHMARK_COMPRESS_READS, (double)total / stored,
+		   stats.packed, stats.bytes_used / 1048576.0);
+
+	free_load_balancer(main_server);
+}
+
+// benchmark of the compression of the values: JSON documents and random
+// bytes of BENCHMARK_COMPRESS_MIN_VALUE to BENCHMARK_COMPRESS_MAX_VALUE
+// bytes, stored as they are and compressed
+void benchmark_compress() {
+	char** keys = benchmark_generate_keys(BENCHMARK_COMPRESS_KEYS);
+	unsigned int* reads = malloc(BENCHMARK_COMPRESS_READS *
+								 sizeof(unsigned int));
+	DIE(reads == NULL, "Error");
+	for (int i = 0; i < BENCHMARK_COMPRESS_READS; i++)
+		reads[i] = rand() % BENCHMARK_COMPRESS_KEYS;
+
+	printf("%d values of %d to %d bytes on %d servers, %d copies\n",
+		   BENCHMARK_COMPRESS_KEYS, BENCHMARK_COMPRESS_MIN_VALUE,
+		   BENCHMARK_COMPRESS_MAX_VALUE, BENCHMARK_COMPRESS_SERVERS,
+		   BENCHMARK_COMPRESS_READS);
+	printf("%10s %10s %10s %10s %10s %10s %12s\n", "payload", "threshold",
+		   "store ns", "copy ns", "ratio", "packed", "MB used");
+
+	char* payloads[] = {"json", "random"};
+	for (int p = 0; p < 2; p++) {
+		char** values = malloc(BENCHMARK_COMPRESS_KEYS * sizeof(char*));
+		DIE(values == NULL, "Error");
+		size_t total = 0;
+		for (int i = 0; i < BENCHMARK_COMPRESS_KEYS; i++) {
+			int length = BENCHMARK_COMPRESS_MIN_VALUE + rand() %
+						 (BENCHMARK_COMPRESS_MAX_VALUE -
+						  BENCHMARK_COMPRESS_MIN_VALUE + 1);
+			values[i] = p ? benchmark_random_value(length) :
+						benchmark_json_value(length);
+			total += strlen(values[i]) + 1;
+		}
+
+		benchmark_compress_run(payloads[p], keys, values, total, reads, 0);
+		benchmark_compress_run(payloads[p], keys, values, total, reads,
+							   BENCHMARK_COMPRESS_THRESHOLD);
+
+		benchmark_free_keys(values, BENCHMARK_COMPRESS_KEYS);
+	}
+
+	free(reads);
+	benchmark_free_keys(keys, BENCHMARK_COMPRESS_KEYS);
+}
+
+// element of the lists of the containers benchmark, like a bucket entry
+// of a server: the links are inside the element
+typedef struct bench_item bench_item;
+struct bench_item {
+	INTRUSIVE_LINK(bench_item) link;
+	unsigned int key;
+	unsigned int value;
+};
+
+// data copied in the nodes of the generic lists
+typedef struct bench_pair bench_pair;
+struct bench_pair {
+	unsigned int key;
+	unsigned int value;
+};
+
+// function which returns 1 if the element has the given key
+static inline int bench_item_matches(const bench_item* item,
+									 unsigned int key) {
+	return item->key == key;
+}
+
+INTRUSIVE_LIST_TYPE(bench_list, bench_item);
+INTRUSIVE_LIST_FUNCTIONS(bench_list, bench_item, link, unsigned int,
+						 bench_item_matches)
+
+// function which returns the node of a generic list which has the given
+// key and its position, or NULL if there isn't one
+cdll_node* benchmark_cdll_find(cdll_list* list, unsigned int key,
+							   int* position) {
+	cdll_node* current = list->head;
+
+	for (int i = 0; i < (int)list->size; i++) {
+		if (((bench_pair*)current->data)->key == key) {
+			*position = i;
+			return current;
+		}
+		current = current->next;
+	}
+
+	return NULL;
+}
+
+// function which runs the inserts, lookups and removals of the keys in
+// generic lists of the given length, as the buckets used to do: each
+// insert allocates a node and a copy of the pair, each removal finds the
+// position of the key, then walks the list again to unlink it
+void benchmark_containers_cdll(unsigned int* order, int no_lists,
+							   double* times) {
+	cdll_list** lists = malloc(no_lists * sizeof(cdll_list*));
+	DIE(lists == NULL, "Error");
+	for (int i = 0; i < no_lists; i++)
+		lists[i] = create_list(sizeof(bench_pair));
+
+	double start = benchmark_now();
+	for (int i = 0; i < BENCHMARK_CONTAINERS_ELEMENTS; i++) {
+		bench_pair pair = {i, i};
+		add_node(lists[i % no_lists], lists[i % no_lists]->size, &pair);
+	}
+	times[0] = benchmark_now() - start;
+
+	unsigned long checksum = 0;
+	start = benchmark_now();
+	for (int i = 0; i < BENCHMARK_CONTAINERS_ELEMENTS; i++) {
+		int position;
+		cdll_node* node = benchmark_cdll_find(lists[order[i] % no_lists],
+											  order[i], &position);
+		checksum += ((bench_pair*)node->data)->value;
+	}
+	times[1] = benchmark_now() - start;
+
+	start = benchmark_now();
+	for (int i = 0; i < BENCHMARK_CONTAINERS_ELEMENTS; i++) {
+		cdll_list* list = lists[order[i] % no_lists];
+		int position = 0;
+		benchmark_cdll_find(list, order[i], &position);
+		cdll_node* node = remove_node(list, position);
+		checksum += ((bench_pair*)node->data)->value;
+		free(node->data);
+		free(node);
+	}
+	times[2] = benchmark_now() - start;
+	benchmark_sink = checksum;
+
+	for (int i = 0; i < no_lists; i++)
+		cdll_free(&lists[i]);
+	free(lists);
+}
+
+// function which runs the same operations in intrusive lists, whose
+// elements are allocated in a single block, as the arena of a server does
+void benchmark_containers_intrusive(unsigned int* order, int no_lists,
+									double* times) {
+	bench_list* lists = calloc(no_lists, sizeof(bench_list));
+	DIE(lists == NULL, "Error");
+	bench_item* items = malloc(BENCHMARK_CONTAINERS_ELEMENTS *
+							   sizeof(bench_item));
+	DIE(items == NULL, "Error");
+
+	double start = benchmark_now();
+	for (int i = 0; i < BENCHMARK_CONTAINERS_ELEMENTS; i++) {
+		items[i].key = i;
+		items[i].value = i;
+		bench_list_push_back(&lists[i % no_lists], &items[i]);
+	}
+	times[0] = benchmark_now() - start;
+
+	unsigned long checksum = 0;
+	start = benchmark_now();
+	for (int i = 0; i < BENCHMARK_CONTAINERS_ELEMENTS; i++)
+		checksum += bench_list_find(&lists[order[i] % no_lists],
+									order[i])->value;
+	times[1] = benchmark_now() - start;
+
+	start = benchmark_now();
+	for (int i = 0; i < BENCHMARK_CONTAINERS_ELEMENTS; i++) {
+		bench_list* list = &lists[order[i] % no_lists];
+		bench_item* item = bench_list_find(list, order[i]);
+		bench_list_remove(list, item);
+		checksum += item->value;
+	}
+	times[2] = benchmark_now() - start;
+	benchmark_sink = checksum;
+
+	free(items);
+	free(lists);
+}
+
+// benchmark which compares the generic cdll with the intrusive lists
+// used for the buckets of the servers, for several list lengths: time
+// per insert, per lookup and per removal of a key, in random order
+void benchmark_containers() {
+	int lengths[] = {1, 2, 8, 32};
+	unsigned int* order = malloc(BENCHMARK_CONTAINERS_ELEMENTS *
+								 sizeof(unsigned int));
+	DIE(order == NULL, "Error");
+	for (int i = 0; i < BENCHMARK_CONTAINERS_ELEMENTS; i++)
+		order[i] = i;
+	for (int i = BENCHMARK_CONTAINERS_ELEMENTS - 1; i > 0; i--) {
+		int j = rand() % (i + 1);
+		unsigned int aux = order[i];
+		order[i] = order[j];
+		order[j] = aux;
+	}
+
+	printf("%d elements in lists of %d to %d elements\n",
+		   BENCHMARK_CONTAINERS_ELEMENTS, lengths[0], lengths[3]);
+	printf("%10s %10s %10s %10s %10s\n", "length", "list", "insert ns",
+		   "lookup ns", "remove ns");
+
+	for (int l = 0; l < (int)(sizeof(lengths) / sizeof(int)); l++) {
+		int no_lists = BENCHMARK_CONTAINERS_ELEMENTS / lengths[l];
+		double times[2][3];
+		benchmark_containers_cdll(order, no_lists, times[0]);
+		benchmark_containers_intrusive(order, no_lists, times[1]);
+
+		char* names[] = {"cdll", "intrusive"};
+		for (int c = 0; c < 2; c++)
+			printf("%10d %10s %10.1f %10.1f %10.1f\n", lengths[l], names[c],
+				   times[c][0] / BENCHMARK_CONTAINERS_ELEMENTS,
+				   times[c][1] / BENCHMARK_CONTAINERS_ELEMENTS,
+				   times[c][2] / BENCHMARK_CONTAINERS_ELEMENTS);
+	}
+
+	free(order);
+}
+
+// in main, run the benchmark given as command line parameter
+int main(int argc, char* argv[]) {
+	if (argc != 2) {
+		printf("Usage:%s ring|distribution|backend|scaleout|memory|batch|"
+			   "stress|threads|routing|bounded|hash|replay|snapshot|wal|"
+			   "replication|cache|filter|ttl|budget|compress|containers|"
+			   "large|keys|commands\n",
+			   argv[0]);
+		return -1;
+	}
+
+	srand(42);
+
+	if (!strcmp(argv[1], "ring")) {
+		benchmark_ring();
+	} else if (!strcmp(argv[1], "distribution")) {
+		benchmark_distribution();
+	} else if (!strcmp(argv[1], "backend")) {
+		benchmark_backend();
+	} else if (!strcmp(argv[1], "scaleout")) {
+		benchmark_scaleout();
+	} else if (!strcmp(argv[1], "memory")) {
+		benchmark_memory();
+	} else if (!strcmp(argv[1], "batch")) {
+		benchmark_batch();
+	} else if (!strcmp(argv[1], "stress")) {
+		benchmark_stress();
+	} else if (!strcmp(argv[1], "threads")) {
+		benchmark_threads();
+	} else if (!strcmp(argv[1], "routing")) {
+		benchmark_routing();
+	} else if (!strcmp(argv[1], "bounded")) {
+		benchmark_bounded();
+	} else if (!strcmp(argv[1], "hash")) {
+		benchmark_hash();
+	} else if (!strcmp(argv[1], "replay")) {
+		benchmark_replay();
+	} else if (!strcmp(argv[1], "snapshot")) {
+		benchmark_snapshot();
+	} else if (!strcmp(argv[1], "wal")) {
+		benchmark_wal();
+	} else if (!strcmp(argv[1], "replication")) {
+		benchmark_replication();
+	} else if (!strcmp(argv[1], "cache")) {
+		benchmark_cache();
+	} else if (!strcmp(argv[1], "filter")) {
+		benchmark_filter();
+	} else if (!strcmp(argv[1], "ttl")) {
+		benchmark_ttl();
+	} else if (!strcmp(argv[1], "budget")) {
+		benchmark_budget();
+	} else if (!strcmp(argv[1], "compress")) {
+		benchmark_compress();
+	} else if (!strcmp(argv[1], "containers")) {
+		benchmark_containers();
+	} else if (!strcmp(argv[1], "large")) {
+		benchmark_large();
+	} else if (!strcmp(argv[1], "keys")) {
+		benchmark_keys();
+	} else if (!strcmp(argv[1], "commands")) {
+		benchmark_commands();
+	} else {
+		printf("Unknown benchmark %s\n", argv[1]);
+		return -1;
+	}
+
+	return 0;
+}
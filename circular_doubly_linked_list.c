@@ -176,6 +176,26 @@ cdll_node* remove_node(cdll_list* list, unsigned int n)
 	}
 }
 
+// function which adds an existing node (for example, one returned by
+// remove_node) at the end of the list, without copying its data
+void link_node_last(cdll_list* list, cdll_node* node)
+{
+	if (list->head == NULL) {
+		list->head = node;
+		list->tail = node;
+		node->next = node;
+		node->prev = node;
+	} else {
+		node->next = list->head;
+		node->prev = list->tail;
+		list->tail->next = node;
+		list->head->prev = node;
+		list->tail = node;
+	}
+
+	list->size++;
+}
+
 // function which frees the memory of a given list
 void
 cdll_free(cdll_list** pp_list)
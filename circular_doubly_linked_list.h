@@ -44,6 +44,8 @@ void add_node(cdll_list* list, unsigned int n, const void* data);
 
 cdll_node* remove_node(cdll_list* list, unsigned int n);
 
+void link_node_last(cdll_list* list, cdll_node* node);
+
 void cdll_free(cdll_list** pp_list);
 
 #endif  // CIRCULAR_DOUBLY_LINKED_LIST_H_
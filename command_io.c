@@ -0,0 +1,344 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the input and output of the command files
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "command_io.h"
+#include "command_log.h"
+#include "server.h"
+#include "utils.h"
+
+// size of the first buffer used for reading a file which can't be mapped
+#define COMMAND_READ_CHUNK (64 * 1024)
+
+// function which reads a whole file (which can't be mapped) in a buffer
+void read_command_file(command_file* input, int fd) {
+	size_t capacity = COMMAND_READ_CHUNK;
+	input->data = malloc(capacity);
+	DIE(input->data == NULL, "Error");
+	input->size = 0;
+	input->mapped = 0;
+
+	for (;;) {
+		if (input->size == capacity) {
+			capacity *= 2;
+			input->data = realloc(input->data, capacity);
+			DIE(input->data == NULL, "Error");
+		}
+
+		ssize_t count = read(fd, input->data + input->size,
+							 capacity - input->size);
+		DIE(count < 0, "read");
+		if (count == 0)
+			break;
+		input->size += count;
+	}
+}
+
+// function which maps a regular command file, or reads any other file
+void open_command_file(command_file* input, const char* path) {
+	int fd = open(path, O_RDONLY);
+	DIE(fd < 0, "missing input file");
+
+	struct stat status;
+	DIE(fstat(fd, &status) < 0, "fstat");
+
+	// an empty file can't be mapped, but it has nothing to read either
+	if (!S_ISREG(status.st_mode) || status.st_size == 0) {
+		read_command_file(input, fd);
+		close(fd);
+		return;
+	}
+
+	input->size = status.st_size;
+	input->data = mmap(NULL, input->size, PROT_READ | PROT_WRITE,
+					   MAP_PRIVATE, fd, 0);
+	DIE(input->data == MAP_FAILED, "mmap");
+	input->mapped = 1;
+
+	// the file is read once, from the start to the end
+	madvise(input->data, input->size, MADV_SEQUENTIAL);
+	close(fd);
+}
+
+// function which unmaps (or frees) the content of a command file
+void close_command_file(command_file* input) {
+	if (input->mapped)
+		munmap(input->data, input->size);
+	else
+		free(input->data);
+}
+
+// function which finds the next quote or newline
+char* scan_quote_or_newline(char* position, char* end) {
+#ifdef __SSE2__
+	const __m128i quotes = _mm_set1_epi8('"');
+	const __m128i newlines = _mm_set1_epi8('\n');
+
+	while (end - position >= 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*)position);
+		int mask = _mm_movemask_epi8(
+			_mm_or_si128(_mm_cmpeq_epi8(block, quotes),
+						 _mm_cmpeq_epi8(block, newlines)));
+		if (mask != 0)
+			return position + __builtin_ctz(mask);
+		position += 16;
+	}
+#endif
+
+	// the last bytes (or all of them, without SSE2) are checked one by one
+	for (; position < end; position++) {
+		if (*position == '"' || *position == '\n')
+			return position;
+	}
+
+	return end;
+}
+
+// function which returns the end of the line starting at the given
+// position: its newline, or the end of the file
+char* line_end(char* position, char* end) {
+	char* newline = memchr(position, '\n', end - position);
+	return newline ? newline : end;
+}
+
+// function which returns the next quote of the current line
+char* next_quote(char* position, char* end) {
+	char* quote = scan_quote_or_newline(position, end);
+	DIE(quote == end || *quote != '"', "malformed request");
+	return quote;
+}
+
+// function which checks if a line starts with the given command
+int is_command(char* line, char* end, const char* name, size_t length) {
+	return (size_t)(end - line) >= length && !memcmp(line, name, length);
+}
+
+// function which reads a number of a line (after any spaces) and moves
+// the position after it; it returns -1 if the line has no other number,
+// and numbers too large for an int saturate at INT_MAX instead of
+// wrapping around to a valid id
+int parse_number(char** position, char* end) {
+	char* current = *position;
+	while (current < end && *current == ' ')
+		current++;
+	if (current == end || *current < '0' || *current > '9')
+		return -1;
+
+	int number = 0;
+	for (; current < end && *current >= '0' && *current <= '9'; current++) {
+		int digit = *current - '0';
+		number = number > (INT_MAX - digit) / 10 ? INT_MAX
+												 : 10 * number + digit;
+	}
+	*position = current;
+
+	return number;
+}
+
+// function which gets the key of a request, in place: the text between
+// the first two quotes, ended with a null byte
+char* get_key(command* request, char* position, char* end) {
+	char* key_start = next_quote(position, end) + 1;
+	char* key_finish = next_quote(key_start, end);
+	*key_finish = 0;
+
+	request->key.key = key_start;
+	request->key.length = key_finish - key_start;
+	request->key.hash = key_hash_fold(key_hash64(key_start,
+												 request->key.length));
+	return key_finish + 1;
+}
+
+// function which gets the key and value from a store request, in place:
+// the value is the text after the third quote, without the last
+// character of the line (its closing quote)
+char* get_key_value(command* request, char* position, char* end) {
+	char* value_start = next_quote(get_key(request, position, end), end) + 1;
+
+	// the value may contain quotes, so it ends with its line
+	char* finish = line_end(value_start, end);
+	DIE(finish == value_start, "malformed request");
+	finish[-1] = 0;
+
+	request->value = value_start;
+	request->value_length = finish - 1 - value_start;
+	return finish;
+}
+
+// function which reads the server id (and the optional weight) of an
+// add_server or remove_server request
+char* get_server(command* request, char* position, char* end) {
+	request->server_id = parse_number(&position, end);
+	DIE(request->server_id < 0, "malformed request");
+	DIE(request->server_id >= MAX_HASH, "server id out of range");
+
+	request->weight = parse_number(&position, end);
+	DIE(request->type == COMMAND_ADD_SERVER && request->weight == 0,
+		"a server needs at least one label");
+	return line_end(position, end);
+}
+
+// function which reads a text command and returns the end of its line
+char* read_text_command(char* position, char* end, command* request) {
+	if (is_command(position, end, "store", sizeof("store") - 1)) {
+		request->type = COMMAND_STORE;
+		return get_key_value(request, position, end);
+	}
+	if (is_command(position, end, "retrieve", sizeof("retrieve") - 1)) {
+		request->type = COMMAND_RETRIEVE;
+		return line_end(get_key(request, position, end), end);
+	}
+	if (is_command(position, end, "add_server", sizeof("add_server") - 1)) {
+		request->type = COMMAND_ADD_SERVER;
+		return get_server(request, position + sizeof("add_server") - 1,
+						  end);
+	}
+	if (is_command(position, end, "remove_server",
+				   sizeof("remove_server") - 1)) {
+		request->type = COMMAND_REMOVE_SERVER;
+		return get_server(request, position + sizeof("remove_server") - 1,
+						  end);
+	}
+
+	DIE(1, "unknown function call");
+	return end;
+}
+
+// function which initialises a reader of the commands of a file
+void init_command_reader(command_reader* reader, command_file* input) {
+	reader->position = input->data;
+	reader->end = input->data + input->size;
+	reader->binary = is_command_log(input->data, input->size);
+
+	// the records start after the header
+	if (reader->binary)
+		reader->position += COMMAND_LOG_HEADER_SIZE;
+}
+
+// function which reads the next command of a command file
+int next_command(command_reader* reader, command* request) {
+	if (reader->position >= reader->end)
+		return 0;
+
+	if (reader->binary) {
+		reader->position = read_log_command(reader->position, reader->end,
+											request);
+	} else {
+		// the line is skipped with its newline
+		reader->position = read_text_command(reader->position, reader->end,
+											 request) + 1;
+	}
+
+	return 1;
+}
+
+// function which writes a command as a text line; the keys with quotes or
+// newlines and the values with newlines can't be written as text
+void write_text_command(output_writer* output, command* request) {
+	switch (request->type) {
+	case COMMAND_STORE:
+	case COMMAND_RETRIEVE:
+		DIE(memchr(request->key.key, '"', request->key.length) ||
+			memchr(request->key.key, '\n', request->key.length),
+			"key can't be written as text");
+		output_string(output, request->type == COMMAND_STORE ?
+					  "store \"" : "retrieve \"");
+		output_write(output, request->key.key, request->key.length);
+		output_write(output, "\"", 1);
+		if (request->type == COMMAND_STORE) {
+			DIE(memchr(request->value, '\n', request->value_length),
+				"value can't be written as text");
+			output_write(output, " \"", 2);
+			output_write(output, request->value, request->value_length);
+			output_write(output, "\"", 1);
+		}
+		break;
+	case COMMAND_ADD_SERVER:
+	case COMMAND_REMOVE_SERVER:
+		output_string(output, request->type == COMMAND_ADD_SERVER ?
+					  "add_server " : "remove_server ");
+		output_int(output, request->server_id);
+		if (request->type == COMMAND_ADD_SERVER && request->weight >= 0) {
+			output_write(output, " ", 1);
+			output_int(output, request->weight);
+		}
+		break;
+	}
+
+	output_write(output, "\n", 1);
+}
+
+// function which initialises an output writer for the given file
+void init_output_writer(output_writer* output, FILE* file) {
+	output->file = file;
+	output->size = 0;
+	output->buffer = malloc(OUTPUT_BUFFER_SIZE);
+	DIE(output->buffer == NULL, "Error");
+}
+
+// function which writes the buffered output in the file
+void output_flush(output_writer* output) {
+	if (output->size == 0)
+		return;
+
+	size_t written = fwrite(output->buffer, 1, output->size, output->file);
+	DIE(written != output->size, "fwrite");
+	output->size = 0;
+}
+
+// function which adds the given bytes to the output
+void output_write(output_writer* output, const char* data, size_t length) {
+	if (output->size + length > OUTPUT_BUFFER_SIZE) {
+		output_flush(output);
+
+		// a piece larger than the buffer is written directly
+		if (length > OUTPUT_BUFFER_SIZE) {
+			size_t written = fwrite(data, 1, length, output->file);
+			DIE(written != length, "fwrite");
+			return;
+		}
+	}
+
+	memcpy(output->buffer + output->size, data, length);
+	output->size += length;
+}
+
+// function which adds a string to the output
+void output_string(output_writer* output, const char* string) {
+	output_write(output, string, strlen(string));
+}
+
+// function which adds a number, in decimal, to the output
+void output_int(output_writer* output, int value) {
+	char digits[16];
+	int position = sizeof(digits);
+	unsigned int magnitude = value < 0 ? -(unsigned int)value :
+												 (unsigned int)value;
+
+	// the digits are written from the last one
+	do {
+		digits[--position] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude != 0);
+	if (value < 0)
+		digits[--position] = '-';
+
+	output_write(output, digits + position, sizeof(digits) - position);
+}
+
+// function which writes the buffered output and frees the writer
+void free_output_writer(output_writer* output) {
+	output_flush(output);
+	fflush(output->file);
+	free(output->buffer);
+}
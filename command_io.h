@@ -0,0 +1,128 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the input and output
+// of the command files: the mapped input file, the readers of its
+// commands (text or binary), the scanner used for tokenizing the text
+// commands in place and the buffered output writer
+
+#ifndef COMMAND_IO_H_
+#define COMMAND_IO_H_
+
+#include <stdio.h>
+
+#include "key_hash.h"
+
+// size of the buffer of an output writer; the buffer is written when it
+// can't hold the next piece of output
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+// whole content of a command file; a regular file is mapped with mmap
+// (privately, so tokenizing it in place doesn't change the file), any
+// other file (such as a pipe) is read in a buffer
+typedef struct command_file command_file;
+struct command_file {
+	char* data;
+	size_t size;
+	// 1 if data is mapped, 0 if it was allocated
+	int mapped;
+};
+
+// types of commands
+#define COMMAND_STORE 1
+#define COMMAND_RETRIEVE 2
+#define COMMAND_ADD_SERVER 3
+#define COMMAND_REMOVE_SERVER 4
+
+// command read from a command file; the key and the value point in the
+// content of the file and they are ended with null bytes
+typedef struct command command;
+struct command {
+	int type;
+	// key of a store or retrieve, with its length and its hash
+	key_descriptor key;
+	// value of a store
+	char* value;
+	unsigned int value_length;
+	// server of an add_server or remove_server
+	int server_id;
+	// labels of an added server, or -1 for the default number of labels
+	int weight;
+};
+
+// reader of the commands of a command file, which are either text lines
+// or binary records (when the file starts with COMMAND_LOG_MAGIC)
+typedef struct command_reader command_reader;
+struct command_reader {
+	char* position;
+	char* end;
+	int binary;
+};
+
+// output written in a large buffer, so the results of millions of
+// requests cost a few write calls instead of a printf each
+typedef struct output_writer output_writer;
+struct output_writer {
+	FILE* file;
+	char* buffer;
+	size_t size;
+};
+
+// open_command_file() - Gives the content of a command file.
+// @arg1: Command file which is filled.
+// @arg2: Path of the file.
+//
+// The content can be changed in place (the tokenizer writes the null
+// bytes ending the keys and values) and stays valid until the file is
+// closed.
+void open_command_file(command_file* input, const char* path);
+
+// function which unmaps (or frees) the content of a command file
+void close_command_file(command_file* input);
+
+// function which initialises a reader of the commands of a file
+void init_command_reader(command_reader* reader, command_file* input);
+
+// next_command() - Reads the next command of a command file.
+// @arg1: Reader of the command file.
+// @arg2: This function will RETURN the command via this parameter.
+//
+// The key of the command is hashed, unless its binary record carries the
+// hash. A malformed command stops the program.
+//
+// Return: 1 if a command was read, 0 at the end of the file.
+int next_command(command_reader* reader, command* request);
+
+// function which reads a text command and returns the end of its line
+char* read_text_command(char* position, char* end, command* request);
+
+// function which writes a command as a text line
+void write_text_command(output_writer* output, command* request);
+
+// scan_quote_or_newline() - Finds the next quote or newline.
+// @arg1: Position from which the search starts.
+// @arg2: End of the searched memory.
+//
+// The bytes are compared 16 at a time with SSE2 (when it is available),
+// so a token costs a few instructions for each 16 bytes.
+//
+// Return: The position of the first '"' or '\n', or end if there isn't any.
+char* scan_quote_or_newline(char* position, char* end);
+
+// function which initialises an output writer for the given file
+void init_output_writer(output_writer* output, FILE* file);
+
+// function which adds the given bytes to the output
+void output_write(output_writer* output, const char* data, size_t length);
+
+// function which adds a string to the output
+void output_string(output_writer* output, const char* string);
+
+// function which adds a number, in decimal, to the output
+void output_int(output_writer* output, int value);
+
+// function which writes the buffered output in the file
+void output_flush(output_writer* output);
+
+// function which writes the buffered output and frees the writer
+void free_output_writer(output_writer* output);
+
+#endif  // COMMAND_IO_H_
@@ -0,0 +1,186 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the binary command log
+
+#include <string.h>
+
+#include "command_log.h"
+#include "server.h"
+#include "utils.h"
+
+// function which checks if a file content is a command log
+int is_command_log(const char* data, size_t size) {
+	return size >= COMMAND_LOG_HEADER_SIZE &&
+		   !memcmp(data, COMMAND_LOG_MAGIC, COMMAND_LOG_HEADER_SIZE);
+}
+
+// function which reads a varint and moves the position after it; the
+// position becomes NULL if the varint doesn't fit in the log
+unsigned int read_varint(char** position, char* end) {
+	unsigned char* current = (unsigned char*)*position;
+	unsigned int value = 0;
+	if (current == NULL)
+		return 0;
+
+	for (int shift = 0; ; shift += 7) {
+		if ((char*)current == end || shift > 28) {
+			*position = NULL;
+			return 0;
+		}
+		value |= (unsigned int)(*current & 0x7f) << shift;
+		if (!(*current++ & 0x80))
+			break;
+	}
+
+	*position = (char*)current;
+	return value;
+}
+
+// function which reads a string of the given length, followed by its
+// null byte, and moves the position after it (or makes it NULL if the
+// string doesn't fit in the log)
+char* read_string(char** position, char* end, unsigned int length) {
+	char* string = *position;
+	if (string == NULL || (size_t)(end - string) <= length ||
+		string[length] != 0) {
+		*position = NULL;
+		return NULL;
+	}
+
+	*position = string + length + 1;
+	return string;
+}
+
+// function which reads a record of a command log, or returns NULL if the
+// record is malformed or doesn't fit in the log
+char* parse_log_command(char* position, char* end, command* request) {
+	unsigned char type = *position++;
+	int hashed = type & COMMAND_LOG_HASHED;
+	request->type = type & ~COMMAND_LOG_HASHED;
+
+	switch (request->type) {
+	case COMMAND_STORE:
+	case COMMAND_RETRIEVE: {
+		request->key.length = read_varint(&position, end);
+		if (request->type == COMMAND_STORE)
+			request->value_length = read_varint(&position, end);
+
+		if (hashed && position != NULL) {
+			if (end - position < 4)
+				return NULL;
+			unsigned char* bytes = (unsigned char*)position;
+			request->key.hash = bytes[0] | bytes[1] << 8 | bytes[2] << 16 |
+								(unsigned int)bytes[3] << 24;
+			position += 4;
+		}
+
+		request->key.key = read_string(&position, end, request->key.length);
+		if (position == NULL)
+			return NULL;
+		if (!hashed)
+			request->key.hash = key_hash_fold(key_hash64(request->key.key,
+														 request->key.length));
+		if (request->type == COMMAND_STORE)
+			request->value = read_string(&position, end,
+										 request->value_length);
+		break;
+	}
+	case COMMAND_ADD_SERVER:
+	case COMMAND_REMOVE_SERVER: {
+		// the log may come from another machine, so the id is checked
+		// before it indexes the tables of the load balancer
+		unsigned int server_id = read_varint(&position, end);
+		DIE(server_id >= MAX_HASH, "server id out of range");
+		request->server_id = server_id;
+		request->weight = request->type == COMMAND_ADD_SERVER ?
+						  (int)read_varint(&position, end) - 1 : -1;
+		break;
+	}
+	default:
+		return NULL;
+	}
+
+	return position;
+}
+
+// function which reads a record of a command log
+char* read_log_command(char* position, char* end, command* request) {
+	char* next = parse_log_command(position, end, request);
+	DIE(next == NULL, "malformed command log");
+	return next;
+}
+
+// function which returns the size of the complete records at the start
+// of a command log
+size_t command_log_valid_size(char* data, size_t size) {
+	if (!is_command_log(data, size))
+		return 0;
+
+	char* end = data + size;
+	char* position = data + COMMAND_LOG_HEADER_SIZE;
+	command request;
+	while (position < end) {
+		char* next = parse_log_command(position, end, &request);
+		if (next == NULL)
+			break;
+		position = next;
+	}
+
+	return position - data;
+}
+
+// function which writes a varint
+void write_varint(output_writer* output, unsigned int value) {
+	char bytes[5];
+	int length = 0;
+
+	while (value >= 0x80) {
+		bytes[length++] = (char)(value | 0x80);
+		value >>= 7;
+	}
+	bytes[length++] = (char)value;
+
+	output_write(output, bytes, length);
+}
+
+// function which writes the header of a command log
+void write_log_header(output_writer* output) {
+	output_write(output, COMMAND_LOG_MAGIC, COMMAND_LOG_HEADER_SIZE);
+}
+
+// function which writes a command as a record of a command log
+void write_log_command(output_writer* output, command* request, int hashed) {
+	int key_command = request->type == COMMAND_STORE ||
+					  request->type == COMMAND_RETRIEVE;
+	char type = request->type | (key_command && hashed ?
+								 COMMAND_LOG_HASHED : 0);
+	output_write(output, &type, 1);
+
+	switch (request->type) {
+	case COMMAND_STORE:
+	case COMMAND_RETRIEVE:
+		write_varint(output, request->key.length);
+		if (request->type == COMMAND_STORE)
+			write_varint(output, request->value_length);
+
+		if (hashed) {
+			unsigned int hash = request->key.hash;
+			char bytes[4] = {hash, hash >> 8, hash >> 16, hash >> 24};
+			output_write(output, bytes, 4);
+		}
+
+		output_write(output, request->key.key, request->key.length);
+		output_write(output, "", 1);
+		if (request->type == COMMAND_STORE) {
+			output_write(output, request->value, request->value_length);
+			output_write(output, "", 1);
+		}
+		break;
+	case COMMAND_ADD_SERVER:
+		write_varint(output, request->server_id);
+		write_varint(output, request->weight + 1);
+		break;
+	case COMMAND_REMOVE_SERVER:
+		write_varint(output, request->server_id);
+		break;
+	}
+}
@@ -0,0 +1,72 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the binary command log:
+// a compact format of the command files, read without scanning the keys
+// and values
+
+#ifndef COMMAND_LOG_H_
+#define COMMAND_LOG_H_
+
+#include "command_io.h"
+
+// a command log starts with this header (the last character is the
+// version of the format)
+#define COMMAND_LOG_MAGIC "LBCMDLG1"
+#define COMMAND_LOG_HEADER_SIZE (sizeof(COMMAND_LOG_MAGIC) - 1)
+
+// flag of the type byte of a record whose key hash follows the lengths
+#define COMMAND_LOG_HASHED 0x80
+
+// Each record of a command log is made of:
+//   - a type byte: the type of the command (COMMAND_STORE, ...), with
+//   COMMAND_LOG_HASHED set if the record carries the hash of its key
+//   - store: the key length and the value length (as varints), the key
+//   hash (4 bytes, little endian, if the record is hashed), then the key
+//   and the value, each of them followed by a null byte
+//   - retrieve: the key length, the key hash (if the record is hashed),
+//   then the key, followed by a null byte
+//   - add_server: the server id and the weight plus one (0 for the
+//   default number of labels), as varints
+//   - remove_server: the server id, as a varint
+// A varint is written 7 bits at a time, starting with the low bits; the
+// high bit of a byte is set if more bytes follow. The null bytes let the
+// keys and values be used in place, as strings.
+
+// function which checks if a file content is a command log
+int is_command_log(const char* data, size_t size);
+
+// read_log_command() - Reads a record of a command log.
+// @arg1: Position of the record.
+// @arg2: End of the command log.
+// @arg3: This function will RETURN the command via this parameter.
+//
+// The key is hashed only if the record doesn't carry its hash. A record
+// which doesn't fit in the log stops the program.
+//
+// Return: The position of the next record.
+char* read_log_command(char* position, char* end, command* request);
+
+// function which reads a record of a command log, or returns NULL if the
+// record is malformed or doesn't fit in the log
+char* parse_log_command(char* position, char* end, command* request);
+
+// command_log_valid_size() - Measures the complete records of a log.
+// @arg1: Content of the command log.
+// @arg2: Size of the content.
+//
+// A log which was being written when the program stopped may end with
+// an incomplete record; it is ignored by the recovery.
+//
+// Return: The size of the header and of the complete records which
+//         follow it, or 0 if the content isn't a command log.
+size_t command_log_valid_size(char* data, size_t size);
+
+// function which writes the header of a command log
+void write_log_header(output_writer* output);
+
+// write_log_command() - Writes a command as a record of a command log.
+// @arg1: Writer of the command log.
+// @arg2: Command which is written.
+// @arg3: 1 if the hash of the key is written with the record, 0 otherwise.
+void write_log_command(output_writer* output, command* request, int hashed);
+
+#endif  // COMMAND_LOG_H_
@@ -0,0 +1,58 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// converter of the command files between the text format and the binary
+// command log
+
+#include <stdio.h>
+#include <string.h>
+
+#include "command_io.h"
+#include "command_log.h"
+#include "utils.h"
+
+// function which prints the usage of the program
+void print_usage(char* program) {
+	printf("Usage:%s [--no-hash] input_file output_file\n"
+		   "A text command file is converted in a command log, a command "
+		   "log in a text command file.\n", program);
+}
+
+int main(int argc, char* argv[]) {
+	int hashed = 1;
+
+	if (argc == 4 && !strcmp(argv[1], "--no-hash")) {
+		hashed = 0;
+	} else if (argc != 3) {
+		print_usage(argv[0]);
+		return -1;
+	}
+
+	command_file input;
+	open_command_file(&input, argv[argc - 2]);
+	FILE* file = fopen(argv[argc - 1], "wb");
+	DIE(file == NULL, "fopen");
+	output_writer output;
+	init_output_writer(&output, file);
+
+	command_reader reader;
+	init_command_reader(&reader, &input);
+	if (!reader.binary)
+		write_log_header(&output);
+
+	command request;
+	unsigned long long count = 0;
+	while (next_command(&reader, &request)) {
+		if (reader.binary)
+			write_text_command(&output, &request);
+		else
+			write_log_command(&output, &request, hashed);
+		count++;
+	}
+
+	free_output_writer(&output);
+	DIE(fclose(file) != 0, "fclose");
+	fprintf(stderr, "converted %llu commands (%zu bytes) to %s\n", count,
+			input.size, reader.binary ? "text" : "a command log");
+	close_command_file(&input);
+
+	return 0;
+}
@@ -0,0 +1,260 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the open addressing hashtable used
+// as an alternative server memory backend
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "flat_table.h"
+
+// function which allocates the arrays of a table with the given capacity
+void flat_table_allocate(flat_table* table, unsigned int capacity) {
+	table->capacity = capacity;
+	table->meta = calloc(capacity, sizeof(flat_meta));
+	DIE(table->meta == NULL, "Error");
+	table->slots = malloc(capacity * sizeof(flat_slot));
+	DIE(table->slots == NULL, "Error");
+}
+
+// function which initialises the flat table and returns it
+flat_table* create_flat_table(unsigned int capacity, arena* pool) {
+	flat_table* table = malloc(sizeof(flat_table));
+	DIE(table == NULL, "Error");
+
+	table->size = 0;
+	table->pool = pool;
+	flat_table_allocate(table, capacity);
+
+	return table;
+}
+
+// function which returns the key stored in a slot
+char* flat_slot_key(flat_slot* slot) {
+	if (slot->key_length < KEY_LENGTH)
+		return slot->inline_key;
+	return slot->heap_key;
+}
+
+// function which returns the index of the slot storing the given key,
+// or -1 if the key doesn't exist
+int flat_table_index(flat_table* table, char* key, unsigned int key_length,
+					 unsigned int hash) {
+	unsigned int mask = table->capacity - 1;
+	unsigned int index = hash & mask;
+
+	// the probe stops on an empty slot or on a key closer to its home
+	// slot than the searched key would be
+	for (unsigned int distance = 1; ; distance++) {
+		flat_meta* meta = &table->meta[index];
+		if (meta->distance < distance)
+			return -1;
+
+		if (meta->hash == hash &&
+			table->slots[index].key_length == key_length &&
+			memcmp(flat_slot_key(&table->slots[index]), key,
+				   key_length) == 0)
+			return index;
+
+		index = (index + 1) & mask;
+	}
+}
+
+// function which places a slot in the table using Robin Hood probing;
+// the slot's key must not exist in the table
+void flat_table_place(flat_table* table, flat_meta meta, flat_slot slot) {
+	unsigned int mask = table->capacity - 1;
+	unsigned int index = meta.hash & mask;
+
+	meta.distance = 1;
+	while (table->meta[index].distance != 0) {
+		// take the place of a key which is closer to its home slot
+		// and continue with the displaced key
+		if (table->meta[index].distance < meta.distance) {
+			flat_meta aux_meta = table->meta[index];
+			flat_slot aux_slot = table->slots[index];
+			table->meta[index] = meta;
+			table->slots[index] = slot;
+			meta = aux_meta;
+			slot = aux_slot;
+		}
+		index = (index + 1) & mask;
+		meta.distance++;
+	}
+
+	table->meta[index] = meta;
+	table->slots[index] = slot;
+}
+
+// function which changes the capacity of the table, moving each slot
+// in the new arrays (the keys and values are not copied)
+void flat_table_resize(flat_table* table, unsigned int capacity) {
+	flat_meta* old_meta = table->meta;
+	flat_slot* old_slots = table->slots;
+	unsigned int old_capacity = table->capacity;
+
+	flat_table_allocate(table, capacity);
+	for (unsigned int i = 0; i < old_capacity; i++) {
+		if (old_meta[i].distance != 0)
+			flat_table_place(table, old_meta[i], old_slots[i]);
+	}
+
+	free(old_meta);
+	free(old_slots);
+}
+
+// function which stores a key-value pair in the table
+int flat_table_store(flat_table* table, key_descriptor* key, char* value,
+					 unsigned int value_size, int packed) {
+	unsigned int key_length = key->length;
+
+	// if the key already exists, renew its value
+	int index = flat_table_index(table, key->key, key_length, key->hash);
+	if (index >= 0) {
+		flat_slot* slot = &table->slots[index];
+		slot->value = arena_realloc(table->pool, slot->value,
+									codec_stored_size(slot->value,
+													  slot->packed),
+									value_size);
+		memcpy(slot->value, value, value_size);
+		slot->referenced = 1;
+		slot->packed = packed;
+		return 0;
+	}
+
+	// create the slot, storing the key inline if it fits
+	flat_slot slot;
+	slot.key_length = key_length;
+	if (key_length < KEY_LENGTH) {
+		memcpy(slot.inline_key, key->key, key_length + 1);
+	} else {
+		slot.heap_key = arena_copy(table->pool, key->key, key_length + 1);
+	}
+	slot.value = arena_copy(table->pool, value, value_size);
+	slot.deadline = 0;
+	slot.referenced = 1;
+	slot.packed = packed;
+
+	// the load factor is kept under 7/8, so the probe sequences stay short
+	flat_table_put(table, key->hash, slot);
+
+	return 1;
+}
+
+// function which returns the slot storing the given key
+flat_slot* flat_table_find(flat_table* table, key_descriptor* key) {
+	int index = flat_table_index(table, key->key, key->length, key->hash);
+	if (index < 0)
+		return NULL;
+
+	return &table->slots[index];
+}
+
+// function which takes a slot out of the table, without freeing its key
+// and value, and returns its content
+flat_slot flat_table_take(flat_table* table, unsigned int index) {
+	unsigned int mask = table->capacity - 1;
+	flat_slot slot = table->slots[index];
+
+	// shift back the following keys which are not in their home slot,
+	// so no tombstones are needed
+	unsigned int current = index;
+	unsigned int next = (current + 1) & mask;
+	while (table->meta[next].distance > 1) {
+		table->meta[current] = table->meta[next];
+		table->meta[current].distance--;
+		table->slots[current] = table->slots[next];
+		current = next;
+		next = (next + 1) & mask;
+	}
+	table->meta[current].distance = 0;
+	table->size--;
+
+	// halve the table when it is less than 1/8 full
+	if (table->capacity > FLAT_INITIAL_CAPACITY &&
+		8 * table->size < table->capacity)
+		flat_table_resize(table, table->capacity / 2);
+
+	return slot;
+}
+
+// function which adds a slot taken out of a table, keeping its key
+// and value buffers
+void flat_table_put(flat_table* table, unsigned int hash, flat_slot slot) {
+	flat_meta meta;
+	meta.hash = hash;
+
+	if (8 * (table->size + 1) > 7 * table->capacity)
+		flat_table_resize(table, 2 * table->capacity);
+
+	flat_table_place(table, meta, slot);
+	table->size++;
+}
+
+// function which removes a key from the table
+int flat_table_remove(flat_table* table, key_descriptor* key) {
+	int index = flat_table_index(table, key->key, key->length, key->hash);
+	if (index < 0)
+		return 0;
+
+	// give the memory of the removed slot back to the arena
+	flat_slot slot = flat_table_take(table, index);
+	if (slot.key_length >= KEY_LENGTH)
+		arena_free(table->pool, slot.heap_key, slot.key_length + 1);
+	arena_free(table->pool, slot.value,
+			   codec_stored_size(slot.value, slot.packed));
+
+	return 1;
+}
+
+// function which returns the index of the first slot storing a key
+// with the given hash, or -1 if there isn't such a slot
+int flat_table_find_hash(flat_table* table, unsigned int hash) {
+	unsigned int mask = table->capacity - 1;
+	unsigned int index = hash & mask;
+
+	for (unsigned int distance = 1; table->meta[index].distance >= distance;
+		 distance++) {
+		if (table->meta[index].hash == hash)
+			return index;
+		index = (index + 1) & mask;
+	}
+
+	return -1;
+}
+
+// function which calls the given function for each slot storing a key
+// with the given hash
+void flat_table_for_each_with_hash(flat_table* table, unsigned int hash,
+								   flat_slot_callback callback, void* arg) {
+	unsigned int mask = table->capacity - 1;
+	unsigned int index = hash & mask;
+
+	// the keys with the same hash have the same home slot, so they are
+	// all found before the probe meets a key closer to its home slot
+	for (unsigned int distance = 1; table->meta[index].distance >= distance;
+		 distance++) {
+		if (table->meta[index].hash == hash)
+			callback(&table->slots[index], arg);
+		index = (index + 1) & mask;
+	}
+}
+
+// function which returns the length of the longest probe sequence
+unsigned int flat_table_longest_probe(flat_table* table) {
+	unsigned int longest = 0;
+
+	for (unsigned int i = 0; i < table->capacity; i++) {
+		if (table->meta[i].distance > longest)
+			longest = table->meta[i].distance;
+	}
+
+	return longest;
+}
+
+// function which frees the memory of the table; the keys and values
+// are owned by the arena, so the slots are not visited
+void free_flat_table(flat_table* table) {
+	free(table->meta);
+	free(table->slots);
+	free(table);
+}
@@ -0,0 +1,146 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the open addressing
+// hashtable used as an alternative server memory backend
+
+#ifndef FLAT_TABLE_H_
+#define FLAT_TABLE_H_
+
+#include "utils.h"
+#include "arena.h"
+#include "key_hash.h"
+#include "value_codec.h"
+
+#define KEY_LENGTH 128
+#define VALUE_LENGTH 65536
+
+// initial (and minimum) number of slots of a flat table
+// (it must be a power of 2)
+#define FLAT_INITIAL_CAPACITY 1024
+
+// metadata of a slot; the metadata is stored in its own array, so probing
+// only reads 8 bytes per slot and the key bytes are compared only when the
+// cached hashes match
+typedef struct flat_meta flat_meta;
+struct flat_meta {
+	// full hash of the key stored in the slot
+	unsigned int hash;
+	// distance from the slot to the key's home slot plus 1;
+	// 0 marks an empty slot
+	unsigned int distance;
+};
+
+// slot of a flat table; keys shorter than KEY_LENGTH are stored inline,
+// longer keys are stored on the heap and the slot keeps a pointer to them
+typedef struct flat_slot flat_slot;
+struct flat_slot {
+	union {
+		char inline_key[KEY_LENGTH];
+		char* heap_key;
+	};
+	char* value;
+	// length of the key, without the terminating null byte
+	unsigned int key_length;
+	// 1 if the key was used since the eviction hand of the server last
+	// passed over it
+	unsigned char referenced;
+	// 1 if the value is packed by the value codec (value_codec.h)
+	unsigned char packed;
+	// time (in ms) at which the key expires, or 0 if it never expires
+	unsigned long long deadline;
+};
+
+// open addressing hashtable using Robin Hood linear probing: an inserted
+// key takes the slot of any key which is closer to its home slot, so all
+// the probe sequences stay short and a lookup can stop as soon as it meets
+// a key closer to home than the searched one
+typedef struct flat_table flat_table;
+struct flat_table {
+	flat_meta* meta;
+	flat_slot* slots;
+	// number of keys stored in the table
+	unsigned int size;
+	// number of slots (a power of 2)
+	unsigned int capacity;
+	// arena from which the values and the long keys are allocated;
+	// it is owned by the caller, which frees the pairs by freeing it
+	arena* pool;
+};
+
+// function called for a slot of the table
+typedef void (*flat_slot_callback)(flat_slot* slot, void* arg);
+
+// function which initialises and returns an empty flat table
+flat_table* create_flat_table(unsigned int capacity, arena* pool);
+
+// function which returns the key stored in a slot
+char* flat_slot_key(flat_slot* slot);
+
+// flat_table_store() - Stores a key-value pair in the table.
+// @arg1: Table in which the pair is stored.
+// @arg2: Descriptor of the key.
+// @arg3: Value, either a string or packed by the value codec.
+// @arg4: Number of bytes of the value.
+// @arg5: 1 if the value is packed.
+//
+// An added key never expires; the deadline of an existing key is kept.
+// The stored key is marked as referenced.
+//
+// Return: 1 if the key was added, 0 if the value of an existing key
+//         was renewed.
+int flat_table_store(flat_table* table, key_descriptor* key, char* value,
+					 unsigned int value_size, int packed);
+
+// flat_table_find() - Finds the slot of a key.
+// @arg1: Table in which the key is searched.
+// @arg2: Descriptor of the key.
+//
+// Return: The slot which stores the key or NULL.
+flat_slot* flat_table_find(flat_table* table, key_descriptor* key);
+
+// flat_table_remove() - Removes a key from the table.
+// @arg1: Table from which the key is removed.
+// @arg2: Descriptor of the key.
+//
+// Return: 1 if the key was removed, 0 if it didn't exist.
+int flat_table_remove(flat_table* table, key_descriptor* key);
+
+// flat_table_find_hash() - Finds the first slot storing a key
+// with the given hash.
+// @arg1: Table in which the key is searched.
+// @arg2: Hash of the key.
+//
+// Return: The index of the slot or -1.
+int flat_table_find_hash(flat_table* table, unsigned int hash);
+
+// flat_table_take() - Takes a slot out of the table; the key and value
+// buffers of the slot are not freed, so they can be given to another table.
+// @arg1: Table from which the slot is taken.
+// @arg2: Index of the slot.
+//
+// Return: The content of the slot.
+flat_slot flat_table_take(flat_table* table, unsigned int index);
+
+// flat_table_put() - Adds a slot taken out of a table.
+// @arg1: Table in which the slot is added.
+// @arg2: Hash of the slot's key, which must not exist in the table.
+// @arg3: Content of the slot.
+void flat_table_put(flat_table* table, unsigned int hash, flat_slot slot);
+
+// flat_table_for_each_with_hash() - Calls a function for each slot
+// storing a key with the given hash.
+// @arg1: Table in which the keys are searched.
+// @arg2: Hash of the keys.
+// @arg3: Function which is called for each slot.
+// @arg4: Argument given to the function.
+//
+// The function must not modify the table.
+void flat_table_for_each_with_hash(flat_table* table, unsigned int hash,
+								   flat_slot_callback callback, void* arg);
+
+// function which returns the length of the longest probe sequence
+unsigned int flat_table_longest_probe(flat_table* table);
+
+// function which frees the memory of the table (but not its arena)
+void free_flat_table(flat_table* table);
+
+#endif  // FLAT_TABLE_H_
@@ -0,0 +1,209 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the front cache of the load balancer
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "front_cache.h"
+
+// function which initialises and returns an empty front cache
+front_cache* create_front_cache(unsigned int capacity) {
+	front_cache* cache = malloc(sizeof(front_cache));
+	DIE(cache == NULL, "Error");
+
+	cache->no_sets = 1;
+	while (cache->no_sets * FRONT_CACHE_WAYS < capacity)
+		cache->no_sets *= 2;
+	capacity = cache->no_sets * FRONT_CACHE_WAYS;
+
+	cache->sets = calloc(cache->no_sets, sizeof(front_cache_set));
+	cache->entries = malloc(capacity * sizeof(front_cache_entry));
+	DIE(cache->sets == NULL || cache->entries == NULL, "Error");
+
+	// each row has two counters for each entry of the cache
+	cache->no_blocks = 2 * capacity / (FRONT_CACHE_SKETCH_BLOCK /
+									   FRONT_CACHE_SKETCH_ROWS);
+	cache->sketch = calloc(cache->no_blocks, FRONT_CACHE_SKETCH_BLOCK);
+	DIE(cache->sketch == NULL, "Error");
+	cache->samples = 0;
+	cache->sample_size = FRONT_CACHE_SAMPLE_FACTOR * capacity;
+
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->admitted = 0;
+	cache->rejected = 0;
+
+	return cache;
+}
+
+// function which returns the block of counters of a hash and fills the
+// positions of its counters in the block, one in each row
+unsigned char* sketch_block(front_cache* cache, unsigned int hash,
+							unsigned int* positions)
+{
+	unsigned int block = hash * 0x9e3779b1;
+	block ^= block >> 16;
+
+	// the other bits give the counter in each row
+	unsigned int bits = hash * 0x85ebca77;
+	bits ^= bits >> 13;
+	unsigned int row_size = FRONT_CACHE_SKETCH_BLOCK / FRONT_CACHE_SKETCH_ROWS;
+	for (int row = 0; row < FRONT_CACHE_SKETCH_ROWS; row++)
+		positions[row] = row * row_size +
+						 ((bits >> (4 * row)) & (row_size - 1));
+
+	return &cache->sketch[(block & (cache->no_blocks - 1)) *
+						  FRONT_CACHE_SKETCH_BLOCK];
+}
+
+// function which returns the estimated frequency of a hash: the smallest
+// of its counters, which is too big only if all of them are shared
+unsigned int sketch_frequency(front_cache* cache, unsigned int hash)
+{
+	unsigned int positions[FRONT_CACHE_SKETCH_ROWS];
+	unsigned char* block = sketch_block(cache, hash, positions);
+
+	unsigned int frequency = FRONT_CACHE_MAX_COUNT;
+	for (int row = 0; row < FRONT_CACHE_SKETCH_ROWS; row++) {
+		if (block[positions[row]] < frequency)
+			frequency = block[positions[row]];
+	}
+
+	return frequency;
+}
+
+// function which counts a read of a hash in the sketch; after a sample
+// of reads, all the counters are halved
+void sketch_increment(front_cache* cache, unsigned int hash)
+{
+	unsigned int positions[FRONT_CACHE_SKETCH_ROWS];
+	unsigned char* block = sketch_block(cache, hash, positions);
+
+	for (int row = 0; row < FRONT_CACHE_SKETCH_ROWS; row++) {
+		if (block[positions[row]] < FRONT_CACHE_MAX_COUNT)
+			block[positions[row]]++;
+	}
+
+	if (++cache->samples == cache->sample_size) {
+		size_t size = (size_t)cache->no_blocks * FRONT_CACHE_SKETCH_BLOCK;
+		for (size_t i = 0; i < size; i++)
+			cache->sketch[i] >>= 1;
+		cache->samples /= 2;
+	}
+}
+
+// function which returns the set of a hash
+front_cache_set* cache_set(front_cache* cache, unsigned int hash)
+{
+	return &cache->sets[hash & (cache->no_sets - 1)];
+}
+
+// function which returns the entry of a way of a set
+front_cache_entry* cache_entry(front_cache* cache, front_cache_set* set,
+							   int way)
+{
+	return &cache->entries[(set - cache->sets) * FRONT_CACHE_WAYS + way];
+}
+
+// function which returns the way of a key in its set, or -1 if the key
+// isn't cached; the entries are read only when their hashes match
+int cache_find(front_cache* cache, front_cache_set* set, key_descriptor* key)
+{
+	if (key->length >= FRONT_CACHE_KEY_LENGTH)
+		return -1;
+
+	for (int way = 0; way < FRONT_CACHE_WAYS; way++) {
+		if (!(set->used & 1 << way) || set->hashes[way] != key->hash)
+			continue;
+
+		front_cache_entry* entry = cache_entry(cache, set, way);
+		if (entry->key_length == key->length &&
+			!memcmp(entry->key, key->key, key->length))
+			return way;
+	}
+
+	return -1;
+}
+
+// function which finds a key in the cache
+char* front_cache_lookup(front_cache* cache, key_descriptor* key,
+						 int* server_id)
+{
+	sketch_increment(cache, key->hash);
+
+	front_cache_set* set = cache_set(cache, key->hash);
+	int way = cache_find(cache, set, key);
+	if (way < 0) {
+		cache->misses++;
+		return NULL;
+	}
+
+	cache->hits++;
+	set->referenced |= 1 << way;
+	front_cache_entry* entry = cache_entry(cache, set, way);
+	*server_id = entry->server_id;
+	return entry->value;
+}
+
+// function which offers the cache a key which was read from its server
+void front_cache_admit(front_cache* cache, key_descriptor* key,
+					   int server_id, char* value)
+{
+	if (key->length >= FRONT_CACHE_KEY_LENGTH)
+		return;
+
+	// the key takes the first free entry of its set
+	front_cache_set* set = cache_set(cache, key->hash);
+	int way = 0;
+	while (way < FRONT_CACHE_WAYS && set->used & 1 << way)
+		way++;
+
+	if (way == FRONT_CACHE_WAYS) {
+		// the hand gives the entries read since it passed them another
+		// chance; it stops at the victim
+		while (set->referenced & 1 << set->hand) {
+			set->referenced &= ~(1 << set->hand);
+			set->hand = (set->hand + 1) % FRONT_CACHE_WAYS;
+		}
+		way = set->hand;
+
+		if (sketch_frequency(cache, key->hash) <=
+			sketch_frequency(cache, set->hashes[way])) {
+			cache->rejected++;
+			return;
+		}
+		set->hand = (set->hand + 1) % FRONT_CACHE_WAYS;
+	}
+
+	set->hashes[way] = key->hash;
+	set->used |= 1 << way;
+	set->referenced &= ~(1 << way);
+
+	front_cache_entry* entry = cache_entry(cache, set, way);
+	entry->key_length = key->length;
+	entry->server_id = server_id;
+	entry->value = value;
+	memcpy(entry->key, key->key, key->length + 1);
+	cache->admitted++;
+}
+
+// function which drops a key from the cache
+void front_cache_invalidate(front_cache* cache, key_descriptor* key) {
+	front_cache_set* set = cache_set(cache, key->hash);
+	int way = cache_find(cache, set, key);
+	if (way >= 0)
+		set->used &= ~(1 << way);
+}
+
+// function which empties the cache
+void front_cache_clear(front_cache* cache) {
+	memset(cache->sets, 0, cache->no_sets * sizeof(front_cache_set));
+}
+
+// function which frees the memory of the cache
+void free_front_cache(front_cache* cache) {
+	free(cache->sets);
+	free(cache->entries);
+	free(cache->sketch);
+	free(cache);
+}
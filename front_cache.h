@@ -0,0 +1,120 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the front cache of the
+// load balancer, which keeps the values of the most read keys
+
+#ifndef FRONT_CACHE_H_
+#define FRONT_CACHE_H_
+
+#include "key_hash.h"
+#include "utils.h"
+
+// number of entries of a set; a key can only be cached in the entries of
+// the set given by its hash
+#define FRONT_CACHE_WAYS 8
+// keys longer than FRONT_CACHE_KEY_LENGTH - 1 bytes are not cached
+#define FRONT_CACHE_KEY_LENGTH 48
+
+// frequency sketch: blocks of FRONT_CACHE_SKETCH_ROWS rows of 16 counters
+// each, which stop at FRONT_CACHE_MAX_COUNT; a key has one counter in
+// each row of a single block, so counting it reads one cache line; the
+// counters are halved after FRONT_CACHE_SAMPLE_FACTOR reads for each
+// entry of the cache, so the reads of the past weigh less and less
+#define FRONT_CACHE_SKETCH_ROWS 4
+#define FRONT_CACHE_SKETCH_BLOCK 64
+#define FRONT_CACHE_MAX_COUNT 15
+#define FRONT_CACHE_SAMPLE_FACTOR 10
+
+// tags of a set of the cache, checked before the entries are read: the
+// hashes of the cached keys, a bit for each entry which is used and a
+// bit for each entry which was read since the clock hand passed it
+typedef struct front_cache_set front_cache_set;
+struct front_cache_set {
+	unsigned int hashes[FRONT_CACHE_WAYS];
+	unsigned char used;
+	unsigned char referenced;
+	// entry which is checked first when the set needs a victim
+	unsigned char hand;
+};
+
+// cached key, with the server which stores it and its value
+typedef struct front_cache_entry front_cache_entry;
+struct front_cache_entry {
+	unsigned int key_length;
+	int server_id;
+	// value owned by the server (the values stay at the same address
+	// until their key is stored again)
+	char* value;
+	char key[FRONT_CACHE_KEY_LENGTH];
+};
+
+// Fixed-size, set associative cache with CLOCK eviction and TinyLFU
+// admission: every read counts its key in a count-min sketch (hits and
+// misses alike). A key which was read from its server takes a free entry
+// of its set; if the set is full, the clock hand of the set skips (and
+// clears) the entries read since it last passed them, and the key
+// replaces the entry the hand stops at only if the sketch says the key
+// is read more often. Keys read only once, as the keys of a scan, can't
+// push the popular keys out.
+typedef struct front_cache front_cache;
+struct front_cache {
+	// no_sets sets of FRONT_CACHE_WAYS entries (no_sets is a power of 2);
+	// the entries of set i start at entries[i * FRONT_CACHE_WAYS]
+	front_cache_set* sets;
+	front_cache_entry* entries;
+	unsigned int no_sets;
+	// blocks of counters of the sketch (no_blocks is a power of 2)
+	unsigned char* sketch;
+	unsigned int no_blocks;
+	// reads counted since the counters were last halved, and the number
+	// of reads after which they are halved
+	unsigned int samples;
+	unsigned int sample_size;
+	// number of reads answered by the cache and by the servers, and the
+	// number of keys admitted in the cache and rejected by the sketch
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long admitted;
+	unsigned long long rejected;
+};
+
+// create_front_cache() - Creates an empty front cache.
+// @arg1: Number of entries, rounded up to a power of 2 (at least
+//        FRONT_CACHE_WAYS).
+//
+// Return: The created cache.
+front_cache* create_front_cache(unsigned int capacity);
+
+// front_cache_lookup() - Finds a key in the cache.
+// @arg1: Front cache.
+// @arg2: Key, with its length and its hash.
+// @arg3: This function will RETURN the server ID which stores the value
+//        via this parameter, if the key is cached.
+//
+// The read is counted in the frequency sketch, even if it misses.
+//
+// Return: The cached value or NULL.
+char* front_cache_lookup(front_cache* cache, key_descriptor* key,
+						 int* server_id);
+
+// front_cache_admit() - Offers a key which was read from its server.
+// @arg1: Front cache.
+// @arg2: Key, with its length and its hash.
+// @arg3: ID of the server which stores the key.
+// @arg4: Value of the key, owned by the server.
+//
+// The key takes a free entry of its set, or the victim chosen by the
+// clock hand of the set if the sketch says it is read more often.
+void front_cache_admit(front_cache* cache, key_descriptor* key,
+					   int server_id, char* value);
+
+// function which drops a key from the cache, when it is stored again
+void front_cache_invalidate(front_cache* cache, key_descriptor* key);
+
+// function which empties the cache, when the keys change their servers;
+// the frequencies are kept
+void front_cache_clear(front_cache* cache);
+
+// function which frees the memory of the cache
+void free_front_cache(front_cache* cache);
+
+#endif  // FRONT_CACHE_H_
@@ -0,0 +1,243 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the index which keeps the key hashes
+// of a server ordered by their position on the hashring
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash_index.h"
+
+#define HASH_INDEX_INITIAL_CAPACITY 4
+
+// function which initialises the index and returns it
+hash_index* create_hash_index() {
+	hash_index* index = malloc(sizeof(hash_index));
+	DIE(index == NULL, "Error");
+
+	index->no_blocks = 0;
+	index->size = 0;
+	index->capacity = HASH_INDEX_INITIAL_CAPACITY;
+	index->blocks = malloc(index->capacity * sizeof(hash_index_block*));
+	DIE(index->blocks == NULL, "Error");
+
+	return index;
+}
+
+// function which returns the position of the first hash greater than
+// or equal to the given hash in an array of sorted hashes
+unsigned int hashes_lower_bound(unsigned int* hashes, unsigned int size,
+								unsigned int hash) {
+	unsigned int low = 0, high = size;
+
+	while (low < high) {
+		unsigned int middle = low + (high - low) / 2;
+		if (hashes[middle] < hash)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+// function which returns the first block whose last hash is greater than
+// or equal to the given hash, or no_blocks if there isn't such a block
+unsigned int hash_index_find_block(hash_index* index, unsigned int hash) {
+	unsigned int low = 0, high = index->no_blocks;
+
+	while (low < high) {
+		unsigned int middle = low + (high - low) / 2;
+		hash_index_block* block = index->blocks[middle];
+		if (block->hashes[block->size - 1] < hash)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+// function which adds an empty block at the given position
+// of the array of blocks and returns it
+hash_index_block* hash_index_add_block(hash_index* index,
+									   unsigned int position) {
+	if (index->no_blocks == index->capacity) {
+		index->capacity *= 2;
+		index->blocks = realloc(index->blocks,
+								index->capacity * sizeof(hash_index_block*));
+		DIE(index->blocks == NULL, "Error");
+	}
+
+	hash_index_block* block = malloc(sizeof(hash_index_block));
+	DIE(block == NULL, "Error");
+	block->size = 0;
+
+	memmove(&index->blocks[position + 1], &index->blocks[position],
+			(index->no_blocks - position) * sizeof(hash_index_block*));
+	index->blocks[position] = block;
+	index->no_blocks++;
+
+	return block;
+}
+
+// function which adds a hash to the index
+void hash_index_insert(hash_index* index, unsigned int hash) {
+	unsigned int position = 0;
+
+	// the hash is added in the first block which may contain it
+	// (or in the last block, if it is greater than all the hashes)
+	if (index->no_blocks == 0) {
+		hash_index_add_block(index, 0);
+	} else {
+		position = hash_index_find_block(index, hash);
+		if (position == index->no_blocks)
+			position--;
+	}
+	hash_index_block* block = index->blocks[position];
+
+	// split a full block in two halves
+	if (block->size == HASH_INDEX_BLOCK) {
+		hash_index_block* next = hash_index_add_block(index, position + 1);
+		next->size = HASH_INDEX_BLOCK / 2;
+		block->size = HASH_INDEX_BLOCK - next->size;
+		memcpy(next->hashes, &block->hashes[block->size],
+			   next->size * sizeof(unsigned int));
+
+		if (hash > block->hashes[block->size - 1])
+			block = next;
+	}
+
+	unsigned int slot = hashes_lower_bound(block->hashes, block->size, hash);
+	memmove(&block->hashes[slot + 1], &block->hashes[slot],
+			(block->size - slot) * sizeof(unsigned int));
+	block->hashes[slot] = hash;
+	block->size++;
+	index->size++;
+}
+
+// function which removes one occurrence of a hash from the index
+void hash_index_remove(hash_index* index, unsigned int hash) {
+	unsigned int position = hash_index_find_block(index, hash);
+	if (position == index->no_blocks)
+		return;
+
+	hash_index_block* block = index->blocks[position];
+	unsigned int slot = hashes_lower_bound(block->hashes, block->size, hash);
+	if (slot == block->size || block->hashes[slot] != hash)
+		return;
+
+	memmove(&block->hashes[slot], &block->hashes[slot + 1],
+			(block->size - slot - 1) * sizeof(unsigned int));
+	block->size--;
+	index->size--;
+
+	// an empty block is removed from the array of blocks
+	if (block->size == 0) {
+		free(block);
+		memmove(&index->blocks[position], &index->blocks[position + 1],
+				(index->no_blocks - position - 1) * sizeof(hash_index_block*));
+		index->no_blocks--;
+	}
+}
+
+// function which calls the given function for each distinct hash
+// of the index which is in the interval [first_hash, last_hash]
+void hash_index_for_each_in_range(hash_index* index, unsigned int first_hash,
+								  unsigned int last_hash,
+								  hash_index_callback callback, void* arg) {
+	unsigned int position = hash_index_find_block(index, first_hash);
+	int visited = 0;
+	unsigned int previous = 0;
+
+	for (; position < index->no_blocks; position++) {
+		hash_index_block* block = index->blocks[position];
+		unsigned int slot = hashes_lower_bound(block->hashes, block->size,
+											   first_hash);
+
+		for (; slot < block->size; slot++) {
+			unsigned int hash = block->hashes[slot];
+			if (hash > last_hash)
+				return;
+
+			// equal hashes are next to each other
+			if (!visited || hash != previous)
+				callback(hash, arg);
+			visited = 1;
+			previous = hash;
+		}
+	}
+}
+
+// function which writes the first distinct hashes of the index which
+// are in the interval [first_hash, last_hash]
+unsigned int hash_index_collect_range(hash_index* index,
+									  unsigned int first_hash,
+									  unsigned int last_hash,
+									  unsigned int* hashes,
+									  unsigned int max_hashes) {
+	unsigned int position = hash_index_find_block(index, first_hash);
+	unsigned int count = 0;
+
+	for (; position < index->no_blocks && count < max_hashes; position++) {
+		hash_index_block* block = index->blocks[position];
+		unsigned int slot = hashes_lower_bound(block->hashes, block->size,
+											   first_hash);
+
+		for (; slot < block->size && count < max_hashes; slot++) {
+			unsigned int hash = block->hashes[slot];
+			if (hash > last_hash)
+				return count;
+
+			// equal hashes are next to each other
+			if (count == 0 || hash != hashes[count - 1])
+				hashes[count++] = hash;
+		}
+	}
+
+	return count;
+}
+
+// function which counts the hashes of the index in an interval
+unsigned int hash_index_count_range(hash_index* index, unsigned int first_hash,
+									unsigned int last_hash) {
+	unsigned int position = hash_index_find_block(index, first_hash);
+	unsigned int count = 0;
+
+	for (; position < index->no_blocks; position++) {
+		hash_index_block* block = index->blocks[position];
+		unsigned int start = hashes_lower_bound(block->hashes, block->size,
+												first_hash);
+
+		// the interval ends in this block
+		if (block->hashes[block->size - 1] > last_hash) {
+			unsigned int end = hashes_lower_bound(block->hashes, block->size,
+												  last_hash);
+			while (end < block->size && block->hashes[end] == last_hash)
+				end++;
+			return count + (end > start ? end - start : 0);
+		}
+		count += block->size - start;
+	}
+
+	return count;
+}
+
+// function which calls the given function for each hash of the index,
+// once for each of its occurrences
+void hash_index_for_each(hash_index* index, hash_index_callback callback,
+						 void* arg) {
+	for (unsigned int i = 0; i < index->no_blocks; i++) {
+		hash_index_block* block = index->blocks[i];
+		for (unsigned int slot = 0; slot < block->size; slot++)
+			callback(block->hashes[slot], arg);
+	}
+}
+
+// function which frees the memory of the index
+void free_hash_index(hash_index* index) {
+	for (unsigned int i = 0; i < index->no_blocks; i++)
+		free(index->blocks[i]);
+
+	free(index->blocks);
+	free(index);
+}
@@ -0,0 +1,95 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the index which keeps
+// the key hashes of a server ordered by their position on the hashring
+
+#ifndef HASH_INDEX_H_
+#define HASH_INDEX_H_
+
+#include "utils.h"
+
+// maximum number of hashes stored in a block of the index
+#define HASH_INDEX_BLOCK 512
+
+// block of the index, storing a sorted array of hashes
+typedef struct hash_index_block hash_index_block;
+struct hash_index_block {
+	unsigned int size;
+	unsigned int hashes[HASH_INDEX_BLOCK];
+};
+
+// sorted multiset of hashes, stored as a sorted array of blocks; a hash
+// is found by binary searching the blocks and then the hashes of its
+// block, and inserting or removing a hash only shifts the hashes of
+// one block, so the index stays cheap to update for any number of keys
+typedef struct hash_index hash_index;
+struct hash_index {
+	hash_index_block** blocks;
+	// number of blocks in use
+	unsigned int no_blocks;
+	// number of blocks the array can hold before being reallocated
+	unsigned int capacity;
+	// number of hashes stored in the index
+	unsigned int size;
+};
+
+// function called for each hash of an interval
+typedef void (*hash_index_callback)(unsigned int hash, void* arg);
+
+// function which initialises and returns an empty index
+hash_index* create_hash_index();
+
+// function which adds a hash to the index
+void hash_index_insert(hash_index* index, unsigned int hash);
+
+// function which removes one occurrence of a hash from the index
+void hash_index_remove(hash_index* index, unsigned int hash);
+
+// hash_index_for_each_in_range() - Calls a function for each distinct
+// hash of the index which is in the interval [first_hash, last_hash].
+// @arg1: Index whose hashes are visited.
+// @arg2: First hash of the interval.
+// @arg3: Last hash of the interval.
+// @arg4: Function which is called for each hash.
+// @arg5: Argument given to the function.
+//
+// The function must not modify the index.
+void hash_index_for_each_in_range(hash_index* index, unsigned int first_hash,
+								  unsigned int last_hash,
+								  hash_index_callback callback, void* arg);
+
+// hash_index_collect_range() - Gets the first distinct hashes of the
+// index which are in the interval [first_hash, last_hash].
+// @arg1: Index whose hashes are read.
+// @arg2: First hash of the interval.
+// @arg3: Last hash of the interval.
+// @arg4: Array in which the hashes are written, in ascending order.
+// @arg5: Maximum number of hashes.
+//
+// Return: Number of hashes written; it is less than the maximum only if
+//         the interval has no other hashes.
+unsigned int hash_index_collect_range(hash_index* index,
+									  unsigned int first_hash,
+									  unsigned int last_hash,
+									  unsigned int* hashes,
+									  unsigned int max_hashes);
+
+// function which returns the number of hashes of the index (counting
+// each occurrence) in the interval [first_hash, last_hash]; the blocks
+// inside the interval are counted by their size, without being read
+unsigned int hash_index_count_range(hash_index* index, unsigned int first_hash,
+									unsigned int last_hash);
+
+// hash_index_for_each() - Calls a function for each hash of the index,
+// once for each of its occurrences.
+// @arg1: Index whose hashes are visited.
+// @arg2: Function which is called for each hash.
+// @arg3: Argument given to the function.
+//
+// The function must not modify the index.
+void hash_index_for_each(hash_index* index, hash_index_callback callback,
+						 void* arg);
+
+// function which frees the memory of the index
+void free_hash_index(hash_index* index);
+
+#endif  // HASH_INDEX_H_
@@ -0,0 +1,168 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the hashring implementation
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashring.h"
+#include "server.h"
+
+#define HASHRING_INITIAL_CAPACITY 16
+
+// hash function used for hashing the server values
+unsigned int hash_function_servers(void *a) {
+    unsigned int uint_a = *((unsigned int *)a);
+
+    uint_a = ((uint_a >> 16u) ^ uint_a) * 0x45d9f3b;
+    uint_a = ((uint_a >> 16u) ^ uint_a) * 0x45d9f3b;
+    uint_a = (uint_a >> 16u) ^ uint_a;
+    return uint_a;
+}
+
+// hash function used for hashing a replica label of a server
+unsigned int hash_function_label(unsigned int server_id, unsigned int replica)
+{
+	unsigned long long label = (unsigned long long)replica * MAX_HASH +
+							   server_id;
+	unsigned int low = (unsigned int)label;
+	unsigned int high = (unsigned int)(label >> 32);
+
+	// labels which fit on 32 bits are hashed as before, so the first
+	// replicas of a server keep their position on the hashring
+	if (high != 0)
+		low ^= hash_function_servers(&high);
+
+	return hash_function_servers(&low);
+}
+
+// function which initialises the hashring and returns it
+hashring* create_hashring() {
+	// allocate memory for the hashring
+	hashring* ring = malloc(sizeof(hashring));
+	DIE(ring == NULL, "Error");
+
+	// allocate memory for the array of labels
+	ring->size = 0;
+	ring->capacity = HASHRING_INITIAL_CAPACITY;
+	ring->labels = malloc(ring->capacity * sizeof(hashring_label));
+	DIE(ring->labels == NULL, "Error");
+
+	return ring;
+}
+
+// function which returns a copy of the hashring
+hashring* copy_hashring(hashring* ring) {
+	hashring* copy = malloc(sizeof(hashring));
+	DIE(copy == NULL, "Error");
+
+	copy->size = ring->size;
+	copy->capacity = ring->capacity;
+	copy->labels = malloc(copy->capacity * sizeof(hashring_label));
+	DIE(copy->labels == NULL, "Error");
+	memcpy(copy->labels, ring->labels, ring->size * sizeof(hashring_label));
+
+	return copy;
+}
+
+// function which returns the position of the first label with the hash
+// greater than or equal to the given hash, using binary search
+unsigned int hashring_lower_bound(hashring* ring, unsigned int hash) {
+	unsigned int low = 0, high = ring->size;
+
+	while (low < high) {
+		unsigned int middle = low + (high - low) / 2;
+		if (ring->labels[middle].hash < hash)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+// function which returns the position of the server label on which
+// an object with the given key hash should be stored
+unsigned int hashring_key_position(hashring* ring, unsigned int key_hash) {
+	unsigned int position = hashring_lower_bound(ring, key_hash);
+
+	// if there isn't any label with a hash greater than the key's hash,
+	// the object should be stored on the first label of the hashring
+	if (position == ring->size)
+		return 0;
+
+	return position;
+}
+
+// comparison function used for sorting the labels of a new server; a label
+// is placed before the labels with the same hash, so between the labels
+// with equal hashes the last added one comes first
+int compare_new_labels(const void* a, const void* b) {
+	const hashring_label* label_a = a;
+	const hashring_label* label_b = b;
+
+	if (label_a->hash != label_b->hash)
+		return (label_a->hash > label_b->hash) ? 1 : -1;
+	return (label_a->replica < label_b->replica) -
+		   (label_a->replica > label_b->replica);
+}
+
+// function which adds the labels of a server on the hashring; the new
+// labels are sorted and then merged from the end of the array, so adding
+// all of them costs a single pass through the hashring
+void hashring_add_server(hashring* ring, unsigned int server_id,
+						 unsigned int vnodes) {
+	// grow the array of labels if the new labels don't fit
+	if (ring->size + vnodes > ring->capacity) {
+		while (ring->size + vnodes > ring->capacity)
+			ring->capacity *= 2;
+		ring->labels = realloc(ring->labels,
+							   ring->capacity * sizeof(hashring_label));
+		DIE(ring->labels == NULL, "Error");
+	}
+
+	// create and sort the new labels
+	hashring_label* new_labels = malloc(vnodes * sizeof(hashring_label));
+	DIE(new_labels == NULL, "Error");
+
+	for (unsigned int i = 0; i < vnodes; i++) {
+		new_labels[i].hash = hash_function_label(server_id, i);
+		new_labels[i].server_id = server_id;
+		new_labels[i].replica = i;
+	}
+	qsort(new_labels, vnodes, sizeof(hashring_label), compare_new_labels);
+
+	// merge the two sorted arrays, starting from the greatest hash
+	int old_index = (int)ring->size - 1;
+	int new_index = (int)vnodes - 1;
+	int position = (int)(ring->size + vnodes) - 1;
+
+	while (new_index >= 0) {
+		if (old_index >= 0 &&
+			ring->labels[old_index].hash >= new_labels[new_index].hash)
+			ring->labels[position--] = ring->labels[old_index--];
+		else
+			ring->labels[position--] = new_labels[new_index--];
+	}
+
+	ring->size += vnodes;
+	free(new_labels);
+}
+
+// function which removes all the labels of a server from the hashring,
+// compacting the array in a single pass
+void hashring_remove_server(hashring* ring, unsigned int server_id) {
+	unsigned int size = 0;
+
+	for (unsigned int i = 0; i < ring->size; i++) {
+		if (ring->labels[i].server_id != server_id)
+			ring->labels[size++] = ring->labels[i];
+	}
+
+	ring->size = size;
+}
+
+// function which frees the memory of the hashring
+void free_hashring(hashring* ring) {
+	free(ring->labels);
+	free(ring);
+}
@@ -0,0 +1,85 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing
+// the hashring implementation
+
+#ifndef HASHRING_H_
+#define HASHRING_H_
+
+#include "utils.h"
+
+// element of the hashring; the hash of the label is computed only once,
+// when the label is added, so routing never has to hash the servers again
+typedef struct hashring_label hashring_label;
+struct hashring_label {
+	// hash of the label, used for ordering the hashring
+	unsigned int hash;
+	// id of the server the label belongs to
+	unsigned int server_id;
+	// index of the label among the server's labels (0 is the server id)
+	unsigned int replica;
+};
+
+// hashring data structure; the labels are stored in a contiguous array
+// sorted in ascending order by hash, so a position can be found
+// using binary search
+typedef struct hashring hashring;
+struct hashring {
+	hashring_label* labels;
+	// number of labels stored on the hashring
+	unsigned int size;
+	// number of labels the array can hold before being reallocated
+	unsigned int capacity;
+};
+
+// hash function for server labels
+unsigned int hash_function_servers(void *a);
+
+// hash_function_label() - Hashes the replica label of a server.
+// @arg1: ID of the server.
+// @arg2: Index of the replica.
+//
+// The label is encoded as replica * MAX_HASH + server_id; labels which
+// don't fit on 32 bits are folded, so the number of replicas is not capped.
+unsigned int hash_function_label(unsigned int server_id, unsigned int replica);
+
+// function which initialises and returns an empty hashring
+hashring* create_hashring();
+
+// function which returns a copy of the hashring, which can be changed
+// while the original is still read by other threads
+hashring* copy_hashring(hashring* ring);
+
+// hashring_lower_bound() - Finds the first label with a hash greater
+// than or equal to the given hash.
+// @arg1: Hashring in which the search is done.
+// @arg2: Hash value which is searched.
+//
+// Return: The position of the label or the size of the hashring
+//         (in case all the labels have a smaller hash).
+unsigned int hashring_lower_bound(hashring* ring, unsigned int hash);
+
+// hashring_key_position() - Finds the label which owns a given key hash.
+// @arg1: Hashring in which the search is done.
+// @arg2: Hash value of the key.
+//
+// Return: The position of the first label with the hash greater than or
+//         equal to the key's hash; because the hashring is circular, the
+//         first label is returned if there isn't such a label.
+unsigned int hashring_key_position(hashring* ring, unsigned int key_hash);
+
+// hashring_add_server() - Adds all the labels of a server on the hashring.
+// @arg1: Hashring on which the labels are added.
+// @arg2: ID of the server.
+// @arg3: Number of labels (virtual nodes) of the server.
+void hashring_add_server(hashring* ring, unsigned int server_id,
+						 unsigned int vnodes);
+
+// hashring_remove_server() - Removes all the labels of a server.
+// @arg1: Hashring from which the labels are removed.
+// @arg2: ID of the server.
+void hashring_remove_server(hashring* ring, unsigned int server_id);
+
+// function which frees the memory of the hashring
+void free_hashring(hashring* ring);
+
+#endif  // HASHRING_H_
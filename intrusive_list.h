@@ -0,0 +1,96 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header containing the macros which generate circular doubly linked
+// lists specialised for a type, whose links are stored in the elements
+
+#ifndef INTRUSIVE_LIST_H_
+#define INTRUSIVE_LIST_H_
+
+// Unlike the generic cdll (circular_doubly_linked_list.h), these lists
+// don't allocate nodes and don't copy data: an element embeds its links,
+// so it is linked where it was allocated, and the functions of a list
+// know the type of its elements, so the comparisons of a search are
+// inlined instead of going through void pointers.
+
+// links of an element, which is in at most one list at a time
+#define INTRUSIVE_LINK(type)												\
+	struct {																\
+		type* next;															\
+		type* prev;															\
+	}
+
+// INTRUSIVE_LIST_TYPE() - Declares a list of elements.
+// @arg1: Name of the list type.
+// @arg2: Type of the elements, which may still be incomplete.
+//
+// A list filled with zeros is empty, so an array of lists can be
+// allocated with calloc.
+#define INTRUSIVE_LIST_TYPE(name, type)										\
+	typedef struct name name;												\
+	struct name {															\
+		type* head;															\
+		unsigned int size;													\
+	}
+
+// INTRUSIVE_LIST_FUNCTIONS() - Defines the functions of a list.
+// @arg1: Name of the list type, declared with INTRUSIVE_LIST_TYPE.
+// @arg2: Type of the elements, which must be complete.
+// @arg3: Member of the elements declared with INTRUSIVE_LINK.
+// @arg4: Type of the keys which are searched.
+// @arg5: Function int match(const type* element, key_type key) which
+//        returns 1 if the element has the key.
+//
+// The defined functions are name_push_back(list, element),
+// name_remove(list, element), name_pop_front(list), name_next(list,
+// element), which returns NULL after the last element, and
+// name_find(list, key). They are static inline, so the header can be
+// used by several source files.
+#define INTRUSIVE_LIST_FUNCTIONS(name, type, link, key_type, match)			\
+	static inline void name##_push_back(name* list, type* element) {		\
+		if (list->head == NULL) {											\
+			element->link.next = element;									\
+			element->link.prev = element;									\
+			list->head = element;											\
+		} else {															\
+			type* tail = list->head->link.prev;								\
+			element->link.next = list->head;								\
+			element->link.prev = tail;										\
+			tail->link.next = element;										\
+			list->head->link.prev = element;								\
+		}																	\
+		list->size++;														\
+	}																		\
+																			\
+	static inline void name##_remove(name* list, type* element) {			\
+		if (--list->size == 0) {											\
+			list->head = NULL;												\
+			return;															\
+		}																	\
+		element->link.prev->link.next = element->link.next;					\
+		element->link.next->link.prev = element->link.prev;					\
+		if (list->head == element)											\
+			list->head = element->link.next;								\
+	}																		\
+																			\
+	static inline type* name##_pop_front(name* list) {						\
+		type* element = list->head;											\
+		if (element != NULL)												\
+			name##_remove(list, element);									\
+		return element;														\
+	}																		\
+																			\
+	static inline type* name##_next(name* list, type* element) {			\
+		type* next = element->link.next;									\
+		return next == list->head ? NULL : next;							\
+	}																		\
+																			\
+	static inline type* name##_find(name* list, key_type key) {				\
+		type* element = list->head;											\
+		for (unsigned int i = 0; i < list->size; i++) {						\
+			if (match(element, key))										\
+				return element;												\
+			element = element->link.next;									\
+		}																	\
+		return NULL;														\
+	}
+
+#endif  // INTRUSIVE_LIST_H_
@@ -0,0 +1,143 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the filter of the key hashes of a server
+
+#include <stdlib.h>
+
+#include "key_filter.h"
+
+// function which allocates the zeroed blocks of a filter
+void key_filter_alloc(key_filter* filter, unsigned int no_blocks) {
+	filter->no_blocks = no_blocks;
+	filter->blocks = calloc(no_blocks, KEY_FILTER_BLOCK);
+	DIE(filter->blocks == NULL, "Error");
+}
+
+// function which initialises and returns an empty filter
+key_filter* create_key_filter() {
+	key_filter* filter = malloc(sizeof(key_filter));
+	DIE(filter == NULL, "Error");
+
+	key_filter_alloc(filter, KEY_FILTER_MIN_BLOCKS);
+	filter->negatives = 0;
+	filter->false_positives = 0;
+
+	return filter;
+}
+
+// function which returns the block of a hash and fills the positions of
+// its counters in the block
+unsigned char* key_filter_block(key_filter* filter, unsigned int hash,
+								unsigned int* positions)
+{
+	unsigned int block = hash * 0x27d4eb2f;
+	block ^= block >> 15;
+
+	// the other bits give the counters, 7 bits for each of them
+	unsigned int bits = hash * 0x165667b1;
+	bits ^= bits >> 13;
+	for (int i = 0; i < KEY_FILTER_PROBES; i++)
+		positions[i] = (bits >> (7 * i)) & (2 * KEY_FILTER_BLOCK - 1);
+
+	return &filter->blocks[(block & (filter->no_blocks - 1)) *
+						   KEY_FILTER_BLOCK];
+}
+
+// function which returns a counter of a block
+unsigned int counter_get(unsigned char* block, unsigned int position) {
+	return block[position / 2] >> (position % 2 * 4) & KEY_FILTER_MAX_COUNT;
+}
+
+// function which adds the given difference (1 or -1) to a counter of
+// a block, unless the counter is saturated
+void counter_update(unsigned char* block, unsigned int position,
+					int difference)
+{
+	unsigned int count = counter_get(block, position);
+	if (count == KEY_FILTER_MAX_COUNT)
+		return;
+
+	int shift = position % 2 * 4;
+	block[position / 2] &= ~(KEY_FILTER_MAX_COUNT << shift);
+	block[position / 2] |= (count + difference) << shift;
+}
+
+// function which counts a hash in the filter
+void key_filter_add(key_filter* filter, unsigned int hash) {
+	unsigned int positions[KEY_FILTER_PROBES];
+	unsigned char* block = key_filter_block(filter, hash, positions);
+
+	for (int i = 0; i < KEY_FILTER_PROBES; i++)
+		counter_update(block, positions[i], 1);
+}
+
+// function which removes a hash counted in the filter
+void key_filter_remove(key_filter* filter, unsigned int hash) {
+	unsigned int positions[KEY_FILTER_PROBES];
+	unsigned char* block = key_filter_block(filter, hash, positions);
+
+	for (int i = 0; i < KEY_FILTER_PROBES; i++)
+		counter_update(block, positions[i], -1);
+}
+
+// function which checks if a hash may have been counted in the filter
+int key_filter_may_contain(key_filter* filter, unsigned int hash) {
+	unsigned int positions[KEY_FILTER_PROBES];
+	unsigned char* block = key_filter_block(filter, hash, positions);
+
+	for (int i = 0; i < KEY_FILTER_PROBES; i++) {
+		if (counter_get(block, positions[i]) == 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+// function called for each hash of the index which is recounted
+void key_filter_recount(unsigned int hash, void* arg) {
+	key_filter_add(arg, hash);
+}
+
+// function which recounts the hashes of an index in a new array of
+// the given number of blocks
+void key_filter_resize(key_filter* filter, hash_index* index,
+					   unsigned int no_blocks)
+{
+	free(filter->blocks);
+	key_filter_alloc(filter, no_blocks);
+	hash_index_for_each(index, key_filter_recount, filter);
+}
+
+// function which recounts the hashes of an index in as few blocks as
+// they need
+void key_filter_rebuild(key_filter* filter, hash_index* index) {
+	unsigned int no_blocks = KEY_FILTER_MIN_BLOCKS;
+	while (no_blocks * KEY_FILTER_BLOCK_KEYS < index->size)
+		no_blocks *= 2;
+
+	key_filter_resize(filter, index, no_blocks);
+}
+
+// function which rebuilds the filter if its size doesn't fit the index;
+// a filter which shrinks keeps room for as many hashes as it holds, so
+// it doesn't grow back after a few stores
+void key_filter_fit(key_filter* filter, hash_index* index) {
+	unsigned int capacity = filter->no_blocks * KEY_FILTER_BLOCK_KEYS;
+
+	if (index->size > capacity)
+		key_filter_rebuild(filter, index);
+	else if (filter->no_blocks > KEY_FILTER_MIN_BLOCKS &&
+			 index->size < capacity / 4)
+		key_filter_resize(filter, index, filter->no_blocks / 2);
+}
+
+// function which returns the false positive rate of the filter
+double key_filter_false_positive_rate(key_filter* filter) {
+	unsigned long long misses = filter->negatives + filter->false_positives;
+	return misses ? (double)filter->false_positives / misses : 0;
+}
+
+// function which frees the memory of the filter
+void free_key_filter(key_filter* filter) {
+	free(filter->blocks);
+	free(filter);
+}
@@ -0,0 +1,74 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the filter which tells a
+// server that a key is missing without searching its hashtable
+
+#ifndef KEY_FILTER_H_
+#define KEY_FILTER_H_
+
+#include "hash_index.h"
+
+// the counters of the filter are grouped in blocks of KEY_FILTER_BLOCK
+// bytes (a cache line), with two 4-bit counters in each byte; a hash has
+// KEY_FILTER_PROBES counters in a single block, so checking it reads one
+// cache line; a counter which reaches KEY_FILTER_MAX_COUNT stays there,
+// since it doesn't know how many hashes it counts anymore
+#define KEY_FILTER_BLOCK 64
+#define KEY_FILTER_PROBES 4
+#define KEY_FILTER_MAX_COUNT 15
+
+// the filter holds at most KEY_FILTER_BLOCK_KEYS hashes per block (16
+// counters for each hash); it is rebuilt twice as large when it holds
+// more and half as large when it holds less than a quarter of them
+#define KEY_FILTER_BLOCK_KEYS 8
+#define KEY_FILTER_MIN_BLOCKS 4
+
+// Blocked counting Bloom filter of the key hashes of a server. A hash
+// increments its counters when a key is added and decrements them when
+// the key is removed, so the filter follows the stores, removes and moves
+// of the server without being rebuilt. A key whose counters aren't all
+// set is surely missing; a key whose counters are all set is searched in
+// the hashtable, and it is a false positive if it isn't there.
+typedef struct key_filter key_filter;
+struct key_filter {
+	// no_blocks blocks of KEY_FILTER_BLOCK bytes (no_blocks is a power of 2)
+	unsigned char* blocks;
+	unsigned int no_blocks;
+	// number of lookups answered by the filter and number of lookups of
+	// missing keys which passed it, counted by the server
+	unsigned long long negatives;
+	unsigned long long false_positives;
+};
+
+// function which initialises and returns an empty filter
+key_filter* create_key_filter();
+
+// function which counts a hash in the filter
+void key_filter_add(key_filter* filter, unsigned int hash);
+
+// function which removes a hash counted in the filter
+void key_filter_remove(key_filter* filter, unsigned int hash);
+
+// function which returns 0 if no key with the given hash was counted in
+// the filter, and 1 if such a key may have been counted
+int key_filter_may_contain(key_filter* filter, unsigned int hash);
+
+// key_filter_rebuild() - Recounts the hashes of an index.
+// @arg1: Filter which is rebuilt.
+// @arg2: Index with the hashes counted by the filter.
+//
+// The filter gets as many blocks as the hashes need and its saturated
+// counters are cleared.
+void key_filter_rebuild(key_filter* filter, hash_index* index);
+
+// function which rebuilds the filter if the number of hashes of the index
+// outgrew it, or is much smaller than it
+void key_filter_fit(key_filter* filter, hash_index* index);
+
+// function which returns the fraction of the lookups of missing keys
+// which passed the filter
+double key_filter_false_positive_rate(key_filter* filter);
+
+// function which frees the memory of the filter
+void free_key_filter(key_filter* filter);
+
+#endif  // KEY_FILTER_H_
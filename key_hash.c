@@ -0,0 +1,94 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the hash function of the keys
+
+#include <string.h>
+
+#include "key_hash.h"
+
+// function which reads 8 bytes (the keys are not aligned)
+unsigned long long key_hash_read64(const unsigned char* bytes) {
+	unsigned long long word;
+	memcpy(&word, bytes, sizeof(word));
+	return word;
+}
+
+// function which reads 4 bytes
+unsigned long long key_hash_read32(const unsigned char* bytes) {
+	unsigned int word;
+	memcpy(&word, bytes, sizeof(word));
+	return word;
+}
+
+// function which multiplies two words on 128 bits and folds the product
+unsigned long long key_hash_mix(unsigned long long a, unsigned long long b) {
+	unsigned __int128 product = (unsigned __int128)a * b;
+	return (unsigned long long)product ^ (unsigned long long)(product >> 64);
+}
+
+// function which hashes a string of bytes, a word at a time
+unsigned long long key_hash64(const void* data, size_t length) {
+	const unsigned char* bytes = data;
+	unsigned long long seed = KEY_HASH_SEED ^
+		key_hash_mix(KEY_HASH_SEED ^ KEY_HASH_PRIME1, KEY_HASH_PRIME2);
+	unsigned long long a, b;
+
+	if (length <= 16) {
+		// the short keys are read as (possibly overlapping) words from
+		// their start and their end, without a loop
+		if (length >= 4) {
+			size_t middle = (length >> 3) << 2;
+			a = (key_hash_read32(bytes) << 32) |
+				key_hash_read32(bytes + middle);
+			b = (key_hash_read32(bytes + length - 4) << 32) |
+				key_hash_read32(bytes + length - 4 - middle);
+		} else if (length > 0) {
+			a = ((unsigned long long)bytes[0] << 16) |
+				((unsigned long long)bytes[length >> 1] << 8) |
+				bytes[length - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t remaining = length;
+		while (remaining > 16) {
+			seed = key_hash_mix(key_hash_read64(bytes) ^ KEY_HASH_PRIME2,
+								key_hash_read64(bytes + 8) ^ seed);
+			bytes += 16;
+			remaining -= 16;
+		}
+
+		// the last 16 bytes, which may overlap the previous block
+		a = key_hash_read64(bytes + remaining - 16);
+		b = key_hash_read64(bytes + remaining - 8);
+	}
+
+	a ^= KEY_HASH_PRIME2;
+	b ^= seed;
+	unsigned __int128 product = (unsigned __int128)a * b;
+	a = (unsigned long long)product;
+	b = (unsigned long long)(product >> 64);
+
+	return key_hash_mix(a ^ KEY_HASH_PRIME1 ^ length, b ^ KEY_HASH_PRIME2);
+}
+
+// function which folds a 64-bit key hash on 32 bits
+unsigned int key_hash_fold(unsigned long long hash) {
+	return (unsigned int)(hash ^ (hash >> 32));
+}
+
+// function which fills the descriptor of a key
+void key_descriptor_init(key_descriptor* descriptor, char* key) {
+	size_t length = strlen(key);
+
+	descriptor->key = key;
+	descriptor->length = length;
+	descriptor->hash = key_hash_fold(key_hash64(key, length));
+}
+
+// hash function used for hashing the key values
+unsigned int hash_function_key(void *a) {
+	char* key = a;
+
+	return key_hash_fold(key_hash64(key, strlen(key)));
+}
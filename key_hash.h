@@ -0,0 +1,50 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the hash function
+// of the keys and the key descriptors
+
+#ifndef KEY_HASH_H_
+#define KEY_HASH_H_
+
+#include <stddef.h>
+
+// constants of the key hash (the seed and the multipliers are odd 64-bit
+// values with balanced bits, as in wyhash)
+#define KEY_HASH_SEED 0xa0761d6478bd642fULL
+#define KEY_HASH_PRIME1 0xe7037ed1a0b428dbULL
+#define KEY_HASH_PRIME2 0x8ebc6af09c88c6e3ULL
+
+// key of a request, hashed once by the load balancer; the hash is used
+// for routing the key, for finding its bucket (or slot) in the server
+// and it is stored with the key's entry, so rehashing and migrating the
+// entry never read the key bytes again
+typedef struct key_descriptor key_descriptor;
+struct key_descriptor {
+	char* key;
+	// length of the key, without the terminating null byte
+	unsigned int length;
+	// 32-bit fold of the key's 64-bit hash, the width of the hashring
+	// labels and of the servers' hash indexes
+	unsigned int hash;
+};
+
+// key_hash64() - Hashes a string of bytes.
+// @arg1: Bytes which are hashed.
+// @arg2: Number of bytes.
+//
+// The bytes are read 8 (or 16) at a time and mixed with 64x64->128 bit
+// multiplications, so a key costs a few multiplications instead of one
+// step for each byte.
+//
+// Return: The 64-bit hash of the bytes.
+unsigned long long key_hash64(const void* data, size_t length);
+
+// function which folds a 64-bit key hash on 32 bits
+unsigned int key_hash_fold(unsigned long long hash);
+
+// function which fills the descriptor of a key: its length and its hash
+void key_descriptor_init(key_descriptor* descriptor, char* key);
+
+// hash function for keys; it returns the hash of a key descriptor
+unsigned int hash_function_key(void *a);
+
+#endif  // KEY_HASH_H_
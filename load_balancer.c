@@ -4,279 +4,1944 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "load_balancer.h"
+#include "command_log.h"
+
+// object of a batch, with the server on which it is routed
+typedef struct batch_entry batch_entry;
+struct batch_entry {
+	unsigned int server_id;
+	unsigned int hash;
+	// position of the object in the batch
+	unsigned int index;
+	// length of the key, kept so it isn't measured again
+	unsigned int length;
+};
+
+// interval of the hashring whose objects an incremental migration still
+// has to move away from a donor server
+typedef struct migration_range migration_range;
+struct migration_range {
+	unsigned int donor_id;
+	unsigned int first_hash;
+	unsigned int last_hash;
+};
 
 struct load_balancer {
 	// array of servers hashtables
 	// servers_ht[i] represents the server of the i server
 	server_memory** servers_ht;
-	// hashring represented as a cdll
-    cdll_list* hashring;
+	// number of labels of each server; server_vnodes[i] is 0 if the
+	// i server is not on the load balancer
+	unsigned int* server_vnodes;
+	// router which finds the server of a key (by default, a hashring
+	// represented as a sorted array of labels); when the load balancer is
+	// shared between threads, a changed router is published as a new copy
+	// and the old one is freed once no reader uses it
+	router* _Atomic routes;
+	// options given when the load balancer was initialised
+	load_balancer_config config;
+	// counters of the threads which are reading the router
+	rcu readers;
+	// lock which lets only one thread add or remove servers at a time
+	pthread_mutex_t writer_lock;
+	// array used for grouping the objects of a batch by server, kept
+	// between batches so it is allocated only when it needs to grow
+	batch_entry* batch;
+	unsigned int batch_capacity;
+	// with bounded loads: the number of objects, the servers which passed
+	// an object on to the next server because they were full (and how
+	// many they are) and the marks of the servers visited by a probe
+	unsigned int no_objects;
+	unsigned char* overflowed;
+	unsigned int no_overflowed;
+	unsigned int* probe_marks;
+	unsigned int probe_stamp;
+	// snapshot from which the load balancer was restored, mapped until
+	// the load balancer is freed (NULL if there isn't any)
+	char* snapshot;
+	size_t snapshot_size;
+	// write-ahead log of the stores and of the added and removed servers
+	// (NULL if there isn't any)
+	write_ahead_log* log;
+	// with replication: the recent reads answered by each server (for
+	// REPLICA_READ_LEAST_LOADED), the reads since they were last halved
+	// and the turn of the next read (for REPLICA_READ_ROUND_ROBIN)
+	unsigned int* replica_loads;
+	unsigned int window_reads;
+	unsigned int next_replica;
+	// cache of the most read keys (NULL if there isn't any)
+	front_cache* cache;
+	// with migration_step: the router used before the server was added
+	// or removed (NULL if no migration is in progress), the intervals
+	// whose objects still have to move (the next one is moved first) and
+	// the progress of the migrations; a removed server stays in
+	// servers_ht until all its objects are moved
+	router* old_routes;
+	migration_range* migration_ranges;
+	unsigned int no_migration_ranges;
+	unsigned int next_migration_range;
+	migration_stats migration;
+};
+
+// probe sequence of a key with bounded loads: the servers of the labels
+// which follow the key's position on the hashring, each one visited once
+typedef struct load_probe load_probe;
+struct load_probe {
+	unsigned int position;
+	// number of labels which weren't visited yet
+	unsigned int remaining;
+};
+
+// arguments of the function which moves an object over the bound
+typedef struct bound_args bound_args;
+struct bound_args {
+	load_balancer* main_server;
+	// server which gives up the object, or -1
+	int donor_id;
+};
+
+// arguments of the function which moves the replicas taken over by an
+// added server
+typedef struct replica_args replica_args;
+struct replica_args {
+	load_balancer* main_server;
+	// server which may give up its replicas and the added server
+	unsigned int donor_id;
+	unsigned int server_id;
 };
 
-// hash function used for hashing the server values
-unsigned int hash_function_servers(void *a) {
-    unsigned int uint_a = *((unsigned int *)a);
+// arguments of the function which copies the objects of a server on
+// an added server
+typedef struct copy_args copy_args;
+struct copy_args {
+	server_memory* donor;
+	server_memory* recipient;
+};
 
-    uint_a = ((uint_a >> 16u) ^ uint_a) * 0x45d9f3b;
-    uint_a = ((uint_a >> 16u) ^ uint_a) * 0x45d9f3b;
-    uint_a = (uint_a >> 16u) ^ uint_a;
-    return uint_a;
+// function which fills a configuration with the default options
+void default_load_balancer_config(load_balancer_config* config) {
+	memset(config, 0, sizeof(load_balancer_config));
+	config->backend = SERVER_BACKEND_CHAINED;
+	config->load_epsilon = DEFAULT_LOAD_EPSILON;
 }
 
 // function which initialises the main load balancer
-// and returns it
+// with the default options and returns it
 load_balancer* init_load_balancer() {
+	load_balancer_config config;
+	default_load_balancer_config(&config);
+
+	return init_load_balancer_config(&config);
+}
+
+// function which initialises the main load balancer
+// with the given options and returns it
+load_balancer* init_load_balancer_config(load_balancer_config* config) {
 	// allocate memory for the load balancer
 	load_balancer* main_server = malloc(sizeof(load_balancer));
     DIE(main_server == NULL, "Error");
+	main_server->config = *config;
+	if (main_server->config.clock == NULL)
+		main_server->config.clock = monotonic_ms;
 
 	// allocate memory for the aray of servers hashtables
     main_server->servers_ht = calloc(MAX_HASH, sizeof(server_memory*));
     DIE(main_server->servers_ht == NULL, "Error");
 
-	// create the hashring cdll
-	main_server->hashring = create_list(sizeof(unsigned int));
+	// allocate memory for the array of labels counts
+	main_server->server_vnodes = calloc(MAX_HASH, sizeof(unsigned int));
+	DIE(main_server->server_vnodes == NULL, "Error");
+
+	// create the hashring (or the router of the chosen strategy)
+	main_server->routes = create_router(config->routing);
+	rcu_init(&main_server->readers);
+	pthread_mutex_init(&main_server->writer_lock, NULL);
+
+	main_server->batch = NULL;
+	main_server->batch_capacity = 0;
+
+	// the probe sequences of bounded loads follow the labels of a hashring
+	// and change several servers, so they are not shared between threads
+	DIE(config->bounded_loads && (config->routing != ROUTING_RING ||
+		config->thread_safe), "bounded loads need a hashring "
+		"which is not thread safe");
+	// the replicas of a key are found on the hashring in the same way
+	int replicated = config->replication_factor > 1;
+	DIE(replicated && (config->routing != ROUTING_RING ||
+		config->thread_safe || config->bounded_loads), "replication needs "
+		"a hashring which is not thread safe, without bounded loads");
+	DIE(config->replication_factor > MAX_REPLICATION_FACTOR,
+		"replication factor too large");
+	DIE(config->front_cache_size && config->thread_safe,
+		"the front cache needs a load balancer which is not thread safe");
+	DIE(config->front_cache_size && config->server_budget,
+		"the front cache can't be used with memory budgets");
+	DIE(config->front_cache_size && config->pack_threshold,
+		"the front cache can't be used with packed values");
+	// the objects which didn't move yet are found by the intervals of the
+	// hashring, and only one thread moves them
+	DIE(config->migration_step && (config->routing != ROUTING_RING ||
+		config->thread_safe || config->bounded_loads || replicated ||
+		config->front_cache_size), "incremental migration needs a hashring "
+		"which is not thread safe, without bounded loads, replication or "
+		"front cache");
+	main_server->no_objects = 0;
+	main_server->overflowed = NULL;
+	main_server->no_overflowed = 0;
+	main_server->probe_marks = NULL;
+	main_server->probe_stamp = 0;
+	main_server->snapshot = NULL;
+	main_server->snapshot_size = 0;
+	main_server->log = config->wal.path ? create_wal(&main_server->config.wal)
+										: NULL;
+	main_server->replica_loads = NULL;
+	main_server->window_reads = 0;
+	main_server->next_replica = 0;
+	main_server->cache = config->front_cache_size ?
+						 create_front_cache(config->front_cache_size) : NULL;
+	main_server->old_routes = NULL;
+	main_server->migration_ranges = NULL;
+	main_server->no_migration_ranges = 0;
+	main_server->next_migration_range = 0;
+	memset(&main_server->migration, 0, sizeof(migration_stats));
+	if (config->bounded_loads) {
+		main_server->overflowed = calloc(MAX_HASH, sizeof(unsigned char));
+		DIE(main_server->overflowed == NULL, "Error");
+	}
+	if (config->bounded_loads || replicated) {
+		main_server->probe_marks = calloc(MAX_HASH, sizeof(unsigned int));
+		DIE(main_server->probe_marks == NULL, "Error");
+	}
+	if (replicated && config->replica_reads == REPLICA_READ_LEAST_LOADED) {
+		main_server->replica_loads = calloc(MAX_HASH, sizeof(unsigned int));
+		DIE(main_server->replica_loads == NULL, "Error");
+	}
 
     return main_server;
 }
 
-// auxiliary function which returns the position on which should
-// a given server label be located in the hashring (the cdll hashring is
-// sorted in ascending order by hash value)
-unsigned int hashring_position(cdll_list* hashring, unsigned int server_label)
+// function which finds the server owning a key hash and returns it
+// locked; it must be called in a read section of the router
+server_memory* lock_key_server(load_balancer* main_server, unsigned int hash,
+							   int* server_id)
 {
-	// iterate through the cdll and compare the given server label's hash
-	// with the current node's hash
-	cdll_node* current = hashring->head;
+	for (;;) {
+		router* routes = main_server->routes;
+		unsigned int id = router_route(routes, hash);
+		server_memory* server = main_server->servers_ht[id];
+		pthread_mutex_lock(&server->lock);
 
-	for (int i = 0; i < (int)hashring->size; i++) {
-		// when finding a node with the hash greater than the
-		// server label's hash, return the position
-		// (the server label should be located before this node)
-		if (hash_function_servers(&server_label) <=
-			hash_function_servers(current->data)) {
-			return i;
+		// a server added or removed while waiting for the lock may have
+		// taken over the key; the servers whose objects move are locked
+		// while the router is published, so once the lock is taken the
+		// current router gives the server which really has the key
+		router* current = main_server->routes;
+		if (current == routes || router_route(current, hash) == id) {
+			*server_id = id;
+			return server;
 		}
-		current = current->next;
+		pthread_mutex_unlock(&server->lock);
 	}
+}
+
+// function which returns the number of objects a server can store with
+// bounded loads: (1 + epsilon) times its share of the given number of
+// objects, rounded up
+unsigned int bounded_capacity(load_balancer* main_server,
+							  unsigned int server_id, unsigned int no_objects)
+{
+	hashring* ring = main_server->routes->ring;
+	double share = (double)no_objects * main_server->server_vnodes[server_id] /
+				   ring->size;
 
-	// if there isn't any node with a hash greater than
-	// the server label's hash, return the size of the cdll
-	// (the server label should be located at the end of the list)
-	return hashring->size;
+	return (unsigned int)ceil((1 + main_server->config.load_epsilon) * share);
 }
 
-// auxiliary function hich returns the position of the server
-// on which should an object with a given key value be stored in
-// the hashring cdll (the list is sorted in ascending order
-// by hash value)
-unsigned int key_hashring_position(cdll_list* hashring, char* key_value)
+// function which returns a new stamp for the marks of the servers, which
+// makes all the servers unmarked
+unsigned int new_probe_stamp(load_balancer* main_server)
 {
-	// iterate through the cdll and compare the given key value's hash
-	// with the current node's hash
-	cdll_node* current = hashring->head;
+	if (++main_server->probe_stamp == 0) {
+		memset(main_server->probe_marks, 0, MAX_HASH * sizeof(unsigned int));
+		main_server->probe_stamp = 1;
+	}
+
+	return main_server->probe_stamp;
+}
 
-	for (int i = 0; i < (int)hashring->size; i++) {
-		// when finding a node with the hash greater than the
-		// key value's hash, return the position
-		// (the object with the given key should be stored on this server)
-		if (hash_function_key(key_value) <=
-			hash_function_servers(current->data)) {
-			return i;
+// function which starts the probe sequence of a key hash
+void probe_start(load_balancer* main_server, load_probe* probe,
+				 unsigned int hash)
+{
+	hashring* ring = main_server->routes->ring;
+	probe->position = hashring_key_position(ring, hash);
+	probe->remaining = ring->size;
+
+	// a new stamp makes all the servers unvisited
+	new_probe_stamp(main_server);
+}
+
+// function which returns the next server of a probe sequence, skipping
+// the labels of the servers which were already visited, or -1 at the end
+int probe_next(load_balancer* main_server, load_probe* probe)
+{
+	hashring* ring = main_server->routes->ring;
+
+	while (probe->remaining > 0) {
+		unsigned int server_id = ring->labels[probe->position].server_id;
+		probe->position = (probe->position + 1) % ring->size;
+		probe->remaining--;
+
+		if (main_server->probe_marks[server_id] != main_server->probe_stamp) {
+			main_server->probe_marks[server_id] = main_server->probe_stamp;
+			return server_id;
+		}
+	}
+
+	return -1;
+}
+
+// function which marks a server as overflowed
+void mark_overflowed(load_balancer* main_server, unsigned int server_id)
+{
+	if (!main_server->overflowed[server_id]) {
+		main_server->overflowed[server_id] = 1;
+		main_server->no_overflowed++;
+	}
+}
+
+// function which looks for a key on its probe sequence and returns the
+// server which has it, or NULL; an object is stored after its home server
+// only when all the servers before it were full and were marked as
+// overflowed, so the search stops at the first server which never
+// overflowed
+server_memory* bounded_find(load_balancer* main_server, key_descriptor* key,
+							int* server_id)
+{
+	load_probe probe;
+	probe_start(main_server, &probe, key->hash);
+
+	int id = probe_next(main_server, &probe);
+	*server_id = id;
+	for (; id >= 0; id = probe_next(main_server, &probe)) {
+		server_memory* server = main_server->servers_ht[id];
+		if (server_retrieve_key(server, key) != NULL) {
+			*server_id = id;
+			return server;
 		}
-		current = current->next;
+		if (!main_server->overflowed[id])
+			break;
 	}
 
-	// if there isn't any node with a hash greater than
-	// the key value's hash, the object with the given key should be
-	// stored on the first server of the hashring
+	return NULL;
+}
+
+// function which returns the first server of the probe sequence of a hash
+// (other than the donor) which can store one more object; the full
+// servers before it are marked as overflowed
+unsigned int bounded_place(load_balancer* main_server, unsigned int hash,
+						   int donor_id)
+{
+	load_probe probe;
+	probe_start(main_server, &probe, hash);
+
+	for (int id = probe_next(main_server, &probe); id >= 0;
+		 id = probe_next(main_server, &probe)) {
+		if (id != donor_id && main_server->servers_ht[id]->size <
+			bounded_capacity(main_server, id, main_server->no_objects))
+			return id;
+		mark_overflowed(main_server, id);
+	}
+
+	// the capacities add up to more than the number of objects
+	DIE(1, "no server can store the object");
 	return 0;
 }
 
+// function which returns the server on which an object of a full
+// or removed server is moved, with bounded loads
+server_memory* route_over_bound(unsigned int hash, void* arg)
+{
+	bound_args* args = arg;
+	load_balancer* main_server = args->main_server;
+
+	return main_server->servers_ht[bounded_place(main_server, hash,
+												 args->donor_id)];
+}
+
+// function which moves the objects above the bound of each server on the
+// next servers of their probe sequences; the bound of the servers drops
+// when a server is added
+void bound_server_loads(load_balancer* main_server)
+{
+	hashring* ring = main_server->routes->ring;
+
+	for (unsigned int i = 0; i < ring->size; i++) {
+		if (ring->labels[i].replica != 0)
+			continue;
+
+		unsigned int server_id = ring->labels[i].server_id;
+		server_memory* server = main_server->servers_ht[server_id];
+		unsigned int capacity = bounded_capacity(main_server, server_id,
+												 main_server->no_objects);
+		if (server->size <= capacity)
+			continue;
+
+		bound_args args = {main_server, server_id};
+		server_move_some(server, server->size - capacity, route_over_bound,
+						 &args);
+	}
+}
+
+// function which stores an object with bounded loads: a stored key keeps
+// its server, a new key goes on the first server of its probe sequence
+// which is below the bound
+void bounded_store(load_balancer* main_server, key_descriptor* key,
+				   char* value, unsigned long long deadline, int* server_id)
+{
+	server_memory* server = bounded_find(main_server, key, server_id);
+	if (server == NULL) {
+		main_server->no_objects++;
+		*server_id = bounded_place(main_server, key->hash, -1);
+		server = main_server->servers_ht[*server_id];
+	}
+
+	server_store_key_deadline(server, key, value, deadline);
+}
+
+// function which fills an array with the servers which store the replicas
+// of a key hash: the servers of the labels which follow the hash on the
+// hashring, skipping the labels of the servers which were already chosen;
+// it returns their number, which is smaller than the replication factor
+// when there are fewer servers
+unsigned int replica_servers(load_balancer* main_server, unsigned int hash,
+							 unsigned int* ids)
+{
+	load_probe probe;
+	probe_start(main_server, &probe, hash);
+
+	unsigned int count = 0;
+	int id;
+	while (count < main_server->config.replication_factor &&
+		   (id = probe_next(main_server, &probe)) >= 0)
+		ids[count++] = id;
+	DIE(count == 0, "no server can store the object");
+
+	return count;
+}
+
+// function which stores an object on all its replicas
+void replicated_store(load_balancer* main_server, key_descriptor* key,
+					  char* value, unsigned long long deadline,
+					  int* server_id)
+{
+	unsigned int ids[MAX_REPLICATION_FACTOR];
+	unsigned int count = replica_servers(main_server, key->hash, ids);
+
+	for (unsigned int i = 0; i < count; i++)
+		server_store_key_deadline(main_server->servers_ht[ids[i]], key,
+								  value, deadline);
+	*server_id = ids[0];
+}
+
+// function which returns the replica which answers a read of a key hash,
+// according to the read policy
+server_memory* replica_read_server(load_balancer* main_server,
+								   unsigned int hash, int* server_id)
+{
+	unsigned int ids[MAX_REPLICATION_FACTOR];
+	unsigned int count = replica_servers(main_server, hash, ids);
+	unsigned int chosen = 0;
+
+	if (main_server->config.replica_reads == REPLICA_READ_LEAST_LOADED) {
+		unsigned int* loads = main_server->replica_loads;
+		for (unsigned int i = 1; i < count; i++) {
+			if (loads[ids[i]] < loads[ids[chosen]])
+				chosen = i;
+		}
+		loads[ids[chosen]]++;
+
+		// the loads are halved every window, so a server which was busy
+		// long ago (or an added server, which starts without reads)
+		// doesn't keep the reads away from the others; a server has many
+		// labels, so a new stamp makes sure it is halved only once
+		if (++main_server->window_reads == REPLICA_READ_WINDOW) {
+			hashring* ring = main_server->routes->ring;
+			unsigned int stamp = new_probe_stamp(main_server);
+			for (unsigned int i = 0; i < ring->size; i++) {
+				unsigned int id = ring->labels[i].server_id;
+				if (main_server->probe_marks[id] != stamp) {
+					main_server->probe_marks[id] = stamp;
+					loads[id] /= 2;
+				}
+			}
+			main_server->window_reads = 0;
+		}
+	} else {
+		chosen = main_server->next_replica++ % count;
+	}
+
+	*server_id = ids[chosen];
+	return main_server->servers_ht[ids[chosen]];
+}
+
+// function which appends a store to the write-ahead log (if there is
+// one) and returns the number of its record
+unsigned long long log_store(load_balancer* main_server, key_descriptor* key,
+							 char* value)
+{
+	if (main_server->log == NULL)
+		return 0;
+
+	command request;
+	request.type = COMMAND_STORE;
+	request.key = *key;
+	request.value = value;
+	request.value_length = strlen(value);
+
+	return wal_append(main_server->log, &request);
+}
+
+// function which appends an added or removed server to the write-ahead
+// log (if there is one) and returns the number of its record
+unsigned long long log_server(load_balancer* main_server, int type,
+							  int server_id, int weight)
+{
+	if (main_server->log == NULL)
+		return 0;
+
+	command request;
+	request.type = type;
+	request.server_id = server_id;
+	request.weight = weight;
+
+	return wal_append(main_server->log, &request);
+}
+
+// function which waits until a record of the write-ahead log can be
+// acknowledged, according to the sync policy of the log
+void log_commit(load_balancer* main_server, unsigned long long record)
+{
+	if (main_server->log != NULL)
+		wal_commit(main_server->log, record);
+}
+
+// function which returns the server on which an object is routed
+// by the current router
+server_memory* route_key_server(unsigned int hash, void* arg)
+{
+	load_balancer* main_server = arg;
+
+	return main_server->servers_ht[router_route(main_server->routes, hash)];
+}
+
+// function which returns the current time in nanoseconds, used for
+// measuring the pauses of the migration steps
+double migration_now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+// function which returns 1 if the server was removed but keeps objects
+// which the migration in progress didn't move yet
+int server_draining(load_balancer* main_server, int server_id)
+{
+	return main_server->old_routes != NULL &&
+		   main_server->migration.server_id == server_id &&
+		   main_server->server_vnodes[server_id] == 0;
+}
+
+// function which adds an interval whose objects are moved by the
+// migration in progress
+void add_migration_range(load_balancer* main_server, unsigned int donor_id,
+						 unsigned int first_hash, unsigned int last_hash)
+{
+	unsigned int size = main_server->no_migration_ranges;
+	main_server->migration_ranges = realloc(main_server->migration_ranges,
+											(size + 1) *
+											sizeof(migration_range));
+	DIE(main_server->migration_ranges == NULL, "Error");
+
+	migration_range* range = &main_server->migration_ranges[size];
+	range->donor_id = donor_id;
+	range->first_hash = first_hash;
+	range->last_hash = last_hash;
+	main_server->no_migration_ranges++;
+
+	main_server->migration.total_keys +=
+		server_count_range(main_server->servers_ht[donor_id], first_hash,
+						   last_hash);
+}
+
+// function which adds the interval (predecessor hash, label hash] of a
+// label, which may wrap around the end of the hashring, to the migration
+void add_migration_interval(load_balancer* main_server, int donor_id,
+							unsigned int predecessor_hash,
+							unsigned int label_hash)
+{
+	if (predecessor_hash == label_hash)
+		return;
+
+	if (predecessor_hash < label_hash) {
+		add_migration_range(main_server, donor_id, predecessor_hash + 1,
+							label_hash);
+		return;
+	}
+
+	if (predecessor_hash != UINT_MAX)
+		add_migration_range(main_server, donor_id, predecessor_hash + 1,
+							UINT_MAX);
+	add_migration_range(main_server, donor_id, 0, label_hash);
+}
+
+// function which starts a migration after the given server was added
+// or removed; the router before the change is given, since the objects
+// which didn't move yet are still on the servers it routes them to
+void start_migration(load_balancer* main_server, int server_id,
+					 router* old_routes)
+{
+	main_server->old_routes = old_routes;
+	main_server->next_migration_range = 0;
+	main_server->migration.active = 1;
+	main_server->migration.server_id = server_id;
+	main_server->migration.total_keys = 0;
+	main_server->migration.moved_keys = 0;
+}
+
+// function which ends the migration in progress: a removed server, which
+// is empty now, is freed and the chunks of its arena (which hold the
+// objects moved from it) are given to a remaining server
+void end_migration(load_balancer* main_server)
+{
+	int server_id = main_server->migration.server_id;
+	server_memory* server = main_server->servers_ht[server_id];
+
+	if (server_draining(main_server, server_id)) {
+		server_memory* heir = route_key_server(0, main_server);
+		arena_adopt(heir->pool, server->pool);
+		main_server->servers_ht[server_id] = NULL;
+		free_server_memory(server);
+	}
+
+	free_router(main_server->old_routes);
+	main_server->old_routes = NULL;
+	free(main_server->migration_ranges);
+	main_server->migration_ranges = NULL;
+	main_server->no_migration_ranges = 0;
+	main_server->next_migration_range = 0;
+	main_server->migration.active = 0;
+}
+
+// function which makes a step of the migration in progress: the objects
+// of at most migration_step keys are moved on their new servers
+int loader_migrate(load_balancer* main_server)
+{
+	if (main_server->old_routes == NULL)
+		return 0;
+
+	double start = migration_now();
+	unsigned int budget = main_server->config.migration_step;
+	while (budget > 0 && main_server->next_migration_range <
+		   main_server->no_migration_ranges) {
+		migration_range* range = &main_server->migration_ranges
+								  [main_server->next_migration_range];
+		unsigned int moved = server_move_range_step(main_server->servers_ht
+													[range->donor_id],
+													range->first_hash,
+													range->last_hash, budget,
+													route_key_server,
+													main_server,
+													&main_server->migration.
+													moved_keys);
+
+		// the interval was emptied if it had fewer keys than the budget
+		if (moved < budget)
+			main_server->next_migration_range++;
+		budget -= moved;
+	}
+
+	if (main_server->next_migration_range ==
+		main_server->no_migration_ranges)
+		end_migration(main_server);
+
+	double pause = migration_now() - start;
+	main_server->migration.steps++;
+	main_server->migration.total_pause_ns += pause;
+	if (pause > main_server->migration.max_pause_ns)
+		main_server->migration.max_pause_ns = pause;
+
+	return main_server->old_routes != NULL;
+}
+
+// function which finishes the migration in progress (if there is one)
+void finish_migration(load_balancer* main_server)
+{
+	while (loader_migrate(main_server))
+		continue;
+}
+
+// function which returns the progress of the migrations
+void loader_migration_stats(load_balancer* main_server,
+							migration_stats* stats)
+{
+	*stats = main_server->migration;
+}
+
+// function which returns the server which owned a key before the
+// migration in progress, if it isn't the key's current server; the key
+// may still be there if its objects weren't moved yet
+server_memory* former_server(load_balancer* main_server, unsigned int hash,
+							 int server_id, int* former_id)
+{
+	if (main_server->old_routes == NULL)
+		return NULL;
+
+	*former_id = router_route(main_server->old_routes, hash);
+	if (*former_id == server_id)
+		return NULL;
+
+	return main_server->servers_ht[*former_id];
+}
+
+// function which stores an object which expires at the given deadline
+// (0 if it never expires) on the specific server it belongs to
+void store_key_deadline(load_balancer* main_server, key_descriptor* key,
+						char* value, unsigned long long deadline,
+						int* server_id)
+{
+	unsigned long long record;
+
+	if (main_server->config.thread_safe) {
+		unsigned int token = rcu_read_lock(&main_server->readers);
+		server_memory* server = lock_key_server(main_server, key->hash,
+												server_id);
+		// the records of a key are appended in the order of its stores
+		record = log_store(main_server, key, value);
+		server_store_key_deadline(server, key, value, deadline);
+		pthread_mutex_unlock(&server->lock);
+		rcu_read_unlock(&main_server->readers, token);
+		log_commit(main_server, record);
+		return;
+	}
+
+	// the store is logged before it is applied
+	record = log_store(main_server, key, value);
+	loader_migrate(main_server);
+
+	// the cached value of the key is replaced
+	if (main_server->cache != NULL)
+		front_cache_invalidate(main_server->cache, key);
+
+	// get the server on which the key should be stored (the label which
+	// owns the key on the hashring, for the default strategy)
+	if (main_server->config.bounded_loads) {
+		bounded_store(main_server, key, value, deadline, server_id);
+	} else if (main_server->config.replication_factor > 1) {
+		replicated_store(main_server, key, value, deadline, server_id);
+	} else {
+		*server_id = router_route(main_server->routes, key->hash);
+
+		// store the object on the server's hashtable
+		server_store_key_deadline(main_server->servers_ht[*server_id], key,
+								  value, deadline);
+
+		// an old value which wasn't moved yet must not be moved later
+		int former_id;
+		server_memory* former = former_server(main_server, key->hash,
+											  *server_id, &former_id);
+		if (former != NULL)
+			server_remove_key(former, key);
+	}
+
+	log_commit(main_server, record);
+}
+
+// function which stores an object given by its hashed key and value
+// on the specific server it belongs to
+void loader_store_key(load_balancer* main_server, key_descriptor* key,
+					  char* value, int* server_id)
+{
+	store_key_deadline(main_server, key, value, 0, server_id);
+}
+
+// function which stores an object given by its hashed key and value,
+// which expires after the given number of milliseconds
+void loader_store_key_expiring(load_balancer* main_server,
+							   key_descriptor* key, char* value,
+							   unsigned int ttl_ms, int* server_id)
+{
+	DIE(ttl_ms == 0, "the time to live must be positive");
+	// neither the cached values nor the records of the log have deadlines
+	DIE(main_server->cache != NULL,
+		"the front cache can't hold objects which expire");
+	DIE(main_server->log != NULL,
+		"the write-ahead log can't hold objects which expire");
+
+	unsigned long long deadline = main_server->config.clock() + ttl_ms;
+	store_key_deadline(main_server, key, value, deadline, server_id);
+}
+
+// function which stores an object given by its key and value, which
+// expires after the given number of milliseconds
+void loader_store_expiring(load_balancer* main_server, char* key,
+						   char* value, unsigned int ttl_ms, int* server_id)
+{
+	key_descriptor descriptor;
+	key_descriptor_init(&descriptor, key);
+
+	loader_store_key_expiring(main_server, &descriptor, value, ttl_ms,
+							  server_id);
+}
+
 // function which stores an object given by its key and value
 // on the specific server it belongs to
 void loader_store(load_balancer* main_server, char* key,
 				  char* value, int* server_id)
 {
-	// get the position of the server label on which the key should be stored
-	unsigned int position = key_hashring_position(main_server->hashring, key);
+	// the key is hashed once, for routing it and for storing it
+	key_descriptor descriptor;
+	key_descriptor_init(&descriptor, key);
+
+	loader_store_key(main_server, &descriptor, value, server_id);
+}
+
+// function which retrieves the value of a hashed key from the server
+// which stores it, when the load balancer is not thread safe
+char* route_retrieve(load_balancer* main_server, key_descriptor* key,
+					 int* server_id)
+{
+	// get the server on which the key should be found
+	if (main_server->config.bounded_loads) {
+		server_memory* server = bounded_find(main_server, key, server_id);
+		return server ? server_retrieve_key(server, key) : NULL;
+	}
+	if (main_server->config.replication_factor > 1) {
+		server_memory* server = replica_read_server(main_server, key->hash,
+													server_id);
+		return server_retrieve_key(server, key);
+	}
+	*server_id = router_route(main_server->routes, key->hash);
+
+	// retrieve the value stored on the hashtable at the given key
+	char* value = server_retrieve_key(main_server->servers_ht[*server_id],
+									  key);
+	if (value != NULL)
+		return value;
+
+	// during a migration, the key may not have moved yet
+	int former_id;
+	server_memory* former = former_server(main_server, key->hash,
+										  *server_id, &former_id);
+	if (former == NULL)
+		return NULL;
+	value = server_retrieve_key(former, key);
+	if (value != NULL) {
+		*server_id = former_id;
+		main_server->migration.fallbacks++;
+	}
+
+	return value;
+}
+
+// function which retrieves the value stored at a given hashed key
+char* loader_retrieve_key(load_balancer* main_server, key_descriptor* key,
+						  int* server_id)
+{
+	if (main_server->config.thread_safe) {
+		unsigned int token = rcu_read_lock(&main_server->readers);
+		server_memory* server = lock_key_server(main_server, key->hash,
+												server_id);
+		char* value = server_retrieve_key(server, key);
+		pthread_mutex_unlock(&server->lock);
+		rcu_read_unlock(&main_server->readers, token);
+		return value;
+	}
 
-	// get the server label from the found position
-	cdll_node* server_label = get_node(main_server->hashring, position);
+	loader_migrate(main_server);
+	if (main_server->cache == NULL)
+		return route_retrieve(main_server, key, server_id);
 
-	// calculate the server id and store the object on the server's hashtable
-	*server_id = *(unsigned int*)server_label->data % MAX_HASH;
-	server_store(main_server->servers_ht[*server_id], key, value);
+	// a missed key is offered to the cache once it is found on its server
+	char* value = front_cache_lookup(main_server->cache, key, server_id);
+	if (value == NULL) {
+		value = route_retrieve(main_server, key, server_id);
+		if (value != NULL)
+			front_cache_admit(main_server->cache, key, *server_id, value);
+	}
+
+	return value;
 }
 
 // function which retrieves the value stored at a given key
 char* loader_retrieve(load_balancer* main_server, char* key, int* server_id) {
-	// get the position of the server label on which the key shoukd be found
-	unsigned int position = key_hashring_position(main_server->hashring, key);
+	key_descriptor descriptor;
+	key_descriptor_init(&descriptor, key);
+
+	return loader_retrieve_key(main_server, &descriptor, server_id);
+}
+
+// function which copies the value stored at a given key in a buffer
+int loader_retrieve_copy(load_balancer* main_server, char* key, char* value,
+						 size_t size, int* server_id)
+{
+	key_descriptor descriptor;
+	key_descriptor_init(&descriptor, key);
+	unsigned int token = 0;
+	server_memory* server = NULL;
+
+	if (main_server->config.thread_safe) {
+		token = rcu_read_lock(&main_server->readers);
+		server = lock_key_server(main_server, descriptor.hash, server_id);
+	} else if (main_server->config.bounded_loads) {
+		server = bounded_find(main_server, &descriptor, server_id);
+	} else if (main_server->config.replication_factor > 1) {
+		server = replica_read_server(main_server, descriptor.hash, server_id);
+	} else {
+		loader_migrate(main_server);
+		*server_id = router_route(main_server->routes, descriptor.hash);
+		server = main_server->servers_ht[*server_id];
+	}
+
+	// the value is copied (and unpacked) before the server is unlocked
+	int found = server ? server_retrieve_copy(server, &descriptor, value,
+											  size) : 0;
 
-	// get the server label on the found position
-	cdll_node* server = get_node(main_server->hashring, position);
+	// during a migration, the key may not have moved yet
+	int former_id;
+	server_memory* former = found ? NULL :
+							former_server(main_server, descriptor.hash,
+										  *server_id, &former_id);
+	if (former != NULL &&
+		server_retrieve_copy(former, &descriptor, value, size)) {
+		found = 1;
+		*server_id = former_id;
+		main_server->migration.fallbacks++;
+	}
 
-	// calculate the server id and retrieve the value stored on the hashtable
-	// at the given key
-	*server_id = *(unsigned int*) server->data % MAX_HASH;
-	return server_retrieve(main_server->servers_ht[*server_id], key);
+	if (main_server->config.thread_safe) {
+		pthread_mutex_unlock(&server->lock);
+		rcu_read_unlock(&main_server->readers, token);
+	}
+
+	return found;
 }
 
-// function used for the redistribution of objects
-// when adding a server and its labels
-void add_redistribute_objects(load_balancer* main_server, int server_id_label)
+// comparison function which orders the objects of a batch by server,
+// then by hash; the objects with the same key keep their batch order
+int compare_batch_entries(const void* a, const void* b) {
+	const batch_entry* entry_a = a;
+	const batch_entry* entry_b = b;
+
+	if (entry_a->server_id != entry_b->server_id)
+		return entry_a->server_id < entry_b->server_id ? -1 : 1;
+	if (entry_a->hash != entry_b->hash)
+		return entry_a->hash < entry_b->hash ? -1 : 1;
+	return (entry_a->index > entry_b->index) -
+		   (entry_a->index < entry_b->index);
+}
+
+// function which hashes and routes all the keys of a batch, then sorts
+// them so the objects of each server are handled together
+batch_entry* route_batch(load_balancer* main_server, char** keys,
+						 int* server_ids, unsigned int count)
 {
-	// get the positon on which the server label should be stored
-	// on the hashring and add it to the cdll
-	unsigned int server_label_position = hashring_position(main_server->
-								  hashring, server_id_label);
-	add_node(main_server->hashring, server_label_position, &server_id_label);
+	if (count > main_server->batch_capacity) {
+		free(main_server->batch);
+		main_server->batch = malloc(count * sizeof(batch_entry));
+		DIE(main_server->batch == NULL, "Error");
+		main_server->batch_capacity = count;
+	}
+
+	batch_entry* batch = main_server->batch;
+	router* routes = main_server->routes;
+	for (unsigned int i = 0; i < count; i++) {
+		key_descriptor descriptor;
+		key_descriptor_init(&descriptor, keys[i]);
+		batch[i].hash = descriptor.hash;
+		batch[i].length = descriptor.length;
+		batch[i].server_id = router_route(routes, batch[i].hash);
+		batch[i].index = i;
+		server_ids[i] = batch[i].server_id;
+	}
+
+	// sorting by hash too makes the accesses of each server go in the
+	// order of its buckets (or slots)
+	qsort(batch, count, sizeof(batch_entry), compare_batch_entries);
 
-	int server_id = server_id_label % MAX_HASH;
+	return batch;
+}
 
-	// if the hashring only has one element, the objects
-	// have nowhere to be redistributed
-	if (main_server->hashring->size <= 1) {
+// function which stores a batch of objects on the servers they belong to
+void loader_store_batch(load_balancer* main_server, char** keys,
+						char** values, int* server_ids, unsigned int count)
+{
+	finish_migration(main_server);
+
+	// the routing array is shared, so the threads store one by one; with
+	// bounded loads, the server of a key depends on the keys before it,
+	// and a replicated object is stored on several servers
+	if (main_server->config.thread_safe ||
+		main_server->config.bounded_loads ||
+		main_server->config.replication_factor > 1) {
+		for (unsigned int i = 0; i < count; i++)
+			loader_store(main_server, keys[i], values[i], &server_ids[i]);
 		return;
 	}
 
-	// calculate the position, id and label
-	// of the server label's right neighbour
-	int right_label_position = server_label_position + 1;
+	batch_entry* batch = route_batch(main_server, keys, server_ids, count);
 
-	// verify if the server label is the last in the hashring
-	// because the hashring is circular, it's neighbour is the first
-	// element of the hashring
-	if (right_label_position == (int)main_server->hashring->size) {
-		right_label_position = 0;
+	// the stores of a key are logged in their order, and a single
+	// commit acknowledges all the stores of the batch
+	unsigned long long record = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		unsigned int index = batch[i].index;
+		key_descriptor key = {keys[index], batch[i].length, batch[i].hash};
+		record = log_store(main_server, &key, values[index]);
+		if (main_server->cache != NULL)
+			front_cache_invalidate(main_server->cache, &key);
+		server_store_key(main_server->servers_ht[batch[i].server_id], &key,
+						 values[index]);
 	}
 
-	cdll_node* right_id = get_node(main_server->hashring,
-						  right_label_position);
-	int right_id_label = *(unsigned int*)right_id->data;
-	int right_server_id = right_id_label % MAX_HASH;
+	log_commit(main_server, record);
+}
 
-	if (server_id == right_server_id) {
+// function which retrieves the values stored at a batch of keys
+void loader_retrieve_batch(load_balancer* main_server, char** keys,
+						   char** values, int* server_ids, unsigned int count)
+{
+	// the unpacked values of a server share its codec buffer
+	DIE(main_server->config.pack_threshold,
+		"a batch can't be retrieved when the values are packed");
+	finish_migration(main_server);
+
+	if (main_server->config.thread_safe ||
+		main_server->config.bounded_loads ||
+		main_server->config.replication_factor > 1) {
+		for (unsigned int i = 0; i < count; i++)
+			values[i] = loader_retrieve(main_server, keys[i], &server_ids[i]);
 		return;
 	}
 
-	// iterate through the right neighbour label's array of buckets
-	for (int i = 0; i < (int)main_server->servers_ht[server_id]->hmax; i++) {
-		// iterate through each cdll bucket
-		cdll_node* current = main_server->servers_ht[right_server_id]
-							->buckets[i]->head;
-		int size = main_server->servers_ht[right_server_id]->buckets[i]->size;
-
-		for (int j = 0; j < size; j++) {
-			// get each key's position in the hashring
-			unsigned int position_key = key_hashring_position(main_server->
-						hashring, ((key_value_pair *)(current->data))->key);
-
-			// if the position of the key is the same as the label's position,
-			// store the key on the newly added server's hashtable
-			if (position_key == server_label_position) {
-				server_store(main_server->servers_ht[server_id],
-							((key_value_pair *)(current->data))->key,
-							((key_value_pair *)(current->data))->value);
-			}
-			current = current->next;
-		}
+	batch_entry* batch = route_batch(main_server, keys, server_ids, count);
+
+	for (unsigned int i = 0; i < count; i++) {
+		unsigned int index = batch[i].index;
+		key_descriptor key = {keys[index], batch[i].length, batch[i].hash};
+		values[index] =
+			server_retrieve_key(main_server->servers_ht[batch[i].server_id],
+								&key);
 	}
 }
 
+// function used for the redistribution of objects when adding a server
+// label; the label takes over the hash interval (predecessor hash, label
+// hash], which was owned by the donor server, so only the donor's objects
+// from this interval are moved on the new server
+void add_redistribute_objects(load_balancer* main_server, int server_id,
+							  int donor_id, unsigned int predecessor_hash,
+							  unsigned int label_hash)
+{
+	server_memory* server = main_server->servers_ht[server_id];
+	server_memory* donor = main_server->servers_ht[donor_id];
+
+	if (predecessor_hash == label_hash)
+		return;
+
+	if (predecessor_hash < label_hash) {
+		server_move_range(donor, server, predecessor_hash + 1, label_hash);
+		return;
+	}
+
+	// the interval of the first label wraps around the end of the hashring
+	if (predecessor_hash != UINT_MAX)
+		server_move_range(donor, server, predecessor_hash + 1, UINT_MAX);
+	server_move_range(donor, server, 0, label_hash);
+}
+
 // function used for adding a server on the load balancer
 void loader_add_server(load_balancer* main_server, int server_id)
 {
-	// calculate the server's labels values
-	int server_label_1 = 1 * MAX_HASH + server_id;
-    int server_label_2 = 2 * MAX_HASH + server_id;
+	loader_add_server_weighted(main_server, server_id, DEFAULT_VNODES);
+}
 
-	// create the hashtable of the server
-    main_server->servers_ht[server_id] = init_server_memory();
+// function which returns the position of the label which owned the
+// interval of the label from the given position before the label's server
+// was added: the first label after it which belongs to a different server
+// (because the hashring is circular, the neighbour of the last label is
+// the first label of the hashring)
+unsigned int label_donor_position(hashring* ring, unsigned int position)
+{
+	unsigned int server_id = ring->labels[position].server_id;
+	unsigned int donor_position = (position + 1) % ring->size;
+
+	while (ring->labels[donor_position].server_id == server_id &&
+		   donor_position != position)
+		donor_position = (donor_position + 1) % ring->size;
 
-	// call the function for object redistribution for the server
-	// and its labels
-	add_redistribute_objects(main_server, server_id);
-	add_redistribute_objects(main_server, server_label_1);
-	add_redistribute_objects(main_server, server_label_2);
+	return donor_position;
 }
 
-// function used for removing a server label from the hashring cdll
-void remove_from_hashring(load_balancer* main_server, int server_id_label)
+// function which returns the ids of a server and of the servers which
+// own the intervals next to its labels, sorted in ascending order and
+// without duplicates; these are the servers whose objects move when
+// the server is added or removed (for the strategies other than the
+// hashring, the objects can move between any servers, so all the
+// servers of the router are returned)
+unsigned int* neighbour_servers(router* routes, unsigned int server_id,
+								unsigned int* count)
 {
-	unsigned int position = hashring_position(main_server->hashring,
-							server_id_label);
-	cdll_node* removed = remove_node(main_server->hashring, position);
-	free(removed->data);
-	free(removed);
+	hashring* ring = routes->ring;
+	unsigned int no_ids = ring ? ring->size : routes->no_servers;
+	unsigned int* ids = malloc((no_ids + 1) * sizeof(unsigned int));
+	DIE(ids == NULL, "Error");
+
+	ids[0] = server_id;
+	*count = 1;
+	for (unsigned int position = 0; ring && position < ring->size;
+		 position++) {
+		if (ring->labels[position].server_id != server_id)
+			continue;
+
+		unsigned int donor_position = label_donor_position(ring, position);
+		if (ring->labels[donor_position].server_id != server_id)
+			ids[(*count)++] = ring->labels[donor_position].server_id;
+	}
+	for (unsigned int i = 0; !ring && i < routes->no_servers; i++)
+		ids[(*count)++] = routes->server_ids[i];
+
+	// insertion sort, dropping the duplicates
+	unsigned int size = 0;
+	for (unsigned int i = 0; i < *count; i++) {
+		unsigned int id = ids[i], j = size;
+		while (j > 0 && ids[j - 1] > id)
+			j--;
+		if (j > 0 && ids[j - 1] == id)
+			continue;
+		memmove(&ids[j + 1], &ids[j], (size - j) * sizeof(unsigned int));
+		ids[j] = id;
+		size++;
+	}
+	*count = size;
+
+	return ids;
+}
+
+// function which locks (or unlocks) the given servers; the servers are
+// locked in ascending order of their ids
+void lock_servers(load_balancer* main_server, unsigned int* ids,
+				  unsigned int count, int lock)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		server_memory* server = main_server->servers_ht[ids[i]];
+		if (lock)
+			pthread_mutex_lock(&server->lock);
+		else
+			pthread_mutex_unlock(&server->lock);
+	}
+}
+
+// function which moves the objects of the given servers which are routed
+// on a different server; it is used by the strategies other than the
+// hashring, for which a change can move objects between any servers
+void reroute_objects(load_balancer* main_server, unsigned int* ids,
+					 unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		server_memory* server = main_server->servers_ht[ids[i]];
+		if (server != NULL)
+			server_move_rerouted(server, route_key_server, main_server);
+	}
+}
+
+// function which returns the server on which an object of a donor is
+// moved when a server is added: the object stays on the donor if the
+// donor is still one of its replicas, otherwise the added server took
+// the donor's place
+server_memory* route_replaced_replica(unsigned int hash, void* arg)
+{
+	replica_args* args = arg;
+	load_balancer* main_server = args->main_server;
+	unsigned int ids[MAX_REPLICATION_FACTOR];
+	unsigned int count = replica_servers(main_server, hash, ids);
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (ids[i] == args->donor_id)
+			return main_server->servers_ht[args->donor_id];
+	}
+
+	return main_server->servers_ht[args->server_id];
+}
+
+// function which copies an object of the donor on the recipient, with
+// its deadline
+void copy_replica(char* key, char* value, void* arg)
+{
+	copy_args* args = arg;
+	key_descriptor descriptor;
+	key_descriptor_init(&descriptor, key);
+
+	server_store_key_deadline(args->recipient, &descriptor, value,
+							  server_key_deadline(args->donor, &descriptor));
+}
+
+// function which gives an added server the replicas it stores, when the
+// objects are replicated
+void replicate_added_server(load_balancer* main_server,
+							unsigned int server_id)
+{
+	hashring* ring = main_server->routes->ring;
+	unsigned int factor = main_server->config.replication_factor;
+	unsigned int no_servers = router_no_servers(main_server->routes);
+	if (no_servers == 1)
+		return;
+
+	// while there are at most factor servers, each of them stores all the
+	// objects, so the new server copies the objects of another server
+	if (no_servers <= factor) {
+		unsigned int position = 0;
+		while (ring->labels[position].server_id == server_id)
+			position++;
+		copy_args args = {main_server->servers_ht[ring->labels[position].
+						  server_id], main_server->servers_ht[server_id]};
+		server_for_each(args.donor, copy_replica, &args);
+		return;
+	}
+
+	// otherwise, the new server takes the place of the last replica of
+	// each object which gets it as a replica; that replica is one of the
+	// first factor servers which follow a label of the new server, so only
+	// these servers (marked with a new stamp) give up objects
+	unsigned int* donors = malloc(no_servers * sizeof(unsigned int));
+	DIE(donors == NULL, "Error");
+	unsigned int no_donors = 0;
+	unsigned int stamp = new_probe_stamp(main_server);
+
+	for (unsigned int position = 0; position < ring->size; position++) {
+		if (ring->labels[position].server_id != server_id)
+			continue;
+
+		unsigned int followers[MAX_REPLICATION_FACTOR];
+		unsigned int count = 0;
+		for (unsigned int next = (position + 1) % ring->size;
+			 count < factor && next != position;
+			 next = (next + 1) % ring->size) {
+			unsigned int id = ring->labels[next].server_id, i = 0;
+			while (i < count && followers[i] != id)
+				i++;
+			if (id == server_id || i < count)
+				continue;
+
+			followers[count++] = id;
+			if (main_server->probe_marks[id] != stamp) {
+				main_server->probe_marks[id] = stamp;
+				donors[no_donors++] = id;
+			}
+		}
+	}
+
+	replica_args args = {main_server, 0, server_id};
+	for (unsigned int i = 0; i < no_donors; i++) {
+		args.donor_id = donors[i];
+		server_move_rerouted(main_server->servers_ht[donors[i]],
+							 route_replaced_replica, &args);
+	}
+	free(donors);
+}
+
+// function which returns the server which becomes the last replica of an
+// object of a removed server; the other replicas of the object already
+// store it
+server_memory* route_new_replica(unsigned int hash, void* arg)
+{
+	load_balancer* main_server = arg;
+	unsigned int ids[MAX_REPLICATION_FACTOR];
+	unsigned int count = replica_servers(main_server, hash, ids);
+
+	return main_server->servers_ht[ids[count - 1]];
+}
+
+// function used for adding a server with a given number of labels
+void loader_add_server_weighted(load_balancer* main_server, int server_id,
+								unsigned int vnodes)
+{
+	DIE(vnodes == 0, "a server needs at least one label");
+	loader_add_server_budget(main_server, server_id, vnodes,
+							 main_server->config.server_budget);
+}
+
+// function used for adding a server with a given number of labels, which
+// can use the given number of bytes (0 if they are unlimited)
+void loader_add_server_budget(load_balancer* main_server, int server_id,
+							  unsigned int vnodes, size_t budget)
+{
+	// the cached values of the evicted keys would be freed under the cache
+	// a server without labels would own no keys, and the walks over the
+	// labels (freeing, removing the server) wouldn't find it
+	DIE(vnodes == 0, "a server needs at least one label");
+	DIE(budget && main_server->cache != NULL,
+		"the front cache can't be used with memory budgets");
+	finish_migration(main_server);
+
+	int thread_safe = main_server->config.thread_safe;
+	if (thread_safe)
+		pthread_mutex_lock(&main_server->writer_lock);
+	unsigned long long record = log_server(main_server, COMMAND_ADD_SERVER,
+										   server_id, vnodes);
+
+	// the cached keys may move on other servers
+	if (main_server->cache != NULL)
+		front_cache_clear(main_server->cache);
+
+	// the other threads keep reading the published router,
+	// so the server is added on a copy
+	router* old_routes = main_server->routes;
+	router* routes = thread_safe ? copy_router(old_routes) : old_routes;
+
+	// with incremental migration, the objects are moved by later steps,
+	// which need the router before the change
+	int incremental = main_server->config.migration_step > 0;
+	if (incremental)
+		start_migration(main_server, server_id, copy_router(old_routes));
+
+	// create the hashtable of the server and add its labels on the hashring
+	main_server->servers_ht[server_id] =
+		init_server_memory_backend(main_server->config.backend);
+	main_server->servers_ht[server_id]->clock = main_server->config.clock;
+	main_server->servers_ht[server_id]->budget = budget;
+	server_set_pack_threshold(main_server->servers_ht[server_id],
+							  main_server->config.pack_threshold);
+	main_server->server_vnodes[server_id] = vnodes;
+	router_add_server(routes, server_id, vnodes);
+
+	// the new server and the donors are locked while the router is
+	// published and the objects are moved, so no thread sees a key on
+	// a server which doesn't have it yet
+	unsigned int count = 0;
+	unsigned int* locked = neighbour_servers(routes, server_id, &count);
+	if (thread_safe)
+		lock_servers(main_server, locked, count, 1);
+	main_server->routes = routes;
+
+	// if the hashring only has the new server's labels, the objects
+	// have nowhere to be redistributed from; the replicated objects are
+	// found by their replicas instead of the labels' intervals
+	int replicated = main_server->config.replication_factor > 1;
+	hashring* ring = routes->ring;
+	for (unsigned int position = 0; ring && !replicated &&
+		 position < ring->size && ring->size != vnodes; position++) {
+		if ((int)ring->labels[position].server_id != server_id)
+			continue;
+
+		// the objects of the label's interval were owned by the donor
+		unsigned int donor_position = label_donor_position(ring, position);
+		unsigned int predecessor = (position + ring->size - 1) % ring->size;
+		if (incremental)
+			add_migration_interval(main_server,
+								   ring->labels[donor_position].server_id,
+								   ring->labels[predecessor].hash,
+								   ring->labels[position].hash);
+		else
+			add_redistribute_objects(main_server, server_id,
+									 ring->labels[donor_position].server_id,
+									 ring->labels[predecessor].hash,
+									 ring->labels[position].hash);
+	}
+	if (incremental && main_server->no_migration_ranges == 0)
+		end_migration(main_server);
+	if (ring == NULL)
+		reroute_objects(main_server, locked, count);
+	if (replicated)
+		replicate_added_server(main_server, server_id);
+
+	// with bounded loads, the objects which went over full servers may be
+	// after the new server in their probe sequence, so the new server is
+	// marked as overflowed; the bound of the other servers drops
+	if (main_server->config.bounded_loads) {
+		if (main_server->no_overflowed > 0)
+			mark_overflowed(main_server, server_id);
+		bound_server_loads(main_server);
+	}
+
+	if (thread_safe) {
+		lock_servers(main_server, locked, count, 0);
+
+		// the old router is freed once no thread reads it
+		rcu_synchronize(&main_server->readers);
+		free_router(old_routes);
+	}
+	free(locked);
+
+	if (thread_safe)
+		pthread_mutex_unlock(&main_server->writer_lock);
+	log_commit(main_server, record);
 }
 
 // function used for removing a server from the load balancer
 void loader_remove_server(load_balancer* main_server, int server_id)
 {
-	// calculate the server's labels values
-	int server_label_1 = 1 * MAX_HASH + server_id;
-    int server_label_2 = 2 * MAX_HASH + server_id;
-
-	// remove the server and its labels from the hashring
-	remove_from_hashring(main_server, server_id);
-	remove_from_hashring(main_server, server_label_1);
-	remove_from_hashring(main_server, server_label_2);
-
-	// get the number of total nodes stored on the server's buckets
-	// and stop the iteration when finding all of them
-	int no_nodes_in_buckets = (int)main_server->servers_ht[server_id]->size;
-
-	// iterate through the server's array of buckets
-    for (int i = 0; i < (int)main_server->servers_ht[server_id]->hmax; i++) {
-		// iterate through each cdll bucket
-		cdll_node *current = main_server->servers_ht[server_id]->
-							 buckets[i]->head;
-
-		for (int j = 0; j < (int)main_server->servers_ht[server_id]
-							->buckets[i]->size; j++) {
-            int new_server = 0;
-			// store the object on a different server
-            loader_store(main_server, ((key_value_pair *)(current->data))->key,
-					((key_value_pair *)(current->data))->value, &new_server);
-
-			// check if all the nodes were found
-			no_nodes_in_buckets--;
-			if (no_nodes_in_buckets == 0) {
-				// free the server's memory
-				free_server_memory(main_server->servers_ht[server_id]);
-				return;
-			}
-			current = current->next;
+	finish_migration(main_server);
+
+	int thread_safe = main_server->config.thread_safe;
+	if (thread_safe)
+		pthread_mutex_lock(&main_server->writer_lock);
+	unsigned long long record = log_server(main_server, COMMAND_REMOVE_SERVER,
+										   server_id, -1);
+	if (main_server->cache != NULL)
+		front_cache_clear(main_server->cache);
+
+	server_memory* server = main_server->servers_ht[server_id];
+	router* old_routes = main_server->routes;
+
+	// the servers which take over the intervals of the removed labels
+	unsigned int count = 0;
+	unsigned int* neighbours = neighbour_servers(old_routes, server_id,
+												 &count);
+
+	// with incremental migration, the removed server keeps its objects
+	// until later steps move them, and it is freed by the last step
+	int incremental = main_server->config.migration_step > 0 &&
+					  router_no_servers(old_routes) > 1;
+	if (incremental)
+		start_migration(main_server, server_id, copy_router(old_routes));
+
+	// remove the server and its labels from (a copy of) the router
+	router* routes = thread_safe ? copy_router(old_routes) : old_routes;
+	router_remove_server(routes, server_id);
+	main_server->server_vnodes[server_id] = 0;
+	if (incremental)
+		add_migration_range(main_server, server_id, 0, UINT_MAX);
+
+	if (thread_safe)
+		lock_servers(main_server, neighbours, count, 1);
+	main_server->routes = routes;
+
+	// move each object on a different server; the moved objects stay in the
+	// chunks of the removed server's arena, so the chunks are given to one
+	// of the remaining servers before the server's memory is freed
+	if (router_no_servers(routes) > 0 && !incremental) {
+		unsigned int factor = main_server->config.replication_factor;
+		if (main_server->config.bounded_loads) {
+			// each object fills the next free server of its probe
+			// sequence, so the objects are placed in the order of their
+			// hashes, which doesn't depend on the layout of the table
+			// (a restored snapshot has a different one)
+			bound_args args = {main_server, -1};
+			server_move_some(server, server->size, route_over_bound, &args);
+		} else if (factor > 1) {
+			// with fewer servers than the factor, the remaining servers
+			// already store all the objects (the copies of the removed
+			// server stay unused in the chunks given to the heir)
+			if (router_no_servers(routes) >= factor)
+				server_move_all(server, route_new_replica, main_server);
+		} else {
+			server_move_all(server, route_key_server, main_server);
 		}
+
+		unsigned int heir = neighbours[0] == (unsigned int)server_id ?
+							neighbours[1] : neighbours[0];
+		arena_adopt(main_server->servers_ht[heir]->pool, server->pool);
+
+		// rendezvous hashing only moves the keys of the removed server,
+		// the other strategies may move keys between the remaining servers
+		if (routes->strategy == ROUTING_MAGLEV ||
+			routes->strategy == ROUTING_JUMP)
+			reroute_objects(main_server, neighbours, count);
 	}
 
-	// free the server's memory
-    free_server_memory(main_server->servers_ht[server_id]);
+	if (thread_safe) {
+		lock_servers(main_server, neighbours, count, 0);
+
+		// the threads which routed a key with the old router may still
+		// use the removed server, until they see that it lost the key
+		rcu_synchronize(&main_server->readers);
+		free_router(old_routes);
+	}
+
+	if (main_server->config.bounded_loads &&
+		main_server->overflowed[server_id]) {
+		main_server->overflowed[server_id] = 0;
+		main_server->no_overflowed--;
+	}
+	if (main_server->replica_loads != NULL)
+		main_server->replica_loads[server_id] = 0;
+
+	if (!incremental) {
+		main_server->servers_ht[server_id] = NULL;
+		free_server_memory(server);
+	}
+	free(neighbours);
+
+	if (thread_safe)
+		pthread_mutex_unlock(&main_server->writer_lock);
+	log_commit(main_server, record);
+}
+
+// function which returns the hashtable of a server
+server_memory* loader_get_server(load_balancer* main_server, int server_id)
+{
+	if (server_id < 0 || server_id >= MAX_HASH)
+		return NULL;
+
+	return main_server->servers_ht[server_id];
+}
+
+// function which returns the front cache of the load balancer
+front_cache* loader_get_front_cache(load_balancer* main_server)
+{
+	return main_server->cache;
+}
+
+// function which returns the write-ahead log of the load balancer
+write_ahead_log* loader_get_wal(load_balancer* main_server)
+{
+	return main_server->log;
+}
+
+// function which calculates how evenly the objects are distributed
+// between the servers of the load balancer
+void loader_distribution_stats(load_balancer* main_server,
+							   distribution_stats* stats)
+{
+	memset(stats, 0, sizeof(distribution_stats));
+	stats->min_keys = (unsigned int)-1;
+
+	// count the objects stored on each server
+	for (int i = 0; i < MAX_HASH; i++) {
+		server_memory* server = main_server->servers_ht[i];
+		if (server == NULL)
+			continue;
+		if (server_draining(main_server, i)) {
+			stats->draining_keys += server->size;
+			continue;
+		}
+
+		stats->no_servers++;
+		stats->total_keys += server->size;
+		if (server->size > stats->max_keys)
+			stats->max_keys = server->size;
+		if (server->size < stats->min_keys)
+			stats->min_keys = server->size;
+	}
+
+	if (stats->no_servers == 0) {
+		stats->min_keys = 0;
+		return;
+	}
+
+	stats->mean = (double)stats->total_keys / stats->no_servers;
+
+	// calculate the standard deviation of the number of objects per server
+	double variance = 0;
+	for (int i = 0; i < MAX_HASH; i++) {
+		server_memory* server = main_server->servers_ht[i];
+		if (server == NULL || server_draining(main_server, i))
+			continue;
+
+		double difference = server->size - stats->mean;
+		variance += difference * difference;
+	}
+	stats->stddev = sqrt(variance / stats->no_servers);
+
+	if (stats->mean > 0)
+		stats->max_mean_ratio = stats->max_keys / stats->mean;
+}
+
+// function which sums the memory used by the servers of the load balancer
+void loader_memory_stats(load_balancer* main_server, memory_stats* stats)
+{
+	memset(stats, 0, sizeof(memory_stats));
+
+	for (int i = 0; i < MAX_HASH; i++) {
+		server_memory* server = main_server->servers_ht[i];
+		if (server == NULL)
+			continue;
+
+		stats->total_keys += server->size;
+		stats->bytes_used += server->bytes_used;
+		stats->bytes_allocated += server->pool->bytes_allocated;
+		stats->bytes_reserved += server->pool->bytes_reserved;
+		stats->expiring += server->expiring;
+		stats->expired += server->expired;
+		stats->budget += server->budget;
+		stats->evicted += server->evicted;
+		stats->packed += server->packed;
+		stats->packed_bytes += server->packed_bytes;
+		stats->unpacked_bytes += server->unpacked_bytes;
+	}
+}
+
+// function which removes the expired objects of all the servers
+void loader_expire(load_balancer* main_server)
+{
+	int thread_safe = main_server->config.thread_safe;
+	if (thread_safe)
+		pthread_mutex_lock(&main_server->writer_lock);
+
+	for (int i = 0; i < MAX_HASH; i++) {
+		server_memory* server = main_server->servers_ht[i];
+		if (server == NULL)
+			continue;
+
+		if (thread_safe)
+			pthread_mutex_lock(&server->lock);
+		server_expire(server);
+		if (thread_safe)
+			pthread_mutex_unlock(&server->lock);
+	}
+
+	if (thread_safe)
+		pthread_mutex_unlock(&main_server->writer_lock);
+}
+
+// function which sums the lookups answered by the filters of the servers
+void loader_filter_stats(load_balancer* main_server, filter_stats* stats)
+{
+	memset(stats, 0, sizeof(filter_stats));
+
+	for (int i = 0; i < MAX_HASH; i++) {
+		server_memory* server = main_server->servers_ht[i];
+		if (server == NULL)
+			continue;
+
+		stats->bytes += (size_t)server->filter->no_blocks * KEY_FILTER_BLOCK;
+		stats->negatives += server->filter->negatives;
+		stats->false_positives += server->filter->false_positives;
+	}
+
+	unsigned long long misses = stats->negatives + stats->false_positives;
+	if (misses > 0)
+		stats->false_positive_rate = (double)stats->false_positives / misses;
+}
+
+// dynamic array of the pairs of a server written in a snapshot
+typedef struct snapshot_entries snapshot_entries;
+struct snapshot_entries {
+	snapshot_entry* entries;
+	unsigned int size;
+	unsigned int capacity;
+	// 1 if the values are copied, because the packed values of the
+	// server are unpacked in a buffer which is reused
+	int copy_values;
+};
+
+// function called for each pair of a server written in a snapshot
+void collect_snapshot_entry(char* key, char* value, void* arg) {
+	snapshot_entries* array = arg;
+
+	if (array->size == array->capacity) {
+		array->capacity = array->capacity ? 2 * array->capacity : 256;
+		array->entries = realloc(array->entries,
+								 array->capacity * sizeof(snapshot_entry));
+		DIE(array->entries == NULL, "Error");
+	}
+	if (array->copy_values) {
+		size_t size = strlen(value) + 1;
+		char* copy = malloc(size);
+		DIE(copy == NULL, "Error");
+		value = memcpy(copy, value, size);
+	}
+
+	array->entries[array->size].key = key;
+	array->entries[array->size].value = value;
+	array->size++;
+}
+
+// function which returns the ids of the servers, in the order they were
+// added to the router (by hashring position, for the hashring)
+unsigned int* snapshot_server_ids(router* routes, unsigned int* count) {
+	hashring* ring = routes->ring;
+	unsigned int* ids = malloc((ring ? ring->size : routes->no_servers + 1) *
+							   sizeof(unsigned int));
+	DIE(ids == NULL, "Error");
+
+	*count = 0;
+	for (unsigned int i = 0; ring && i < ring->size; i++) {
+		if (ring->labels[i].replica == 0)
+			ids[(*count)++] = ring->labels[i].server_id;
+	}
+	for (unsigned int i = 0; ring == NULL && i < routes->no_servers; i++)
+		ids[(*count)++] = routes->server_ids[i];
+
+	return ids;
+}
+
+// function which writes the load balancer in a snapshot file
+void loader_save_snapshot(load_balancer* main_server, const char* path)
+{
+	// the servers can't change while the snapshot is written, so the
+	// snapshot contains the effects of all the records of the log, and
+	// each key is on the server which the routing array gives
+	finish_migration(main_server);
+	int thread_safe = main_server->config.thread_safe;
+	if (thread_safe)
+		pthread_mutex_lock(&main_server->writer_lock);
+
+	router* routes = main_server->routes;
+	snapshot_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.routing = main_server->config.routing;
+	header.bounded_loads = main_server->config.bounded_loads;
+	header.replication_factor = main_server->config.replication_factor;
+	header.load_epsilon = main_server->config.load_epsilon;
+	header.no_objects = main_server->no_objects;
+
+	unsigned int* ids = snapshot_server_ids(routes, &header.no_servers);
+	if (thread_safe)
+		lock_servers(main_server, ids, header.no_servers, 1);
+
+	// the tables of a snapshot have no deadlines
+	for (unsigned int i = 0; i < header.no_servers; i++) {
+		server_memory* server = main_server->servers_ht[ids[i]];
+		server_expire(server);
+		DIE(server->expiring != 0,
+			"a snapshot can't hold objects which expire");
+	}
+
+	snapshot_server* servers = calloc(header.no_servers + 1,
+									  sizeof(snapshot_server));
+	DIE(servers == NULL, "Error");
+
+	// the snapshot is written next to the old one and renamed at the end,
+	// so the old snapshot stays whole (and can still be mapped) until then
+	char* temporary = malloc(strlen(path) + sizeof(".tmp"));
+	DIE(temporary == NULL, "Error");
+	strcpy(temporary, path);
+	strcat(temporary, ".tmp");
+	FILE* file = fopen(temporary, "wb");
+	DIE(file == NULL, "fopen");
+
+	// the header and the servers are written again at the end, when the
+	// offsets of the tables are known
+	size_t offset = 0;
+	snapshot_write(file, &offset, &header, sizeof(header));
+	header.servers_offset = offset;
+	snapshot_write(file, &offset, servers,
+				   header.no_servers * sizeof(snapshot_server));
+	if (routes->strategy == ROUTING_JUMP) {
+		header.no_buckets = routes->no_buckets;
+		header.buckets_offset = offset;
+		snapshot_write(file, &offset, routes->buckets,
+					   routes->no_buckets * sizeof(unsigned int));
+	}
+
+	snapshot_entries array = {NULL, 0, 0, 0};
+	for (unsigned int i = 0; i < header.no_servers; i++) {
+		server_memory* server = main_server->servers_ht[ids[i]];
+		servers[i].server_id = ids[i];
+		servers[i].weight = main_server->server_vnodes[ids[i]];
+		servers[i].overflowed = main_server->overflowed ?
+								main_server->overflowed[ids[i]] : 0;
+
+		array.size = 0;
+		array.copy_values = server->packed > 0;
+		server_for_each(server, collect_snapshot_entry, &array);
+		snapshot_write_table(file, &offset, array.entries, array.size,
+							 &servers[i].table);
+		for (unsigned int j = 0; array.copy_values && j < array.size; j++)
+			free(array.entries[j].value);
+	}
+	header.size = offset;
+
+	DIE(fseek(file, 0, SEEK_SET) != 0, "fseek");
+	snapshot_write(file, &offset, &header, sizeof(header));
+	snapshot_write(file, &offset, servers,
+				   header.no_servers * sizeof(snapshot_server));
+	DIE(fclose(file) != 0, "fclose");
+	DIE(rename(temporary, path) != 0, "rename");
+
+	// the records of the log are not needed by the recovery anymore
+	if (main_server->log != NULL)
+		wal_reset(main_server->log);
+	if (thread_safe) {
+		lock_servers(main_server, ids, header.no_servers, 0);
+		pthread_mutex_unlock(&main_server->writer_lock);
+	}
+	free(temporary);
+	free(array.entries);
+	free(servers);
+	free(ids);
+}
+
+// function which restores a load balancer from a snapshot file, whose
+// pairs are used where they are mapped
+load_balancer* loader_restore_snapshot(load_balancer_config* config,
+									   const char* path)
+{
+	int fd = open(path, O_RDONLY);
+	DIE(fd < 0, "missing snapshot file");
+	struct stat status;
+	DIE(fstat(fd, &status) < 0, "fstat");
+	DIE((size_t)status.st_size < sizeof(snapshot_header), "bad snapshot");
+
+	char* base = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	DIE(base == MAP_FAILED, "mmap");
+	close(fd);
+	// the pages are read by lookups of random keys, so reading ahead
+	// would only fault in pages which aren't used
+	madvise(base, status.st_size, MADV_RANDOM);
+
+	const snapshot_header* header = (const snapshot_header*)base;
+	DIE(memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) ||
+		header->size != (unsigned long long)status.st_size, "bad snapshot");
+
+	// the options deciding the server of a key are the snapshot's ones
+	load_balancer_config restored = *config;
+	restored.routing = header->routing;
+	restored.bounded_loads = header->bounded_loads;
+	restored.replication_factor = header->replication_factor;
+	restored.load_epsilon = header->load_epsilon;
+	load_balancer* main_server = init_load_balancer_config(&restored);
+	main_server->snapshot = base;
+	main_server->snapshot_size = status.st_size;
+	main_server->no_objects = header->no_objects;
+
+	// the servers are added without objects, so nothing is moved
+	const snapshot_server* servers =
+		(const snapshot_server*)(base + header->servers_offset);
+	router* routes = main_server->routes;
+	for (unsigned int i = 0; i < header->no_servers; i++) {
+		unsigned int id = servers[i].server_id;
+		DIE(id >= MAX_HASH || main_server->servers_ht[id], "bad snapshot");
+
+		main_server->servers_ht[id] =
+			init_server_memory_backend(restored.backend);
+		main_server->servers_ht[id]->clock = main_server->config.clock;
+		// the budget is checked at the first store, when the objects of
+		// the server are loaded
+		main_server->servers_ht[id]->budget = restored.server_budget;
+		server_set_pack_threshold(main_server->servers_ht[id],
+								  restored.pack_threshold);
+		main_server->server_vnodes[id] = servers[i].weight;
+		router_add_server(routes, id, servers[i].weight);
+		server_attach_snapshot(main_server->servers_ht[id], base,
+							   &servers[i].table);
+
+		if (servers[i].overflowed) {
+			main_server->overflowed[id] = 1;
+			main_server->no_overflowed++;
+		}
+	}
+
+	// the buckets of jump hashing depend on the removed servers too
+	if (routes->strategy == ROUTING_JUMP) {
+		DIE(header->no_buckets != routes->no_buckets, "bad snapshot");
+		memcpy(routes->buckets, base + header->buckets_offset,
+			   routes->no_buckets * sizeof(unsigned int));
+	}
+
+	return main_server;
+}
+
+// function which applies the records of a write-ahead log
+void replay_log(load_balancer* main_server, const char* path)
+{
+	command_file input;
+	open_command_file(&input, path);
+
+	// an incomplete record at the end of the log is ignored
+	command_reader reader;
+	init_command_reader(&reader, &input);
+	reader.end = input.data + command_log_valid_size(input.data, input.size);
+
+	command request;
+	int server_id;
+	while (reader.binary && next_command(&reader, &request)) {
+		if (request.type == COMMAND_STORE) {
+			loader_store_key(main_server, &request.key, request.value,
+							 &server_id);
+		} else if (request.type == COMMAND_ADD_SERVER) {
+			loader_add_server_weighted(main_server, request.server_id,
+									   request.weight);
+		} else if (request.type == COMMAND_REMOVE_SERVER) {
+			loader_remove_server(main_server, request.server_id);
+		}
+	}
+
+	close_command_file(&input);
+}
+
+// function which recovers a load balancer from its last snapshot and
+// its write-ahead log
+load_balancer* loader_recover(load_balancer_config* config,
+							  const char* snapshot_path)
+{
+	// the log is opened after it is replayed, so the replayed
+	// operations are not appended to it again
+	load_balancer_config replay = *config;
+	replay.wal.path = NULL;
+
+	load_balancer* main_server;
+	if (snapshot_path != NULL && access(snapshot_path, F_OK) == 0)
+		main_server = loader_restore_snapshot(&replay, snapshot_path);
+	else
+		main_server = init_load_balancer_config(&replay);
+
+	if (config->wal.path != NULL) {
+		if (access(config->wal.path, F_OK) == 0)
+			replay_log(main_server, config->wal.path);
+		main_server->config.wal = config->wal;
+		main_server->log = create_wal(&main_server->config.wal);
+	}
+
+	return main_server;
 }
 
 // function used for freeing the main load balancer
 void free_load_balancer(load_balancer* main_server)
 {
 	// iterate through the hashring elements
-	cdll_node* current = main_server->hashring->head;
-	int hashring_size = main_server->hashring->size;
+	router* routes = main_server->routes;
+	hashring* ring = routes->ring;
 
-    for (int i = 0; i < hashring_size; i++) {
+    for (int i = 0; ring && i < (int)ring->size; i++) {
 		// if the server label represents the server's id
 		// (not it's labels), free the server's hashtable
-		if (*(unsigned int*)current->data < MAX_HASH) {
-			free_server_memory(main_server->servers_ht[*(unsigned int*)
-							   current->data]);
+		if (ring->labels[i].replica == 0) {
+			free_server_memory(main_server->servers_ht[ring->labels[i].
+							   server_id]);
 		}
-		current = current->next;
 	}
 
-	// free the hashring cdll, the array of hashtables and the main server
-	cdll_free(&main_server->hashring);
+	// the other strategies keep a list of the servers
+	for (unsigned int i = 0; ring == NULL && i < routes->no_servers; i++)
+		free_server_memory(main_server->servers_ht[routes->server_ids[i]]);
+
+	// a removed server which was still drained isn't in the router
+	if (main_server->old_routes != NULL) {
+		int server_id = main_server->migration.server_id;
+		if (server_draining(main_server, server_id))
+			free_server_memory(main_server->servers_ht[server_id]);
+		free_router(main_server->old_routes);
+	}
+	free(main_server->migration_ranges);
+
+	// free the router, the array of hashtables and the main server
+	free_router(routes);
 	free(main_server->servers_ht);
+	free(main_server->server_vnodes);
+	free(main_server->batch);
+	free(main_server->overflowed);
+	free(main_server->probe_marks);
+	free(main_server->replica_loads);
+	if (main_server->cache != NULL)
+		free_front_cache(main_server->cache);
+	pthread_mutex_destroy(&main_server->writer_lock);
+	if (main_server->snapshot != NULL)
+		munmap(main_server->snapshot, main_server->snapshot_size);
+	if (main_server->log != NULL)
+		free_wal(main_server->log);
 	free(main_server);
 }
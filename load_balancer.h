@@ -6,12 +6,179 @@
 #define LOAD_BALANCER_H_
 
 #include "server.h"
+#include "hashring.h"
+#include "router.h"
+#include "rcu.h"
+#include "wal.h"
+#include "front_cache.h"
+
+// number of labels (virtual nodes) a server gets on the hashring
+// when it is added without a weight
+#define DEFAULT_VNODES 3
+
+// default value of load_epsilon: with bounded loads, a server takes at
+// most 1.25 times its share of the objects
+#define DEFAULT_LOAD_EPSILON 0.25
+
+// maximum number of servers which store each object
+#define MAX_REPLICATION_FACTOR 8
+
+// with REPLICA_READ_LEAST_LOADED, the reads counted for each server are
+// halved every REPLICA_READ_WINDOW reads, so the old reads weigh less
+#define REPLICA_READ_WINDOW 65536
+
+// replica which answers a read, when the objects are replicated
+typedef enum replica_read_policy {
+	// the replicas of a key answer its reads in turn
+	REPLICA_READ_ROUND_ROBIN,
+	// the replica which answered the fewest recent reads answers
+	REPLICA_READ_LEAST_LOADED
+} replica_read_policy;
 
 struct load_balancer;
 typedef struct load_balancer load_balancer;
 
+// options of the load balancer, given when it is initialised
+typedef struct load_balancer_config load_balancer_config;
+struct load_balancer_config {
+	// backend used for the servers' hashtables
+	server_backend backend;
+	// strategy used for routing the keys to the servers
+	routing_strategy routing;
+	// if set, the load balancer can be used by several threads at once:
+	// the hashring is read without locking and each server has its own
+	// lock, so objects on different servers are handled in parallel
+	int thread_safe;
+	// if set, the hashring has bounded loads: a server stores at most
+	// (1 + load_epsilon) times its share of the objects (given by its
+	// number of labels) and a new key which would go above the bound is
+	// stored on the next server of the hashring; it can't be used with
+	// the other routing strategies or with thread_safe
+	int bounded_loads;
+	double load_epsilon;
+	// write-ahead log of the stores and of the added and removed servers
+	// (wal.path is NULL if there isn't any); an operation is appended to
+	// the log before it is applied and it returns when its record is
+	// synced, according to the sync policy of the log
+	wal_config wal;
+	// number of servers which store each object (0 or 1 if the objects
+	// are not replicated, at most MAX_REPLICATION_FACTOR): the first
+	// servers of the labels which follow the key on the hashring, each
+	// one counted once; the reads are spread between them according to
+	// replica_reads; it can't be used with the other routing strategies,
+	// with bounded loads or with thread_safe
+	unsigned int replication_factor;
+	replica_read_policy replica_reads;
+	// number of entries of the front cache, which keeps the servers and
+	// the values of the most read keys (0 if there isn't any); the
+	// stores drop their keys from the cache and the added or removed
+	// servers empty it; it can't be used with thread_safe
+	unsigned int front_cache_size;
+	// bytes of keys, values and metadata which each added server can use
+	// (0 if they are unlimited; see loader_add_server_budget); it can't
+	// be used with the front cache
+	size_t server_budget;
+	// values at least this long are compressed by the in-tree LZ codec
+	// (value_codec.h) when they get smaller, on every added server (0 if
+	// the values are never compressed); a compressed value is read with
+	// loader_retrieve_copy, which decompresses it in the caller's buffer;
+	// it can't be used with the front cache or the batch retrieves
+	unsigned int pack_threshold;
+	// if not 0, the objects of an added or removed server are moved
+	// incrementally, at most migration_step keys at a time (see
+	// loader_migrate), instead of all of them before the change returns;
+	// it can't be used with the other routing strategies, with bounded
+	// loads, with replication, with the front cache or with thread_safe
+	unsigned int migration_step;
+	// clock which tells when the objects stored with a time to live
+	// expire, in milliseconds (monotonic_ms if it is NULL)
+	wheel_clock clock;
+};
+
+// statistics about the distribution of the objects between the servers
+typedef struct distribution_stats distribution_stats;
+struct distribution_stats {
+	unsigned int no_servers;
+	unsigned int total_keys;
+	unsigned int min_keys;
+	unsigned int max_keys;
+	// mean number of objects per server
+	double mean;
+	// ratio between the most loaded server and the mean
+	double max_mean_ratio;
+	// standard deviation of the number of objects per server
+	double stddev;
+	// objects of a removed server which the migration in progress didn't
+	// move yet; the removed server isn't counted in the other fields
+	unsigned int draining_keys;
+};
+
+// memory used by the servers of a load balancer
+typedef struct memory_stats memory_stats;
+struct memory_stats {
+	unsigned int total_keys;
+	// bytes used by the stored keys, values and their metadata
+	size_t bytes_used;
+	// bytes handed out by the servers' arenas
+	size_t bytes_allocated;
+	// bytes reserved by the servers' arenas
+	size_t bytes_reserved;
+	// objects which have a deadline and objects which expired
+	unsigned int expiring;
+	unsigned long long expired;
+	// sum of the budgets of the servers (the servers without a budget
+	// count 0) and objects evicted for staying under them
+	size_t budget;
+	unsigned long long evicted;
+	// values compressed by the value codec, their compressed bytes and
+	// their bytes before they were compressed
+	unsigned int packed;
+	size_t packed_bytes;
+	size_t unpacked_bytes;
+};
+
+// lookups answered by the filters of the servers of a load balancer
+typedef struct filter_stats filter_stats;
+struct filter_stats {
+	// bytes of the filters
+	size_t bytes;
+	// lookups of missing keys answered by the filters and lookups of
+	// missing keys which passed them
+	unsigned long long negatives;
+	unsigned long long false_positives;
+	// fraction of the lookups of missing keys which passed the filters
+	double false_positive_rate;
+};
+
+// progress of the incremental migrations of a load balancer
+typedef struct migration_stats migration_stats;
+struct migration_stats {
+	// 1 while a migration is in progress, with the server which was
+	// added or removed
+	int active;
+	int server_id;
+	// objects which the current (or the last) migration has to move and
+	// objects it moved; the objects stored again or expired meanwhile
+	// are not moved, so the migration may end before moving all of them
+	unsigned int total_keys;
+	unsigned int moved_keys;
+	// steps of all the migrations, their total and longest time (the
+	// pause of the operation which made the step), in nanoseconds
+	unsigned long long steps;
+	double total_pause_ns;
+	double max_pause_ns;
+	// lookups of keys which weren't moved yet, answered by their former
+	// server
+	unsigned long long fallbacks;
+};
+
+// function which fills a configuration with the default options
+void default_load_balancer_config(load_balancer_config* config);
+
 load_balancer* init_load_balancer();
 
+load_balancer* init_load_balancer_config(load_balancer_config* config);
+
 void free_load_balancer(load_balancer* main);
 
 /**
@@ -24,7 +191,9 @@ void free_load_balancer(load_balancer* main);
  *
  * The load balancer will use Consistent Hashing to distribute the 
  * load across the servers. The chosen server ID will be returned 
- * using the last parameter.
+ * using the last parameter. When the objects are replicated, the
+ * object is stored on all its replicas and the ID of the first one
+ * is returned.
  */
 void loader_store(load_balancer* main, char* key, char* value, int* server_id);
 
@@ -37,21 +206,167 @@ void loader_store(load_balancer* main, char* key, char* value, int* server_id);
  *
  * The load balancer will search for the server which should posess the 
  * value associated to the key. The server will return NULL in case 
- * the key does NOT exist in the system.
+ * the key does NOT exist in the system. When the objects are replicated,
+ * the ID of the replica which answered is returned. A compressed value
+ * is decompressed in a buffer of its server, which is reused by the
+ * server's next operation.
  */
 char* loader_retrieve(load_balancer* main, char* key, int* server_id);
 
+/**
+ * loader_store_key() - Stores a key-value pair whose key is hashed.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: Key, with its length and its hash (given by key_hash64).
+ * @arg3: Value represented as a string.
+ * @arg4: This function will RETURN via this parameter
+ *        the server ID which stores the object.
+ *
+ * Same as loader_store, for callers which already know the length and
+ * the hash of the key (for example, from a binary command log).
+ */
+void loader_store_key(load_balancer* main, key_descriptor* key, char* value,
+					  int* server_id);
+
+/**
+ * loader_store_expiring() - Stores a key-value pair which expires.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: Key represented as a string.
+ * @arg3: Value represented as a string.
+ * @arg4: Time to live of the object, in milliseconds of the clock of
+ *        the load balancer (it must be positive).
+ * @arg5: This function will RETURN via this parameter
+ *        the server ID which stores the object.
+ *
+ * Same as loader_store, except that the object is treated as missing
+ * once its time to live passed; a later store of the key replaces its
+ * deadline. Each server keeps the deadlines of its objects in a timing
+ * wheel, so the expired objects are removed by the next operation of
+ * their server (or by loader_expire) without scanning the others, and
+ * they keep their deadline when they move to another server. The front
+ * cache, the write-ahead log and the snapshots can't be used with
+ * objects which expire.
+ */
+void loader_store_expiring(load_balancer* main, char* key, char* value,
+						   unsigned int ttl_ms, int* server_id);
+
+// function which stores a key-value pair whose key is hashed, which
+// expires after ttl_ms milliseconds (see loader_store_expiring)
+void loader_store_key_expiring(load_balancer* main, key_descriptor* key,
+							   char* value, unsigned int ttl_ms,
+							   int* server_id);
+
+// function which removes the expired objects of all the servers, for
+// the servers which are not used often enough to remove them
+void loader_expire(load_balancer* main);
+
+/**
+ * loader_retrieve_key() - Gets the value associated with a hashed key.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: Key, with its length and its hash.
+ * @arg3: This function will RETURN the server ID
+ *        which stores the value via this parameter.
+ *
+ * Same as loader_retrieve, without hashing the key again.
+ */
+char* loader_retrieve_key(load_balancer* main, key_descriptor* key,
+						  int* server_id);
+
+/**
+ * loader_retrieve_copy() - Copies the value associated with the key.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: Key represented as a string.
+ * @arg3: Buffer in which the value is copied.
+ * @arg4: Size of the buffer; a longer value is truncated.
+ * @arg5: This function will RETURN the server ID
+ *        which stores the value via this parameter.
+ *
+ * When the load balancer is thread safe, the value returned by
+ * loader_retrieve may be changed by another thread storing the same key,
+ * so the value is copied while its server is locked. A compressed value
+ * is decompressed straight in the buffer (when it fits).
+ *
+ * Return: 1 if the key exists, 0 otherwise.
+ */
+int loader_retrieve_copy(load_balancer* main, char* key, char* value,
+						 size_t size, int* server_id);
+
+/**
+ * loader_store_batch() - Stores a batch of key-value pairs.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: Array of keys.
+ * @arg3: Array of values; values[i] is stored at keys[i].
+ * @arg4: This function will RETURN via this array the server ID
+ *        which stores each object.
+ * @arg5: Number of objects of the batch.
+ *
+ * All the keys are hashed and routed first, then the objects are grouped
+ * by server, so each server stores its objects one after the other.
+ * The result is the same as calling loader_store for each object in
+ * order (a key stored more than once keeps its last value).
+ */
+void loader_store_batch(load_balancer* main, char** keys, char** values,
+						int* server_ids, unsigned int count);
+
+/**
+ * loader_retrieve_batch() - Gets the values of a batch of keys.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: Array of keys.
+ * @arg3: This function will RETURN via this array the value associated
+ *        to each key, or NULL if the key does NOT exist.
+ * @arg4: This function will RETURN via this array the server ID
+ *        which should store each key.
+ * @arg5: Number of keys of the batch.
+ *
+ * The returned values are owned by the servers and stay valid until
+ * their keys are stored again or removed. The batches don't use the
+ * front cache.
+ */
+void loader_retrieve_batch(load_balancer* main, char** keys, char** values,
+						   int* server_ids, unsigned int count);
+
 /**
  * load_add_server() - Adds a new server to the system.
  * @arg1: Load balancer which distributes the work.
  * @arg2: ID of the new server.
  *
- * The load balancer will generate 3 replica TAGs and it will
+ * The load balancer will generate DEFAULT_VNODES replica TAGs and it will
  * place them inside the hash ring. The neighbor servers will 
  * distribute some the objects to the added server.
  */
 void loader_add_server(load_balancer* main, int server_id);
 
+/**
+ * loader_add_server_weighted() - Adds a new server with a given weight.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: ID of the new server.
+ * @arg3: Number of replica TAGs (virtual nodes) of the server, at least 1.
+ *
+ * A server with more TAGs owns a proportionally larger part of the hash
+ * ring, so bigger machines can take more objects; hundreds of TAGs per
+ * server also lower the variance of the load between the servers.
+ */
+void loader_add_server_weighted(load_balancer* main, int server_id,
+								unsigned int vnodes);
+
+/**
+ * loader_add_server_budget() - Adds a new server with a memory budget.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: ID of the new server.
+ * @arg3: Number of replica TAGs (virtual nodes) of the server.
+ * @arg4: Bytes of keys, values and metadata which the server can use,
+ *        or 0 if they are unlimited.
+ *
+ * loader_add_server and loader_add_server_weighted give the server the
+ * budget of the configuration. When a store or the objects moved on the
+ * server take it above its budget, the server evicts objects with the
+ * CLOCK policy (see server_set_budget), so the load balancer can be used
+ * as a cache: an evicted object is missing, on all the replicas which
+ * evicted it. The budgets are not kept in the write-ahead log or in the
+ * snapshots, and the bounded loads don't count the evicted objects out.
+ */
+void loader_add_server_budget(load_balancer* main, int server_id,
+							  unsigned int vnodes, size_t budget);
+
 /**
  * load_remove_server() - Removes a specific server from the system.
  * @arg1: Load balancer which distributes the work.
@@ -59,8 +374,152 @@ void loader_add_server(load_balancer* main, int server_id);
  *
  * The load balancer will distribute ALL objects stored on the
  * removed server and will delete ALL replicas from the hash ring.
+ *
+ * When the load balancer is thread safe, a new hash ring is published
+ * while the servers whose objects move are locked; the other servers
+ * keep handling requests during the migration. When the objects are
+ * replicated, only the objects of the removed server lost a replica,
+ * so each of them is moved on the server which becomes its last replica.
  */
 void loader_remove_server(load_balancer* main, int server_id);
 
-unsigned int hash_function_servers(void *a);
+/**
+ * loader_migrate() - Makes a step of the migration in progress.
+ * @arg1: Load balancer which distributes the work.
+ *
+ * With migration_step, adding or removing a server only changes the
+ * router: the objects which change server are moved afterwards, at most
+ * migration_step keys per step. Each store and retrieve makes a step
+ * before it runs, and an idle caller can make more of them. Until the
+ * migration ends, a key missing on its new server is looked up on its
+ * former server, and a stored key is removed from its former server, so
+ * its old value isn't moved over the new one. A change of the servers,
+ * a batch or a snapshot finishes the migration in progress first.
+ *
+ * Return: 1 if the migration is still in progress after the step,
+ *         0 otherwise.
+ */
+int loader_migrate(load_balancer* main);
+
+/**
+ * loader_migration_stats() - Reports the progress of the migrations.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: This function will RETURN the statistics via this parameter.
+ */
+void loader_migration_stats(load_balancer* main, migration_stats* stats);
+
+/**
+ * loader_get_server() - Gets the hashtable of a server.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: ID of the server.
+ *
+ * Return: The hashtable of the server (which can be used for getting its
+ *         statistics) or NULL if the server is not on the load balancer.
+ */
+server_memory* loader_get_server(load_balancer* main, int server_id);
+
+/**
+ * loader_distribution_stats() - Reports the distribution quality.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: This function will RETURN the statistics via this parameter.
+ *
+ * The statistics contain the number of objects of the least and most
+ * loaded servers, the max/mean ratio and the standard deviation
+ * of the number of objects per server. The servers are not locked, so
+ * no other thread should change the load balancer meanwhile. The copies
+ * of the replicated objects are counted on each of their servers. A
+ * removed server which is still drained by an incremental migration is
+ * left out, and its objects are reported as draining_keys.
+ */
+void loader_distribution_stats(load_balancer* main, distribution_stats* stats);
+
+/**
+ * loader_memory_stats() - Reports the memory used by the servers.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: This function will RETURN the statistics via this parameter.
+ *
+ * Because the objects are moved between servers without being copied,
+ * the bytes used and allocated stay the same when servers are added
+ * or removed. The objects of a restored server which are still in the
+ * snapshot are counted in total_keys only.
+ */
+void loader_memory_stats(load_balancer* main, memory_stats* stats);
+
+/**
+ * loader_filter_stats() - Reports how the filters of the servers answer
+ * the lookups of missing keys.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: This function will RETURN the statistics via this parameter.
+ *
+ * A lookup which passes the filter of its server searches the server's
+ * hashtable; it is a false positive if the key isn't there. The lookups
+ * of the removed servers are not counted.
+ */
+void loader_filter_stats(load_balancer* main, filter_stats* stats);
+
+/**
+ * loader_save_snapshot() - Writes the load balancer in a snapshot file.
+ * @arg1: Load balancer which distributes the work.
+ * @arg2: Path of the snapshot file.
+ *
+ * The file holds the servers with their labels and a table of the
+ * objects of each server, linked by offsets, so it can be used wherever
+ * it is mapped (see snapshot.h). When the load balancer is thread safe,
+ * all the servers are locked while the file is written. The write-ahead
+ * log (if there is one) is emptied afterwards, since the snapshot holds
+ * the effects of its records.
+ */
+void loader_save_snapshot(load_balancer* main, const char* path);
+
+/**
+ * loader_restore_snapshot() - Restores a load balancer from a snapshot.
+ * @arg1: Options of the load balancer; the routing strategy, the
+ *        bounded loads and the replication factor are taken from the
+ *        snapshot.
+ * @arg2: Path of the snapshot file.
+ *
+ * The file is mapped and the objects are not read: the keys are looked
+ * up in the tables of the snapshot, so its pages are faulted in as they
+ * are used. A server's objects are loaded in its hashtable the first
+ * time the server changes (an object is stored or removed, or objects
+ * move because of a new or removed server).
+ *
+ * Return: The restored load balancer.
+ */
+load_balancer* loader_restore_snapshot(load_balancer_config* config,
+									   const char* path);
+
+/**
+ * loader_get_wal() - Gets the write-ahead log of the load balancer.
+ * @arg1: Load balancer which distributes the work.
+ *
+ * Return: The write-ahead log (which can be used for getting the number
+ *         of its records and syncs) or NULL if there isn't any.
+ */
+write_ahead_log* loader_get_wal(load_balancer* main);
+
+/**
+ * loader_get_front_cache() - Gets the front cache of the load balancer.
+ * @arg1: Load balancer which distributes the work.
+ *
+ * Return: The front cache (whose hit and miss counters can be used for
+ *         sizing it) or NULL if there isn't any.
+ */
+front_cache* loader_get_front_cache(load_balancer* main);
+
+/**
+ * loader_recover() - Recovers a load balancer after a restart.
+ * @arg1: Options of the load balancer, with its write-ahead log.
+ * @arg2: Path of the last snapshot, or NULL.
+ *
+ * The load balancer is restored from the snapshot (if it exists), then
+ * the records of the write-ahead log (if it exists) are applied on top
+ * of it; an incomplete record at the end of the log is ignored. The
+ * following operations are appended to the same log.
+ *
+ * Return: The recovered load balancer.
+ */
+load_balancer* loader_recover(load_balancer_config* config,
+							  const char* snapshot_path);
+
 #endif  // LOAD_BALANCER_H_
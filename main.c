@@ -6,117 +6,232 @@
 #include <string.h>
 
 #include "load_balancer.h"
+#include "command_io.h"
 #include "utils.h"
 
-#define REQUEST_LENGTH 1024
-#define KEY_LENGTH 128
-#define VALUE_LENGTH 65536
-
-// function which gets the key and value from a request
-void get_key_value(char* key, char* value, char* request) {
-	int key_start = 0, value_start = 0;
-	int key_finish = 0, value_finish = 0;
-	int key_index = 0, value_index = 0;
-
-	for (unsigned int i = 0; i < strlen(request); ++i) {
-		if (request[i] == '"' && value_start != 1) {
-			if (key_start == 0) {
-				key_start = 1;
-			} else if (key_finish == 0) {
-				key_finish = 1;
-			} else if (value_start == 0) {
-				value_start = 1;
-			}
-		} else {
-			if (key_start == 1 && key_finish == 0) {
-				key[key_index++] = request[i];
-			} else if (value_start == 1 && value_finish == 0) {
-				value[value_index++] = request[i];
-			}
-		}
+#define BATCH_SIZE 4096
+
+// run of consecutive store or retrieve requests, applied together; the
+// keys and values point in the command file, which outlives the batch
+typedef struct request_batch request_batch;
+struct request_batch {
+	// COMMAND_STORE or COMMAND_RETRIEVE, or 0 if the batch is empty
+	int type;
+	unsigned int count;
+	char* keys[BATCH_SIZE];
+	char* values[BATCH_SIZE];
+	int server_ids[BATCH_SIZE];
+};
+
+// function which writes the result of a store
+void output_stored(output_writer* output, char* value, int server_id) {
+	output_write(output, "Stored ", sizeof("Stored ") - 1);
+	output_string(output, value);
+	output_write(output, " on server ", sizeof(" on server ") - 1);
+	output_int(output, server_id);
+	output_write(output, ".\n", 2);
+}
+
+// function which writes the result of a retrieve
+void output_retrieved(output_writer* output, char* key, char* value,
+					  int server_id) {
+	if (value == NULL) {
+		output_write(output, "Key ", sizeof("Key ") - 1);
+		output_string(output, key);
+		output_write(output, " not present.\n",
+					 sizeof(" not present.\n") - 1);
+		return;
 	}
 
-	value[value_index - 1] = 0;
+	output_write(output, "Retrieved ", sizeof("Retrieved ") - 1);
+	output_string(output, value);
+	output_write(output, " from server ", sizeof(" from server ") - 1);
+	output_int(output, server_id);
+	output_write(output, ".\n", 2);
 }
 
-// function which gets the key from a request
-void get_key(char* key, char* request) {
-	int key_start = 0, key_index = 0;
-
-	for (unsigned int i = 0; i < strlen(request); ++i) {
-		if (request[i] == '"') {
-			key_start = 1;
-		} else if (key_start == 1) {
-			key[key_index++] = request[i];
-		}
+// function which applies the requests of a batch and writes their
+// results in the order of the requests
+void flush_batch(load_balancer* main_server, request_batch* batch,
+				 output_writer* output) {
+	if (batch->type == COMMAND_STORE) {
+		loader_store_batch(main_server, batch->keys, batch->values,
+						   batch->server_ids, batch->count);
+		for (unsigned int i = 0; i < batch->count; i++)
+			output_stored(output, batch->values[i], batch->server_ids[i]);
+	} else if (batch->type == COMMAND_RETRIEVE) {
+		// the retrieved values belong to the servers
+		loader_retrieve_batch(main_server, batch->keys, batch->values,
+							  batch->server_ids, batch->count);
+		for (unsigned int i = 0; i < batch->count; i++)
+			output_retrieved(output, batch->keys[i], batch->values[i],
+							 batch->server_ids[i]);
 	}
+
+	batch->count = 0;
+	batch->type = 0;
+}
+
+// function which adds a request to the batch; a batch only has
+// requests of one type, so the batch is applied when the type changes
+void add_to_batch(load_balancer* main_server, request_batch* batch,
+				  output_writer* output, int type, char* key, char* value) {
+	if (batch->type != type || batch->count == BATCH_SIZE)
+		flush_batch(main_server, batch, output);
+
+	batch->type = type;
+	batch->keys[batch->count] = key;
+	batch->values[batch->count] = value;
+	batch->count++;
 }
 
 // function which applies the request command by
 // calling the functions which executes the command
-void apply_requests(FILE* input_file) {
-	char request[REQUEST_LENGTH] = {0};
-	char key[KEY_LENGTH] = {0};
-	char value[VALUE_LENGTH] = {0};
-	load_balancer* main_server = init_load_balancer();
-
-	while (fgets(request, REQUEST_LENGTH, input_file)) {
-		request[strlen(request) - 1] = 0;
-		if (!strncmp(request, "store", sizeof("store") - 1)) {
-			get_key_value(key, value, request);
-
-			int index_server = 0;
-			loader_store(main_server, key, value, &index_server);
-			printf("Stored %s on server %d.\n", value, index_server);
-
-			memset(key, 0, sizeof(key));
-			memset(value, 0, sizeof(value));
-		} else if (!strncmp(request, "retrieve", sizeof("retrieve") - 1)) {
-			get_key(key, request);
-
-			int index_server = 0;
-			char *retrieved_value = loader_retrieve(main_server,
-											key, &index_server);
-			if (retrieved_value) {
-				printf("Retrieved %s from server %d.\n",
-						retrieved_value, index_server);
+// (if batched is set, consecutive store or retrieve requests are
+// collected in batches and applied together); the command file (text or
+// binary) is read in place, so the keys and values are never copied
+void apply_requests(command_file* input, load_balancer* main_server,
+					int batched) {
+	output_writer output;
+	init_output_writer(&output, stdout);
+
+	request_batch* batch = calloc(1, sizeof(request_batch));
+	DIE(batch == NULL, "Error");
+
+	command_reader reader;
+	init_command_reader(&reader, input);
+	command request;
+	while (next_command(&reader, &request)) {
+		int index_server = 0;
+
+		switch (request.type) {
+		case COMMAND_STORE:
+			if (batched) {
+				add_to_batch(main_server, batch, &output, COMMAND_STORE,
+							 request.key.key, request.value);
+				break;
+			}
+			loader_store_key(main_server, &request.key, request.value,
+							 &index_server);
+			output_stored(&output, request.value, index_server);
+			break;
+		case COMMAND_RETRIEVE:
+			if (batched) {
+				add_to_batch(main_server, batch, &output, COMMAND_RETRIEVE,
+							 request.key.key, NULL);
+				break;
+			}
+			char *retrieved_value = loader_retrieve_key(main_server,
+											&request.key, &index_server);
+			output_retrieved(&output, request.key.key, retrieved_value,
+							 index_server);
+			break;
+		case COMMAND_ADD_SERVER:
+			// the other requests must see the effect of the batched ones
+			flush_batch(main_server, batch, &output);
+
+			// an optional weight gives the number of the server's labels
+			// on the hashring
+			if (request.weight >= 0) {
+				loader_add_server_weighted(main_server, request.server_id,
+										   request.weight);
 			} else {
-				printf("Key %s not present.\n", key);
+				loader_add_server(main_server, request.server_id);
 			}
-
-			memset(key, 0, sizeof(key));
-		} else if (!strncmp(request, "add_server", sizeof("add_server") - 1)) {
-			int server_id = atoi(request + sizeof("add_server"));
-
-			loader_add_server(main_server, server_id);
-		} else if (!strncmp(request, "remove_server",
-					sizeof("remove_server") - 1)) {
-			int server_id = atoi(request + sizeof("remove_server"));
-
-			loader_remove_server(main_server, server_id);
-		} else {
-			DIE(1, "unknown function call");
+			break;
+		case COMMAND_REMOVE_SERVER:
+			flush_batch(main_server, batch, &output);
+			loader_remove_server(main_server, request.server_id);
+			break;
 		}
 	}
 
-	free_load_balancer(main_server);
+	flush_batch(main_server, batch, &output);
+	free(batch);
+	free_output_writer(&output);
+}
+
+// function which prints the usage of the program
+void print_usage(char* program) {
+	printf("Usage:%s [--flat] [--batch] [--maglev | --jump | --rendezvous] "
+		   "[--bounded] [--replicas N [--least-loaded]] [--cache N] "
+		   "[--restore snapshot] [--save snapshot] "
+		   "[--wal log [--wal-sync none|group|always]] input_file \n",
+		   program);
 }
 
 // in main, get data from file given as command line parameter
 int main(int argc, char* argv[]) {
-	FILE *input;
-
-	if (argc != 2) {
-		printf("Usage:%s input_file \n", argv[0]);
+	command_file input;
+	load_balancer_config config;
+	default_load_balancer_config(&config);
+	int batched = 0;
+	char* restore_path = NULL;
+	char* save_path = NULL;
+
+	if (argc < 2) {
+		print_usage(argv[0]);
 		return -1;
 	}
 
-	input = fopen(argv[1], "rt");
-	DIE(input == NULL, "missing input file");
+	// the options are given before the input file
+	for (int i = 1; i < argc - 1; i++) {
+		if (!strcmp(argv[i], "--flat")) {
+			config.backend = SERVER_BACKEND_FLAT;
+		} else if (!strcmp(argv[i], "--batch")) {
+			batched = 1;
+		} else if (!strcmp(argv[i], "--maglev")) {
+			config.routing = ROUTING_MAGLEV;
+		} else if (!strcmp(argv[i], "--jump")) {
+			config.routing = ROUTING_JUMP;
+		} else if (!strcmp(argv[i], "--rendezvous")) {
+			config.routing = ROUTING_RENDEZVOUS;
+		} else if (!strcmp(argv[i], "--bounded")) {
+			config.bounded_loads = 1;
+		} else if (!strcmp(argv[i], "--replicas") && i + 2 < argc) {
+			config.replication_factor = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--least-loaded")) {
+			config.replica_reads = REPLICA_READ_LEAST_LOADED;
+		} else if (!strcmp(argv[i], "--cache") && i + 2 < argc) {
+			config.front_cache_size = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--restore") && i + 2 < argc) {
+			restore_path = argv[++i];
+		} else if (!strcmp(argv[i], "--save") && i + 2 < argc) {
+			save_path = argv[++i];
+		} else if (!strcmp(argv[i], "--wal") && i + 2 < argc) {
+			default_wal_config(&config.wal, argv[++i]);
+		} else if (!strcmp(argv[i], "--wal-sync") && i + 2 < argc &&
+				   config.wal.path != NULL) {
+			char* policy = argv[++i];
+			if (!strcmp(policy, "none")) {
+				config.wal.sync = WAL_SYNC_NONE;
+			} else if (!strcmp(policy, "always")) {
+				config.wal.sync = WAL_SYNC_ALWAYS;
+			} else if (strcmp(policy, "group")) {
+				print_usage(argv[0]);
+				return -1;
+			}
+		} else {
+			print_usage(argv[0]);
+			return -1;
+		}
+	}
 
-	apply_requests(input);
+	open_command_file(&input, argv[argc - 1]);
 
-	fclose(input);
+	// a restored load balancer starts with the servers and objects of
+	// its snapshot, without replaying the commands which created them;
+	// the operations of its write-ahead log are applied on top of it
+	load_balancer* main_server = restore_path || config.wal.path ?
+		loader_recover(&config, restore_path) :
+		init_load_balancer_config(&config);
+
+	apply_requests(&input, main_server, batched);
+
+	if (save_path != NULL)
+		loader_save_snapshot(main_server, save_path);
+	free_load_balancer(main_server);
+	close_command_file(&input);
 
 	return 0;
 }
@@ -0,0 +1,59 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the read-copy-update scheme which lets
+// threads read the hashring without locking it
+
+#include <sched.h>
+
+#include "rcu.h"
+
+// stripe used by the current thread, chosen on its first read section
+static _Thread_local int rcu_thread_stripe = -1;
+static atomic_uint rcu_next_stripe;
+
+// function which initialises the reader counters
+void rcu_init(rcu* state) {
+	for (int i = 0; i < RCU_STRIPES; i++) {
+		atomic_init(&state->stripes[i].readers[0], 0);
+		atomic_init(&state->stripes[i].readers[1], 0);
+	}
+	atomic_init(&state->epoch, 0);
+}
+
+// function which enters a read section and returns its token
+unsigned int rcu_read_lock(rcu* state) {
+	if (rcu_thread_stripe < 0)
+		rcu_thread_stripe = atomic_fetch_add(&rcu_next_stripe, 1) %
+							RCU_STRIPES;
+
+	// the data is read after the counter is incremented; if the epoch
+	// switches meanwhile, the reader already sees the new version
+	unsigned int epoch = atomic_load(&state->epoch);
+	atomic_fetch_add(&state->stripes[rcu_thread_stripe].readers[epoch], 1);
+
+	return 2 * rcu_thread_stripe + epoch;
+}
+
+// function which leaves the read section of the given token
+void rcu_read_unlock(rcu* state, unsigned int token) {
+	atomic_fetch_sub(&state->stripes[token / 2].readers[token % 2], 1);
+}
+
+// function which waits until the readers of the given epoch are finished
+void rcu_wait_readers(rcu* state, unsigned int epoch) {
+	for (int i = 0; i < RCU_STRIPES; i++) {
+		while (atomic_load(&state->stripes[i].readers[epoch]) != 0)
+			sched_yield();
+	}
+}
+
+// function which waits until the read sections started before the call
+// are finished
+void rcu_synchronize(rcu* state) {
+	// the epoch is switched twice: the new readers use the other counters,
+	// so each wait ends even if readers keep coming
+	for (int phase = 0; phase < 2; phase++) {
+		unsigned int epoch = atomic_load(&state->epoch);
+		atomic_store(&state->epoch, !epoch);
+		rcu_wait_readers(state, epoch);
+	}
+}
@@ -0,0 +1,56 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the read-copy-update
+// scheme which lets threads read the hashring without locking it
+
+#ifndef RCU_H_
+#define RCU_H_
+
+#include <stdatomic.h>
+
+#include "utils.h"
+
+// number of reader counters; each thread uses one of them, so the threads
+// don't write on the same cache line when they start reading
+#define RCU_STRIPES 64
+#define RCU_CACHE_LINE 64
+
+// pair of reader counters, one for each epoch
+typedef struct rcu_stripe rcu_stripe;
+struct rcu_stripe {
+	atomic_long readers[2];
+	char padding[RCU_CACHE_LINE - 2 * sizeof(atomic_long)];
+};
+
+// readers enter a read section by incrementing a counter of the current
+// epoch and leave it by decrementing the same counter; a writer which
+// published a new version of the data switches the epoch and waits for
+// the counters of the previous epoch to drop to zero, after which no
+// reader can still use the old version
+typedef struct rcu rcu;
+struct rcu {
+	rcu_stripe stripes[RCU_STRIPES];
+	atomic_uint epoch;
+};
+
+// function which initialises the reader counters
+void rcu_init(rcu* state);
+
+// rcu_read_lock() - Enters a read section.
+// @arg1: State shared by the readers and the writers.
+//
+// Return: The token which must be given to rcu_read_unlock. The read
+//         section never waits, not even for a writer.
+unsigned int rcu_read_lock(rcu* state);
+
+// function which leaves the read section of the given token
+void rcu_read_unlock(rcu* state, unsigned int token);
+
+// rcu_synchronize() - Waits until all the read sections which started
+// before the call are finished.
+// @arg1: State shared by the readers and the writers.
+//
+// A writer publishes the new version of the data, calls this function and
+// then frees the old version. The writers must not call it concurrently.
+void rcu_synchronize(rcu* state);
+
+#endif  // RCU_H_
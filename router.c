@@ -0,0 +1,359 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the strategies used for routing
+// the keys to the servers
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "router.h"
+
+// the capacities are powers of 2 of at least RENDEZVOUS_CHUNK, so the
+// rendezvous labels fill whole chunks
+#define ROUTER_INITIAL_CAPACITY 64
+// number of rendezvous scores computed by one pass of the scoring loop
+#define RENDEZVOUS_CHUNK 64
+
+// function which mixes the bits of a 32-bit value; the key hashes are
+// already well mixed (key_hash64 folded to 32 bits), but the server ids
+// of the maglev permutations are small consecutive numbers, and the keys
+// keep going through it so that their routes match the saved snapshots
+unsigned int router_mix(unsigned int hash) {
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+// function which returns a copy of an array of unsigned integers
+unsigned int* copy_array(unsigned int* array, unsigned int capacity) {
+	if (array == NULL)
+		return NULL;
+
+	unsigned int* copy = malloc(capacity * sizeof(unsigned int));
+	DIE(copy == NULL, "Error");
+	memcpy(copy, array, capacity * sizeof(unsigned int));
+
+	return copy;
+}
+
+// function which makes room for one more element in an array, or in two
+// arrays which have the same capacity (second may be NULL)
+void grow_arrays(unsigned int** first, unsigned int** second,
+				 unsigned int size, unsigned int* capacity) {
+	if (*first != NULL && size < *capacity)
+		return;
+
+	*capacity = *capacity ? 2 * *capacity : ROUTER_INITIAL_CAPACITY;
+	*first = realloc(*first, *capacity * sizeof(unsigned int));
+	DIE(*first == NULL, "Error");
+	if (second != NULL) {
+		*second = realloc(*second, *capacity * sizeof(unsigned int));
+		DIE(*second == NULL, "Error");
+	}
+}
+
+// function which initialises and returns a router without servers
+router* create_router(routing_strategy strategy) {
+	router* routes = calloc(1, sizeof(router));
+	DIE(routes == NULL, "Error");
+
+	routes->strategy = strategy;
+	if (strategy == ROUTING_RING)
+		routes->ring = create_hashring();
+
+	return routes;
+}
+
+// function which returns a copy of the router
+router* copy_router(router* routes) {
+	router* copy = malloc(sizeof(router));
+	DIE(copy == NULL, "Error");
+
+	*copy = *routes;
+	if (routes->ring != NULL)
+		copy->ring = copy_hashring(routes->ring);
+	copy->server_ids = copy_array(routes->server_ids,
+								  routes->servers_capacity);
+	copy->weights = copy_array(routes->weights, routes->servers_capacity);
+	copy->table = copy_array(routes->table, routes->table_size);
+	copy->buckets = copy_array(routes->buckets, routes->buckets_capacity);
+	copy->seeds = copy_array(routes->seeds, routes->seeds_capacity);
+	copy->seed_servers = copy_array(routes->seed_servers,
+									routes->seeds_capacity);
+
+	return copy;
+}
+
+// function which returns the Maglev server of a key hash
+unsigned int maglev_route(router* routes, unsigned int key_hash) {
+	return routes->table[router_mix(key_hash) % routes->table_size];
+}
+
+// function which returns the jump consistent hash bucket of a key
+// (Lamping and Veach, "A Fast, Minimal Memory, Consistent Hash Algorithm")
+unsigned int jump_bucket(unsigned long long key, unsigned int no_buckets) {
+	long long bucket = -1, next = 0;
+
+	while (next < no_buckets) {
+		bucket = next;
+		key = key * 2862933555777941757ULL + 1;
+		next = (bucket + 1) * ((double)(1LL << 31) /
+							   (double)((key >> 33) + 1));
+	}
+
+	return bucket;
+}
+
+// function which returns the rendezvous server of a key hash: the server
+// of the label with the highest score for the key
+unsigned int rendezvous_route(router* routes, unsigned int key_hash) {
+	unsigned int key = router_mix(key_hash);
+	unsigned int scores[RENDEZVOUS_CHUNK];
+	unsigned int best_score = 0, best = 0;
+
+	for (unsigned int start = 0; start < routes->no_seeds;
+		 start += RENDEZVOUS_CHUNK) {
+		unsigned int count = routes->no_seeds - start < RENDEZVOUS_CHUNK ?
+							 routes->no_seeds - start : RENDEZVOUS_CHUNK;
+		unsigned int* seeds = routes->seeds + start;
+
+		// the scores of a whole chunk are computed without branches or
+		// multiplications (Jenkins' 6-shift integer hash), so the compiler
+		// vectorizes this loop even for the baseline x86-64 instruction
+		// set; the unused labels of the last chunk are zero
+		for (unsigned int i = 0; i < RENDEZVOUS_CHUNK; i++) {
+			unsigned int score = seeds[i] ^ key;
+			score = (score + 0x7ed55d16) + (score << 12);
+			score = (score ^ 0xc761c23c) ^ (score >> 19);
+			score = (score + 0x165667b1) + (score << 5);
+			score = (score + 0xd3a2646c) ^ (score << 9);
+			score = (score + 0xfd7046c5) + (score << 3);
+			score = (score ^ 0xb55a4f09) ^ (score >> 16);
+			scores[i] = score;
+		}
+
+		for (unsigned int i = 0; i < count; i++) {
+			if (scores[i] > best_score || start + i == 0) {
+				best_score = scores[i];
+				best = start + i;
+			}
+		}
+	}
+
+	return routes->seed_servers[best];
+}
+
+// function which returns the id of the server which owns a key hash
+unsigned int router_route(router* routes, unsigned int key_hash) {
+	switch (routes->strategy) {
+	case ROUTING_MAGLEV:
+		return maglev_route(routes, key_hash);
+	case ROUTING_JUMP: {
+		unsigned long long key = ((unsigned long long)router_mix(key_hash)
+								  << 32) | key_hash;
+		return routes->buckets[jump_bucket(key, routes->no_buckets)];
+	}
+	case ROUTING_RENDEZVOUS:
+		return rendezvous_route(routes, key_hash);
+	default: {
+		hashring* ring = routes->ring;
+		return ring->labels[hashring_key_position(ring, key_hash)].server_id;
+	}
+	}
+}
+
+// function which fills the Maglev lookup table: each server walks its
+// own permutation of the table and takes the first free entries, weight
+// entries per round, until the table is full
+void maglev_build(router* routes) {
+	unsigned int sizes[] = MAGLEV_TABLE_SIZES;
+	unsigned int no_sizes = sizeof(sizes) / sizeof(unsigned int);
+	unsigned long long labels = 0;
+
+	for (unsigned int i = 0; i < routes->no_servers; i++)
+		labels += routes->weights[i];
+
+	// the table is large enough for each server to get entries close
+	// to its share
+	unsigned int size = sizes[no_sizes - 1];
+	for (unsigned int i = 0; i < no_sizes; i++) {
+		if (sizes[i] >= labels * MAGLEV_ENTRIES_PER_LABEL) {
+			size = sizes[i];
+			break;
+		}
+	}
+
+	free(routes->table);
+	routes->table = NULL;
+	routes->table_size = 0;
+	if (routes->no_servers == 0)
+		return;
+
+	routes->table_size = size;
+	routes->table = malloc(size * sizeof(unsigned int));
+	DIE(routes->table == NULL, "Error");
+	memset(routes->table, 0xff, size * sizeof(unsigned int));
+
+	// the permutation of a server visits the entries offset, offset + skip,
+	// offset + 2 * skip, ... (modulo the size, which is prime)
+	unsigned int* next = malloc(routes->no_servers * sizeof(unsigned int));
+	unsigned int* skip = malloc(routes->no_servers * sizeof(unsigned int));
+	DIE(next == NULL || skip == NULL, "Error");
+	for (unsigned int i = 0; i < routes->no_servers; i++) {
+		next[i] = router_mix(routes->server_ids[i]) % size;
+		skip[i] = router_mix(routes->server_ids[i] ^ 0x5bd1e995) %
+				  (size - 1) + 1;
+	}
+
+	unsigned int filled = 0;
+	while (filled < size) {
+		for (unsigned int i = 0; i < routes->no_servers && filled < size;
+			 i++) {
+			for (unsigned int w = 0; w < routes->weights[i] && filled < size;
+				 w++) {
+				unsigned int entry;
+				do {
+					entry = next[i];
+					next[i] += skip[i];
+					if (next[i] >= size)
+						next[i] -= size;
+				} while (routes->table[entry] != UINT_MAX);
+
+				routes->table[entry] = routes->server_ids[i];
+				filled++;
+			}
+		}
+	}
+
+	free(next);
+	free(skip);
+}
+
+// function which rebuilds the rendezvous labels from the list of servers
+void rendezvous_build(router* routes) {
+	routes->no_seeds = 0;
+
+	for (unsigned int i = 0; i < routes->no_servers; i++) {
+		for (unsigned int replica = 0; replica < routes->weights[i];
+			 replica++) {
+			grow_arrays(&routes->seeds, &routes->seed_servers,
+						routes->no_seeds, &routes->seeds_capacity);
+
+			routes->seeds[routes->no_seeds] =
+				hash_function_label(routes->server_ids[i], replica);
+			routes->seed_servers[routes->no_seeds] = routes->server_ids[i];
+			routes->no_seeds++;
+		}
+	}
+
+	if (routes->seeds != NULL)
+		memset(routes->seeds + routes->no_seeds, 0,
+			   (routes->seeds_capacity - routes->no_seeds) *
+			   sizeof(unsigned int));
+}
+
+// function which adds a server on the router
+void router_add_server(router* routes, unsigned int server_id,
+					   unsigned int weight) {
+	if (routes->strategy == ROUTING_RING) {
+		hashring_add_server(routes->ring, server_id, weight);
+		return;
+	}
+
+	grow_arrays(&routes->server_ids, &routes->weights, routes->no_servers,
+				&routes->servers_capacity);
+	routes->server_ids[routes->no_servers] = server_id;
+	routes->weights[routes->no_servers] = weight;
+	routes->no_servers++;
+
+	if (routes->strategy == ROUTING_MAGLEV) {
+		maglev_build(routes);
+	} else if (routes->strategy == ROUTING_RENDEZVOUS) {
+		rendezvous_build(routes);
+	} else {
+		// the new buckets are added at the end, so only the keys which
+		// move on them change their bucket
+		for (unsigned int i = 0; i < weight; i++) {
+			grow_arrays(&routes->buckets, NULL, routes->no_buckets,
+						&routes->buckets_capacity);
+			routes->buckets[routes->no_buckets++] = server_id;
+		}
+	}
+}
+
+// function which removes a server from the router
+void router_remove_server(router* routes, unsigned int server_id) {
+	if (routes->strategy == ROUTING_RING) {
+		hashring_remove_server(routes->ring, server_id);
+		return;
+	}
+
+	for (unsigned int i = 0; i < routes->no_servers; i++) {
+		if (routes->server_ids[i] != server_id)
+			continue;
+
+		memmove(&routes->server_ids[i], &routes->server_ids[i + 1],
+				(routes->no_servers - i - 1) * sizeof(unsigned int));
+		memmove(&routes->weights[i], &routes->weights[i + 1],
+				(routes->no_servers - i - 1) * sizeof(unsigned int));
+		routes->no_servers--;
+		break;
+	}
+
+	if (routes->strategy == ROUTING_MAGLEV) {
+		maglev_build(routes);
+	} else if (routes->strategy == ROUTING_RENDEZVOUS) {
+		rendezvous_build(routes);
+	} else {
+		// jump hash can only remove the last bucket, so each bucket of
+		// the server is replaced by the last bucket
+		for (int i = routes->no_buckets - 1; i >= 0; i--) {
+			if (routes->buckets[i] == server_id)
+				routes->buckets[i] = routes->buckets[--routes->no_buckets];
+		}
+	}
+}
+
+// function which returns the number of servers of the router
+unsigned int router_no_servers(router* routes) {
+	if (routes->strategy != ROUTING_RING)
+		return routes->no_servers;
+
+	// each server has a label with replica 0
+	unsigned int no_servers = 0;
+	for (unsigned int i = 0; i < routes->ring->size; i++)
+		no_servers += routes->ring->labels[i].replica == 0;
+
+	return no_servers;
+}
+
+// function which returns the number of bytes used by the router
+size_t router_bytes(router* routes) {
+	size_t bytes = sizeof(router);
+
+	if (routes->ring != NULL)
+		bytes += sizeof(hashring) +
+				 routes->ring->capacity * sizeof(hashring_label);
+	bytes += 2 * routes->servers_capacity * sizeof(unsigned int);
+	bytes += routes->table_size * sizeof(unsigned int);
+	bytes += routes->buckets_capacity * sizeof(unsigned int);
+	bytes += 2 * routes->seeds_capacity * sizeof(unsigned int);
+
+	return bytes;
+}
+
+// function which frees the memory of the router
+void free_router(router* routes) {
+	if (routes->ring != NULL)
+		free_hashring(routes->ring);
+	free(routes->server_ids);
+	free(routes->weights);
+	free(routes->table);
+	free(routes->buckets);
+	free(routes->seeds);
+	free(routes->seed_servers);
+	free(routes);
+}
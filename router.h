@@ -0,0 +1,94 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the strategies used
+// for routing the keys to the servers
+
+#ifndef ROUTER_H_
+#define ROUTER_H_
+
+#include "hashring.h"
+#include "utils.h"
+
+// strategy used for choosing the server of a key
+typedef enum routing_strategy {
+	// consistent hashing on the hashring of server labels; O(log labels)
+	// lookups, only the neighbours of a changed server move keys
+	ROUTING_RING,
+	// Maglev lookup table; O(1) lookups, the table is rebuilt when the
+	// servers change
+	ROUTING_MAGLEV,
+	// jump consistent hash over an array of buckets; O(log buckets)
+	// lookups with almost no memory
+	ROUTING_JUMP,
+	// rendezvous (highest random weight) hashing; O(labels) lookups,
+	// only the keys of a changed server move
+	ROUTING_RENDEZVOUS
+} routing_strategy;
+
+// sizes of the Maglev lookup table; the table has at least
+// MAGLEV_ENTRIES_PER_LABEL entries for each label, up to the last size
+#define MAGLEV_TABLE_SIZES {65537, 524309, 4194319, 16777259}
+#define MAGLEV_ENTRIES_PER_LABEL 100
+
+// data structure which finds the server of a key hash; the servers have
+// weights, given as their number of labels (virtual nodes)
+typedef struct router router;
+struct router {
+	routing_strategy strategy;
+	// hashring of server labels, used by ROUTING_RING
+	hashring* ring;
+	// ids of the servers and their weights, used by the other strategies
+	unsigned int* server_ids;
+	unsigned int* weights;
+	unsigned int no_servers;
+	unsigned int servers_capacity;
+	// lookup table of ROUTING_MAGLEV; table[i] is the server id
+	// of the keys whose hash is i modulo table_size
+	unsigned int* table;
+	unsigned int table_size;
+	// buckets of ROUTING_JUMP; each server has weight buckets
+	unsigned int* buckets;
+	unsigned int no_buckets;
+	unsigned int buckets_capacity;
+	// labels of ROUTING_RENDEZVOUS, stored as separate arrays so the
+	// scoring loop reads them contiguously; seeds[i] is the hash of
+	// the label and seed_servers[i] is the id of its server
+	unsigned int* seeds;
+	unsigned int* seed_servers;
+	unsigned int no_seeds;
+	unsigned int seeds_capacity;
+};
+
+// function which initialises and returns a router without servers
+router* create_router(routing_strategy strategy);
+
+// function which returns a copy of the router, which can be changed
+// while the original is still read by other threads
+router* copy_router(router* routes);
+
+// router_route() - Finds the server of a key.
+// @arg1: Router which has at least one server.
+// @arg2: Hash of the key, given by hash_function_key.
+//
+// Return: The id of the server which owns the key.
+unsigned int router_route(router* routes, unsigned int key_hash);
+
+// router_add_server() - Adds a server.
+// @arg1: Router on which the server is added.
+// @arg2: ID of the server.
+// @arg3: Weight of the server, as its number of labels.
+void router_add_server(router* routes, unsigned int server_id,
+					   unsigned int weight);
+
+// function which removes a server from the router
+void router_remove_server(router* routes, unsigned int server_id);
+
+// function which returns the number of servers of the router
+unsigned int router_no_servers(router* routes);
+
+// function which returns the number of bytes used by the router
+size_t router_bytes(router* routes);
+
+// function which frees the memory of the router
+void free_router(router* routes);
+
+#endif  // ROUTER_H_
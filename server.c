@@ -3,166 +3,1279 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include "server.h"
 
-// hash function used for hashing the key values
-unsigned int hash_function_key(void *a) {
-    unsigned char *puchar_a = (unsigned char *) a;
-    unsigned int hash = 5381;
-    int c;
+// block allocated from the server's arena for each stored pair: the
+// links of its bucket, the key-value pair, the hash of the key and its
+// length, so the key is never hashed again
+struct server_entry {
+	INTRUSIVE_LINK(server_entry) link;
+	key_value_pair pair;
+	unsigned int hash;
+	// length of the key and 1 if the pair was used since the eviction
+	// hand last passed over it
+	unsigned int key_length : 30;
+	unsigned int referenced : 1;
+	// 1 if the value is packed by the value codec
+	unsigned int packed : 1;
+	// time (in ms) at which the pair expires, or 0 if it never expires
+	unsigned long long deadline;
+};
 
-    while ((c = *puchar_a++))
-        hash = ((hash << 5u) + hash) + c;
+// function which returns 1 if the entry stores the given key; the key
+// bytes are compared only when the hash and the length match
+static inline int entry_matches(const server_entry* entry,
+								key_descriptor* key) {
+	return entry->hash == key->hash && entry->key_length == key->length &&
+		   memcmp(entry->pair.key, key->key, key->length) == 0;
+}
+
+INTRUSIVE_LIST_FUNCTIONS(entry_list, server_entry, link, key_descriptor*,
+						 entry_matches)
+
+// function which returns the number of bytes used by a stored pair:
+// its key, its value and the metadata the server keeps for it
+size_t server_entry_bytes(server_memory* server, size_t key_size,
+						  size_t value_size) {
+	if (server->backend == SERVER_BACKEND_FLAT) {
+		size_t bytes = sizeof(flat_meta) + sizeof(flat_slot) + value_size;
+		// short keys are stored inside the slot
+		if (key_size > KEY_LENGTH)
+			bytes += key_size;
+		return bytes;
+	}
+
+	return sizeof(server_entry) + key_size + value_size;
+}
+
+// function which allocates an array of hmax empty buckets (a list
+// filled with zeros is empty)
+entry_list* create_buckets(unsigned int hmax) {
+	entry_list* buckets = calloc(hmax, sizeof(entry_list));
+	DIE(buckets == NULL, "Error");
+
+	return buckets;
+}
 
-    return hash;
+// function which frees an array of buckets; the entries are owned by
+// the server's arena, so they are not visited
+void free_buckets(entry_list* buckets) {
+	free(buckets);
 }
 
 // function which initialises the server memory, which is a hashtable,
 // and returns the newly created server
 server_memory* init_server_memory() {
+	return init_server_memory_backend(SERVER_BACKEND_CHAINED);
+}
+
+// function which initialises the server memory using the given backend
+// and returns the newly created server
+server_memory* init_server_memory_backend(server_backend backend) {
 	// allocate memory for the hashtable
 	server_memory *server = malloc(sizeof(server_memory));
 	DIE(server == NULL, "Error");
 
 	// initialise hashtable metadata
+	server->backend = backend;
 	server->hmax = HMAX;
 	server->size = 0;
+	server->bytes_used = 0;
+	server->buckets = NULL;
+	server->old_buckets = NULL;
+	server->old_hmax = 0;
+	server->rehash_index = 0;
+	server->flat = NULL;
+	server->pool = create_arena();
+	server->ring_index = create_hash_index();
+	server->filter = create_key_filter();
+	server->snapshot = NULL;
+	server->snapshot_base = NULL;
+	server->wheel = NULL;
+	server->clock = monotonic_ms;
+	server->now = 0;
+	server->expired = 0;
+	server->expiring = 0;
+	server->budget = 0;
+	server->evict_hand = 0;
+	server->evicted = 0;
+	server->pack_threshold = 0;
+	server->codec_buffer = NULL;
+	server->packed = 0;
+	server->packed_bytes = 0;
+	server->unpacked_bytes = 0;
+	pthread_mutex_init(&server->lock, NULL);
 
-	// allocate memory for the array of cdlls
-	server->buckets = calloc(HMAX, sizeof(cdll_list*));
-	DIE(server->buckets == NULL, "Error");
+	if (backend == SERVER_BACKEND_FLAT) {
+		server->flat = create_flat_table(FLAT_INITIAL_CAPACITY, server->pool);
+		return server;
+	}
 
-	// create each cdll for each of the array's elements
-	for (int i = 0; i < (int)server->hmax; i++)
-		server->buckets[i] = create_list(sizeof(key_value_pair));
+	// allocate memory for the array of buckets
+	server->buckets = create_buckets(server->hmax);
 
 	return server;
 }
 
+// function which moves the next REHASH_STEP buckets of the old array
+// in the current array of buckets; when all of them were moved,
+// the old array is freed
+void server_rehash_step(server_memory* server) {
+	if (server->old_buckets == NULL)
+		return;
+
+	for (int step = 0; step < REHASH_STEP &&
+		 server->rehash_index < server->old_hmax; step++) {
+		entry_list* old_bucket = &server->old_buckets[server->rehash_index];
+
+		// move each entry in its new bucket, without copying it
+		while (old_bucket->size > 0) {
+			server_entry* entry = entry_list_pop_front(old_bucket);
+			unsigned int index = entry->hash & (server->hmax - 1);
+			entry_list_push_back(&server->buckets[index], entry);
+		}
+		server->rehash_index++;
+	}
+
+	if (server->rehash_index == server->old_hmax) {
+		free_buckets(server->old_buckets);
+		server->old_buckets = NULL;
+		server->old_hmax = 0;
+		server->rehash_index = 0;
+	}
+}
+
+// function which checks the load factor of the server and, if needed,
+// starts rehashing its buckets in an array twice as large (or half as
+// large); the entries are moved over the next operations, REHASH_STEP
+// buckets at a time, so no single operation has to move all of them
+void server_check_resize(server_memory* server) {
+	unsigned int new_hmax;
+
+	// only one rehash can be done at a time
+	if (server->old_buckets != NULL)
+		return;
+
+	if (server->size > server->hmax * MAX_LOAD_FACTOR)
+		new_hmax = 2 * server->hmax;
+	else if (server->hmax > HMAX &&
+			 server->size * MIN_LOAD_FACTOR_DIVISOR < server->hmax)
+		new_hmax = server->hmax / 2;
+	else
+		return;
+
+	server->old_buckets = server->buckets;
+	server->old_hmax = server->hmax;
+	server->rehash_index = 0;
+	server->buckets = create_buckets(new_hmax);
+	server->hmax = new_hmax;
+}
+
+// function which returns the bucket in which a key with the given hash
+// is stored; while rehashing, the keys of the buckets which were not
+// moved yet are still found in the old array
+entry_list* server_bucket(server_memory* server, unsigned int hash) {
+	if (server->old_buckets != NULL) {
+		unsigned int old_index = hash & (server->old_hmax - 1);
+		if (old_index >= server->rehash_index)
+			return &server->old_buckets[old_index];
+	}
+
+	return &server->buckets[hash & (server->hmax - 1)];
+}
+
+// function which adds the hash of a new key to the ring index and to
+// the filter of the server
+void server_index_insert(server_memory* server, unsigned int hash) {
+	hash_index_insert(server->ring_index, hash);
+	key_filter_add(server->filter, hash);
+	key_filter_fit(server->filter, server->ring_index);
+}
+
+// function which removes the hash of a removed key from the ring index
+// and from the filter of the server
+void server_index_remove(server_memory* server, unsigned int hash) {
+	hash_index_remove(server->ring_index, hash);
+	key_filter_remove(server->filter, hash);
+	key_filter_fit(server->filter, server->ring_index);
+}
+
 // function which stores a key-value pair in the server memory
 void server_store(server_memory* server, char* key, char* value) {
-	// calculate the hash value of the key modulo bucket size
-	unsigned int hash_value = hash_function_key(key) % server->hmax;
+	key_descriptor descriptor;
+	key_descriptor_init(&descriptor, key);
+	server_store_key(server, &descriptor, value);
+}
 
-	int key_size = strlen(key) + 1;
-	int value_size = strlen(value) + 1;
+// function which adds the timer of a pair with a deadline; the wheel is
+// created with the first timer of the server
+void server_add_timer(server_memory* server, unsigned int hash,
+					  unsigned long long deadline) {
+	if (server->wheel == NULL) {
+		server->wheel = create_timing_wheel();
+		server->wheel->current = server->clock();
+	}
 
-	// iterate through the bucket list linked to the hash value of the key
-	// check if the key already exists; if so, renew its value
-	cdll_node* current = server->buckets[hash_value]->head;
-
-	for (int i = 0; i < (int)server->buckets[hash_value]->size; i++) {
-		// compare the given key with the key in the bucket
-		if (strncmp(((key_value_pair*)(current->data))->key,
-			key, strlen(key)) == 0) {
-			memcpy(((key_value_pair*)(current->data))->
-					value, value, value_size);
+	timing_wheel_add(server->wheel, hash, deadline);
+}
+
+// function which checks if a deadline passed at the time of the last
+// expiry of the server
+int server_deadline_passed(server_memory* server,
+						   unsigned long long deadline) {
+	return deadline != 0 && deadline <= server->now;
+}
+
+// function which stores a key-value pair whose key was already hashed
+void server_store_key(server_memory* server, key_descriptor* key,
+					  char* value) {
+	server_store_key_deadline(server, key, value, 0);
+}
+
+// function which returns the codec buffer of the server, allocating it
+// the first time it is needed
+char* server_codec_buffer(server_memory* server) {
+	if (server->codec_buffer == NULL) {
+		server->codec_buffer = malloc(VALUE_LENGTH);
+		DIE(server->codec_buffer == NULL, "Error");
+	}
+
+	return server->codec_buffer;
+}
+
+// function which counts a stored value in the packed values of the
+// server (difference 1) or takes it out of them (difference -1)
+void server_count_packed(server_memory* server, char* value, int packed,
+						 int difference) {
+	if (!packed)
+		return;
+
+	size_t length = codec_length(value) + 1;
+	server->packed += difference;
+	server->packed_bytes += difference * codec_stored_size(value, 1);
+	server->unpacked_bytes += difference * length;
+}
+
+// function which returns a value as a string: a packed value is unpacked
+// in the codec buffer of the server
+char* server_unpacked_value(server_memory* server, char* value,
+							int packed) {
+	if (!packed)
+		return value;
+
+	char* buffer = server_codec_buffer(server);
+	codec_unpack(value, buffer);
+	return buffer;
+}
+
+// function which packs a value which is long enough in the codec buffer
+// of the server; it returns the value which is stored and fills its size
+// and whether it is packed
+char* server_pack_value(server_memory* server, char* value,
+						unsigned int* value_size, int* packed) {
+	unsigned int length = strlen(value);
+	*value_size = length + 1;
+	*packed = 0;
+
+	// a value unpacked in the codec buffer (by a retrieve) is stored
+	// again as it is
+	if (server->pack_threshold == 0 || length < server->pack_threshold ||
+		length >= VALUE_LENGTH || value == server->codec_buffer)
+		return value;
+
+	// the packed value must be smaller than the string
+	unsigned int size = codec_pack(value, length, server_codec_buffer(server),
+								   length);
+	if (size == 0)
+		return value;
+
+	*value_size = size;
+	*packed = 1;
+	return server->codec_buffer;
+}
+
+// function which stores a key-value pair which expires at the given
+// deadline (0 if it never expires), without evicting
+void server_store_pair(server_memory* server, key_descriptor* key,
+					   char* value, unsigned long long deadline) {
+	server_load_snapshot(server);
+	server_expire(server);
+
+	// the timer of a previous deadline of the key is left in the wheel;
+	// when it expires, it finds the key with a different deadline
+	if (deadline != 0)
+		server_add_timer(server, key->hash, deadline);
+
+	int key_size = key->length + 1;
+	unsigned int value_size;
+	int packed;
+	value = server_pack_value(server, value, &value_size, &packed);
+
+	if (server->backend == SERVER_BACKEND_FLAT) {
+		// if the key already exists, only the size of its value changes
+		flat_slot* slot = flat_table_find(server->flat, key);
+		if (slot) {
+			server->bytes_used += value_size -
+								  codec_stored_size(slot->value,
+													slot->packed);
+			server_count_packed(server, slot->value, slot->packed, -1);
+			flat_table_store(server->flat, key, value, value_size, packed);
+			server_count_packed(server, slot->value, packed, 1);
+			server->expiring += (deadline != 0) - (slot->deadline != 0);
+			slot->deadline = deadline;
 			return;
 		}
-		current = current->next;
+
+		server->bytes_used += server_entry_bytes(server, key_size,
+												 value_size);
+		server_index_insert(server, key->hash);
+		server->size++;
+		server_count_packed(server, value, packed, 1);
+		flat_table_store(server->flat, key, value, value_size, packed);
+		if (deadline != 0) {
+			flat_table_find(server->flat, key)->deadline = deadline;
+			server->expiring++;
+		}
+		return;
 	}
 
-	// if the key doesn't exist, create a new key_value_pair element
-	// and initialise its data with the given key and value
-	key_value_pair* new_entry = malloc(sizeof(key_value_pair));
-	DIE(new_entry == NULL, "Error");
+	server_rehash_step(server);
 
-	new_entry->key = malloc(key_size);
-	DIE(new_entry->key == NULL, "Error");
-	if(new_entry->key) {
-		memcpy(new_entry->key, key, key_size);
-	}
+	// get the bucket of the key
+	entry_list* bucket = server_bucket(server, key->hash);
 
-	new_entry->value = malloc(value_size);
-	DIE(new_entry->value == NULL, "Error");
-	if (new_entry->value) {
-		memcpy(new_entry->value, value, value_size);
+	// check if the key already exists; if so, renew its value
+	server_entry* entry = entry_list_find(bucket, key);
+	if (entry) {
+		// the new value may be longer than the old one
+		key_value_pair* pair = &entry->pair;
+		size_t old_value_size = codec_stored_size(pair->value,
+												  entry->packed);
+		server_count_packed(server, pair->value, entry->packed, -1);
+		pair->value = arena_realloc(server->pool, pair->value,
+									old_value_size, value_size);
+		memcpy(pair->value, value, value_size);
+		entry->packed = packed;
+		server_count_packed(server, value, packed, 1);
+		server->bytes_used += value_size - old_value_size;
+		server->expiring += (deadline != 0) - (entry->deadline != 0);
+		entry->deadline = deadline;
+		entry->referenced = 1;
+		return;
 	}
 
-	// add the newly created element to the bucket list
+	// if the key doesn't exist, allocate a new entry from the arena and
+	// initialise its pair with copies of the given key and value
+	server_entry* new_entry = arena_alloc(server->pool, sizeof(server_entry));
+	new_entry->pair.key = arena_copy(server->pool, key->key, key_size);
+	new_entry->pair.value = arena_copy(server->pool, value, value_size);
+	new_entry->hash = key->hash;
+	new_entry->key_length = key->length;
+	new_entry->deadline = deadline;
+	new_entry->referenced = 1;
+	new_entry->packed = packed;
+	server->expiring += (deadline != 0);
+	server_count_packed(server, value, packed, 1);
+
+	// add the newly created entry to the bucket list
 	// linked to the hash value of the key
-	add_node(server->buckets[hash_value], server->
-			buckets[hash_value]->size, new_entry);
+	entry_list_push_back(bucket, new_entry);
+	server_index_insert(server, key->hash);
 	server->size++;
-	free(new_entry);
+	server->bytes_used += server_entry_bytes(server, key_size, value_size);
+
+	server_check_resize(server);
+}
+
+// function which returns the key of the flat slot at which the eviction
+// hand stops: the hand clears the referenced slots it passes over
+void flat_evict_victim(server_memory* server, key_descriptor* key) {
+	flat_table* table = server->flat;
+
+	while (1) {
+		unsigned int index = server->evict_hand++ & (table->capacity - 1);
+		if (table->meta[index].distance == 0)
+			continue;
+
+		flat_slot* slot = &table->slots[index];
+		if (slot->referenced) {
+			slot->referenced = 0;
+			continue;
+		}
+
+		key->key = flat_slot_key(slot);
+		key->length = slot->key_length;
+		key->hash = table->meta[index].hash;
+		return;
+	}
+}
+
+// function which returns the key of the bucket entry at which the
+// eviction hand stops; the hand goes round the buckets by index, so a
+// rehash in progress is finished first
+void chained_evict_victim(server_memory* server, key_descriptor* key) {
+	while (server->old_buckets != NULL)
+		server_rehash_step(server);
+
+	while (1) {
+		entry_list* bucket = &server->buckets[server->evict_hand &
+											  (server->hmax - 1)];
+		for (server_entry* entry = bucket->head; entry != NULL;
+			 entry = entry_list_next(bucket, entry)) {
+			if (!entry->referenced) {
+				key->key = entry->pair.key;
+				key->length = entry->key_length;
+				key->hash = entry->hash;
+				return;
+			}
+			entry->referenced = 0;
+		}
+		server->evict_hand++;
+	}
+}
+
+// function which evicts pairs until the server is within its budget
+void server_evict(server_memory* server) {
+	if (server->budget == 0)
+		return;
+
+	while (server->bytes_used > server->budget && server->size > 0) {
+		key_descriptor key;
+		if (server->backend == SERVER_BACKEND_FLAT)
+			flat_evict_victim(server, &key);
+		else
+			chained_evict_victim(server, &key);
+
+		server_remove_key(server, &key);
+		server->evicted++;
+	}
+}
+
+// function which stores a key-value pair which expires at the given
+// deadline (0 if it never expires), evicting pairs if the server goes
+// above its budget
+void server_store_key_deadline(server_memory* server, key_descriptor* key,
+							   char* value, unsigned long long deadline) {
+	server_store_pair(server, key, value, deadline);
+	server_evict(server);
+}
+
+// function which limits the bytes used by the server, evicting pairs
+// until it is within the new budget
+void server_set_budget(server_memory* server, size_t budget) {
+	server_load_snapshot(server);
+	server->budget = budget;
+	server_evict(server);
+}
+
+// function which returns the deadline of a stored key, or 0 if the key
+// never expires
+unsigned long long server_key_deadline(server_memory* server,
+									   key_descriptor* key) {
+	if (server->snapshot != NULL)
+		return 0;
+
+	if (server->backend == SERVER_BACKEND_FLAT) {
+		flat_slot* slot = flat_table_find(server->flat, key);
+		return slot ? slot->deadline : 0;
+	}
+
+	server_entry* entry = entry_list_find(server_bucket(server, key->hash),
+										  key);
+	return entry ? entry->deadline : 0;
+}
+
+// arguments used for finding an expired slot of the flat backend
+typedef struct expired_args expired_args;
+struct expired_args {
+	server_memory* server;
+	flat_slot* slot;
+};
+
+// function called for each flat slot with the hash of an expired timer,
+// which keeps the first slot whose deadline passed
+void find_expired_slot(flat_slot* slot, void* arg) {
+	expired_args* args = arg;
+	if (args->slot == NULL &&
+		server_deadline_passed(args->server, slot->deadline))
+		args->slot = slot;
+}
+
+// function called for each expired timer, which removes the pairs with
+// its hash whose deadline passed; the timers of keys which were removed,
+// stored again with a later deadline or moved find nothing to remove
+void expire_hash(unsigned int hash, void* arg) {
+	server_memory* server = arg;
+	key_descriptor key;
+	key.hash = hash;
+
+	while (1) {
+		unsigned long long deadline = 0;
+		if (server->backend == SERVER_BACKEND_FLAT) {
+			expired_args args = {server, NULL};
+			flat_table_for_each_with_hash(server->flat, hash,
+										  find_expired_slot, &args);
+			if (args.slot != NULL) {
+				key.key = flat_slot_key(args.slot);
+				key.length = args.slot->key_length;
+				deadline = args.slot->deadline;
+			}
+		} else {
+			entry_list* bucket = server_bucket(server, hash);
+			for (server_entry* entry = bucket->head;
+				 entry != NULL && deadline == 0;
+				 entry = entry_list_next(bucket, entry)) {
+				if (entry->hash == hash &&
+					server_deadline_passed(server, entry->deadline)) {
+					key.key = entry->pair.key;
+					key.length = entry->key_length;
+					deadline = entry->deadline;
+				}
+			}
+		}
+
+		if (deadline == 0)
+			return;
+		server_remove_key(server, &key);
+		server->expired++;
+	}
+}
+
+// function which removes the pairs whose deadline passed, visiting only
+// the timers which expired since the last call
+void server_expire(server_memory* server) {
+	if (server->wheel == NULL || server->wheel->size == 0)
+		return;
+
+	// the timers left when no pair has a deadline anymore are dropped
+	if (server->expiring == 0) {
+		free_timing_wheel(server->wheel);
+		server->wheel = NULL;
+		return;
+	}
+
+	server->now = server->clock();
+	timing_wheel_advance(server->wheel, server->now, expire_hash, server);
 }
 
 // function which removes a key-value pair from the server, being given
 // only the key of the entry
 void server_remove(server_memory* server, char* key) {
-	// calculate the hash value of the key modulo bucket size
-	unsigned int hash_value = hash_function_key(key) % server->hmax;
-
-	// iterate through the bucket list linked to the hash value of the key
-	// in order to find the wanted key, get its position and remove the key
-	int position = 0;
-	cdll_node* current = server->buckets[hash_value]->head;
-
-	for (int i = 0; i < (int)server->buckets[hash_value]->size; i++) {
-		// compare the given key with the key in the bucket
-		if (strncmp(((key_value_pair*)(current->data))->key,
-			key, strlen(key)) == 0) {
-			cdll_node* removed = remove_node(server->buckets[hash_value],
-								 position);
-			// free the memory of the removed node
-			free(((key_value_pair*)(removed->data))->key);
-			free(((key_value_pair*)(removed->data))->value);
-			free(removed->data);
-			free(removed);
-			server->size--;
+	key_descriptor descriptor;
+	key_descriptor_init(&descriptor, key);
+	server_remove_key(server, &descriptor);
+}
+
+// function which removes a key-value pair whose key was already hashed
+void server_remove_key(server_memory* server, key_descriptor* key) {
+	server_load_snapshot(server);
+
+	// the servers which take moved keys rarely have an older copy of them
+	if (!key_filter_may_contain(server->filter, key->hash))
+		return;
+
+	if (server->backend == SERVER_BACKEND_FLAT) {
+		flat_slot* slot = flat_table_find(server->flat, key);
+		if (slot == NULL)
 			return;
-		}
-		position++;
-		current = current->next;
+
+		size_t value_size = codec_stored_size(slot->value, slot->packed);
+		server->bytes_used -= server_entry_bytes(server, slot->key_length + 1,
+												 value_size);
+		server->expiring -= (slot->deadline != 0);
+		server_count_packed(server, slot->value, slot->packed, -1);
+		flat_table_remove(server->flat, key);
+		server_index_remove(server, key->hash);
+		server->size--;
+		return;
 	}
+
+	server_rehash_step(server);
+
+	// get the bucket of the key
+	entry_list* bucket = server_bucket(server, key->hash);
+
+	// find the wanted key and unlink its entry
+	server_entry* removed = entry_list_find(bucket, key);
+	if (removed == NULL)
+		return;
+	entry_list_remove(bucket, removed);
+
+	// give the memory of the removed entry back to the arena
+	key_value_pair* pair = &removed->pair;
+	int packed = removed->packed;
+	int key_size = key->length + 1;
+	int value_size = codec_stored_size(pair->value, packed);
+	server_count_packed(server, pair->value, packed, -1);
+	arena_free(server->pool, pair->key, key_size);
+	arena_free(server->pool, pair->value, value_size);
+	server->expiring -= (removed->deadline != 0);
+	arena_free(server->pool, removed, sizeof(server_entry));
+	server_index_remove(server, key->hash);
+	server->size--;
+	server->bytes_used -= server_entry_bytes(server, key_size, value_size);
+
+	server_check_resize(server);
 }
 
 // function which looks for the value stored at a given key
 // and if found, returns it
 char* server_retrieve(server_memory* server, char* key) {
-	// calculate the hash value of the key modulo bucket size
-	unsigned int hash_value = hash_function_key(key) % server->hmax;
+	key_descriptor descriptor;
+	key_descriptor_init(&descriptor, key);
+	return server_retrieve_key(server, &descriptor);
+}
+
+// function which looks for the stored value of a key which was already
+// hashed and fills whether it is packed
+char* server_find_value(server_memory* server, key_descriptor* key,
+						int* packed) {
+	*packed = 0;
+	if (server->snapshot != NULL) {
+		const snapshot_slot* slot = snapshot_find(server->snapshot_base,
+												  server->snapshot, key);
+		return slot ? snapshot_slot_value(server->snapshot_base, slot) : NULL;
+	}
+
+	// most of the missing keys are found missing by the filter, which
+	// reads a single cache line
+	if (!key_filter_may_contain(server->filter, key->hash)) {
+		server->filter->negatives++;
+		return NULL;
+	}
 
-	// iterate through the bucket list linked to the hash value of the key
-	// in order to find the key
-	// if found, the value stored is returned
-	cdll_node* current = server->buckets[hash_value]->head;
+	server_expire(server);
 
-	for (int i = 0; i < (int)server->buckets[hash_value]->size; i++) {
-		// compare the given key with the key in the bucket
-		if (strncmp(((key_value_pair*)(current->data))->key,
-			key, strlen(key)) == 0) {
-			return ((key_value_pair*)(current->data))->value;
+	char* value = NULL;
+	unsigned long long deadline = 0;
+	if (server->backend == SERVER_BACKEND_FLAT) {
+		flat_slot* slot = flat_table_find(server->flat, key);
+		if (slot) {
+			value = slot->value;
+			deadline = slot->deadline;
+			*packed = slot->packed;
+			slot->referenced = 1;
+		}
+	} else {
+		// get the bucket of the key; if found, the value stored is returned
+		server_entry* entry = entry_list_find(server_bucket(server,
+															key->hash), key);
+		if (entry) {
+			value = entry->pair.value;
+			deadline = entry->deadline;
+			*packed = entry->packed;
+			entry->referenced = 1;
 		}
-		current = current->next;
 	}
-	// if the key doesn't exist, return NULL
-	return NULL;
+
+	// the timer of a key which expires in the current millisecond may
+	// fire at the next expiry only
+	if (server_deadline_passed(server, deadline))
+		return NULL;
+
+	if (value == NULL)
+		server->filter->false_positives++;
+	return value;
 }
 
-// function which frees the memory of the serve
-void free_server_memory(server_memory* server) {
-	// iterate through each element of the cdll array
-	for (int i = 0; i < (int)server->hmax; i++) {
-		// iterate through the bucket list of the current element in the array
-		// and free the data of each node
-		cdll_node* current = server->buckets[i]->head;
-		for (int j = 0; j < (int)server->buckets[i]->size; j++) {
-			current = server->buckets[i]->head;
-			if (current != server->buckets[i]->tail) {
-				server->buckets[i]->head = server->buckets[i]->head->next;
+// function which looks for the value stored at a key which was
+// already hashed
+char* server_retrieve_key(server_memory* server, key_descriptor* key) {
+	int packed;
+	char* value = server_find_value(server, key, &packed);
+
+	return value ? server_unpacked_value(server, value, packed) : NULL;
+}
+
+// function which copies the value stored at a key which was already
+// hashed in a buffer, unpacking it if it is packed
+int server_retrieve_copy(server_memory* server, key_descriptor* key,
+						 char* buffer, size_t size) {
+	int packed;
+	char* value = server_find_value(server, key, &packed);
+	if (value == NULL)
+		return 0;
+	if (size == 0)
+		return 1;
+
+	// a packed value which fits is unpacked straight in the buffer
+	if (packed && codec_length(value) < size) {
+		codec_unpack(value, buffer);
+		return 1;
+	}
+
+	strncpy(buffer, server_unpacked_value(server, value, packed), size - 1);
+	buffer[size - 1] = '\0';
+	return 1;
+}
+
+// function which sets the length from which the stored values are packed
+void server_set_pack_threshold(server_memory* server,
+							   unsigned int threshold) {
+	server->pack_threshold = threshold;
+}
+
+// function which calls the given function for each key-value pair
+// stored in an array of buckets
+void buckets_for_each(server_memory* server, entry_list* buckets,
+					  unsigned int hmax, server_entry_callback callback,
+					  void* arg) {
+	for (int i = 0; i < (int)hmax; i++) {
+		for (server_entry* entry = buckets[i].head; entry != NULL;
+			 entry = entry_list_next(&buckets[i], entry))
+			callback(entry->pair.key,
+					 server_unpacked_value(server, entry->pair.value,
+										   entry->packed), arg);
+	}
+}
+
+// function which calls the given function for each key-value pair
+// stored on the server
+void server_for_each(server_memory* server, server_entry_callback callback,
+					 void* arg) {
+	// the pairs of a snapshot are visited where they are
+	if (server->snapshot != NULL) {
+		const snapshot_slot* slots = (const snapshot_slot*)
+			(server->snapshot_base + server->snapshot->slots_offset);
+		for (unsigned int i = 0; i < server->snapshot->no_slots; i++) {
+			if (slots[i].key_offset != 0)
+				callback(snapshot_slot_key(server->snapshot_base, &slots[i]),
+						 snapshot_slot_value(server->snapshot_base,
+											 &slots[i]), arg);
+		}
+		return;
+	}
+
+	if (server->backend == SERVER_BACKEND_FLAT) {
+		flat_table* table = server->flat;
+		for (unsigned int i = 0; i < table->capacity; i++) {
+			if (table->meta[i].distance != 0)
+				callback(flat_slot_key(&table->slots[i]),
+						 server_unpacked_value(server, table->slots[i].value,
+											   table->slots[i].packed), arg);
+		}
+		return;
+	}
+
+	// while rehashing, the pairs are stored in both arrays of buckets
+	if (server->old_buckets != NULL)
+		buckets_for_each(server, server->old_buckets, server->old_hmax,
+						 callback, arg);
+	buckets_for_each(server, server->buckets, server->hmax, callback, arg);
+}
+
+// arguments of the visit of a hashring interval
+typedef struct range_args range_args;
+struct range_args {
+	server_memory* server;
+	server_entry_callback callback;
+	void* arg;
+};
+
+// function called for each slot of the flat table storing a key
+// with the visited hash
+void range_visit_slot(flat_slot* slot, void* arg) {
+	range_args* args = arg;
+	args->callback(flat_slot_key(slot),
+				   server_unpacked_value(args->server, slot->value,
+										 slot->packed), args->arg);
+}
+
+// function called for each distinct hash of the interval, which visits
+// the pairs whose key has this hash
+void range_visit_hash(unsigned int hash, void* arg) {
+	range_args* args = arg;
+	server_memory* server = args->server;
+
+	if (server->backend == SERVER_BACKEND_FLAT) {
+		flat_table_for_each_with_hash(server->flat, hash,
+									  range_visit_slot, args);
+		return;
+	}
+
+	// the pairs with the same hash are in the same bucket
+	entry_list* bucket = server_bucket(server, hash);
+	for (server_entry* entry = bucket->head; entry != NULL;
+		 entry = entry_list_next(bucket, entry)) {
+		if (entry->hash == hash)
+			args->callback(entry->pair.key,
+						   server_unpacked_value(server, entry->pair.value,
+												 entry->packed), args->arg);
+	}
+}
+
+// function which calls the given function for each key-value pair
+// whose key hash is in [first_hash, last_hash]
+void server_for_each_in_range(server_memory* server, unsigned int first_hash,
+							  unsigned int last_hash,
+							  server_entry_callback callback, void* arg) {
+	range_args args = {server, callback, arg};
+	server_load_snapshot(server);
+
+	hash_index_for_each_in_range(server->ring_index, first_hash, last_hash,
+								 range_visit_hash, &args);
+}
+
+// pair detached from a server, whose buffers are given to another server
+typedef struct detached_entry detached_entry;
+struct detached_entry {
+	unsigned int hash;
+	// bucket entry of the pair, for the chained backend
+	server_entry* node;
+	// slot of the pair, for the flat backend
+	flat_slot slot;
+};
+
+// function which returns the value of a detached pair and fills
+// whether it is packed
+char* detached_value(detached_entry* entry, int* packed) {
+	if (entry->node != NULL) {
+		*packed = entry->node->packed;
+		return entry->node->pair.value;
+	}
+
+	*packed = entry->slot.packed;
+	return entry->slot.value;
+}
+
+// function which returns the key and value sizes of a detached pair
+void detached_sizes(detached_entry* entry, size_t* key_size,
+					size_t* value_size) {
+	if (entry->node != NULL)
+		*key_size = entry->node->key_length + 1;
+	else
+		*key_size = entry->slot.key_length + 1;
+
+	int packed;
+	char* value = detached_value(entry, &packed);
+	*value_size = codec_stored_size(value, packed);
+}
+
+// function which returns the deadline of a detached pair
+unsigned long long detached_deadline(detached_entry* entry) {
+	if (entry->node != NULL)
+		return entry->node->deadline;
+	return entry->slot.deadline;
+}
+
+// function which gives a detached pair to the recipient server; the entry
+// and the key and value buffers are not copied, only their accounting is
+// moved from the donor's arena to the recipient's arena
+void server_attach(server_memory* donor, server_memory* recipient,
+				   detached_entry* entry) {
+	size_t key_size, value_size;
+	detached_sizes(entry, &key_size, &value_size);
+
+	key_descriptor key;
+	key.hash = entry->hash;
+	key.length = key_size - 1;
+
+	if (entry->node != NULL) {
+		// the recipient may still hold an older copy of the key
+		key.key = entry->node->pair.key;
+		server_remove_key(recipient, &key);
+
+		server_entry* node = entry->node;
+		arena_transfer(donor->pool, recipient->pool, node,
+					   sizeof(server_entry));
+		arena_transfer(donor->pool, recipient->pool, node->pair.key,
+					   key_size);
+		arena_transfer(donor->pool, recipient->pool, node->pair.value,
+					   value_size);
+		entry_list_push_back(server_bucket(recipient, entry->hash),
+							 entry->node);
+	} else {
+		key.key = flat_slot_key(&entry->slot);
+		server_remove_key(recipient, &key);
+
+		if (key_size > KEY_LENGTH)
+			arena_transfer(donor->pool, recipient->pool, key.key, key_size);
+		arena_transfer(donor->pool, recipient->pool, entry->slot.value,
+					   value_size);
+		flat_table_put(recipient->flat, entry->hash, entry->slot);
+	}
+
+	// the deadline of the pair moves with it, so the recipient gets a
+	// timer; the donor's timer finds nothing to remove
+	unsigned long long deadline = detached_deadline(entry);
+	if (deadline != 0) {
+		server_add_timer(recipient, entry->hash, deadline);
+		recipient->expiring++;
+	}
+
+	int packed;
+	char* value = detached_value(entry, &packed);
+	server_count_packed(recipient, value, packed, 1);
+
+	server_index_insert(recipient, entry->hash);
+	recipient->size++;
+	recipient->bytes_used += server_entry_bytes(recipient, key_size,
+												value_size);
+
+	if (recipient->backend == SERVER_BACKEND_CHAINED)
+		server_check_resize(recipient);
+	server_evict(recipient);
+}
+
+// function which detaches from the donor the first pair whose key
+// has the given hash; it returns 0 if there isn't such a pair
+int server_detach_hash(server_memory* donor, unsigned int hash,
+					   detached_entry* entry) {
+	entry->hash = hash;
+	entry->node = NULL;
+
+	if (donor->backend == SERVER_BACKEND_FLAT) {
+		int index = flat_table_find_hash(donor->flat, hash);
+		if (index < 0)
+			return 0;
+		entry->slot = flat_table_take(donor->flat, index);
+	} else {
+		// the pairs with the same hash are in the same bucket
+		entry_list* bucket = server_bucket(donor, hash);
+		for (server_entry* current = bucket->head; current != NULL;
+			 current = entry_list_next(bucket, current)) {
+			if (current->hash == hash) {
+				entry->node = current;
+				break;
 			}
-			free(((key_value_pair*)(current->data))->key);
-			free(((key_value_pair*)(current->data))->value);
-			free(current->data);
-			free(current);
 		}
-		// free the list
-		free(server->buckets[i]);
+		if (entry->node == NULL)
+			return 0;
+		entry_list_remove(bucket, entry->node);
+	}
+
+	size_t key_size, value_size;
+	detached_sizes(entry, &key_size, &value_size);
+	server_index_remove(donor, hash);
+	donor->size--;
+	donor->expiring -= (detached_deadline(entry) != 0);
+	int packed;
+	char* value = detached_value(entry, &packed);
+	server_count_packed(donor, value, packed, -1);
+	donor->bytes_used -= server_entry_bytes(donor, key_size, value_size);
+
+	return 1;
+}
+
+// dynamic array of the hashes of a hashring interval
+typedef struct hash_array hash_array;
+struct hash_array {
+	unsigned int* hashes;
+	unsigned int size;
+	unsigned int capacity;
+};
+
+// function called for each distinct hash of the moved interval
+void collect_hash(unsigned int hash, void* arg) {
+	hash_array* array = arg;
+
+	if (array->size == array->capacity) {
+		array->capacity = array->capacity ? 2 * array->capacity : 16;
+		array->hashes = realloc(array->hashes,
+								array->capacity * sizeof(unsigned int));
+		DIE(array->hashes == NULL, "Error");
+	}
+	array->hashes[array->size++] = hash;
+}
+
+// function which moves the pairs whose key hash is in the interval
+// [first_hash, last_hash] from the donor to the recipient
+void server_move_range(server_memory* donor, server_memory* recipient,
+					   unsigned int first_hash, unsigned int last_hash) {
+	DIE(donor->backend != recipient->backend, "different server backends");
+	server_load_snapshot(donor);
+	server_load_snapshot(recipient);
+
+	// the hashes are collected first, because the donor's ring index
+	// changes while the pairs are moved
+	hash_array array = {NULL, 0, 0};
+	hash_index_for_each_in_range(donor->ring_index, first_hash, last_hash,
+								 collect_hash, &array);
+
+	detached_entry entry;
+	for (unsigned int i = 0; i < array.size; i++) {
+		while (server_detach_hash(donor, array.hashes[i], &entry))
+			server_attach(donor, recipient, &entry);
+	}
+
+	if (donor->backend == SERVER_BACKEND_CHAINED)
+		server_check_resize(donor);
+	free(array.hashes);
+}
+
+// arguments used for finding the pairs of a server which are routed
+// on a different server
+typedef struct reroute_args reroute_args;
+struct reroute_args {
+	server_memory* donor;
+	server_route_callback route;
+	void* arg;
+	hash_array hashes;
+};
+
+// function called for each distinct hash of a server, which collects
+// the hashes routed on a different server
+void collect_rerouted_hash(unsigned int hash, void* arg) {
+	reroute_args* args = arg;
+
+	if (args->route(hash, args->arg) != args->donor)
+		collect_hash(hash, &args->hashes);
+}
+
+// function which moves the pairs which are routed on a different server
+void server_move_rerouted(server_memory* donor, server_route_callback route,
+						  void* arg) {
+	reroute_args args = {donor, route, arg, {NULL, 0, 0}};
+	server_load_snapshot(donor);
+	hash_index_for_each_in_range(donor->ring_index, 0, UINT_MAX,
+								 collect_rerouted_hash, &args);
+
+	detached_entry entry;
+	for (unsigned int i = 0; i < args.hashes.size; i++) {
+		server_memory* recipient = route(args.hashes.hashes[i], arg);
+		while (server_detach_hash(donor, args.hashes.hashes[i], &entry))
+			server_attach(donor, recipient, &entry);
+	}
+
+	if (donor->backend == SERVER_BACKEND_CHAINED)
+		server_check_resize(donor);
+	free(args.hashes.hashes);
+}
+
+// function which moves count pairs of the donor to the servers given by
+// the route function
+void server_move_some(server_memory* donor, unsigned int count,
+					  server_route_callback route, void* arg) {
+	hash_array array = {NULL, 0, 0};
+	server_load_snapshot(donor);
+	hash_index_for_each_in_range(donor->ring_index, 0, UINT_MAX,
+								 collect_hash, &array);
+
+	detached_entry entry;
+	unsigned int moved = 0;
+	for (unsigned int i = 0; i < array.size && moved < count; i++) {
+		server_memory* recipient = route(array.hashes[i], arg);
+		while (server_detach_hash(donor, array.hashes[i], &entry)) {
+			server_attach(donor, recipient, &entry);
+			moved++;
+		}
+	}
+
+	if (donor->backend == SERVER_BACKEND_CHAINED)
+		server_check_resize(donor);
+	free(array.hashes);
+}
+
+// function which moves the pairs of the first max_hashes key hashes of
+// the interval [first_hash, last_hash] to the servers given by the route
+// function; it returns the number of moved hashes and adds the number of
+// moved pairs to *moved
+unsigned int server_move_range_step(server_memory* donor,
+									unsigned int first_hash,
+									unsigned int last_hash,
+									unsigned int max_hashes,
+									server_route_callback route, void* arg,
+									unsigned int* moved) {
+	server_load_snapshot(donor);
+
+	unsigned int* hashes = malloc(max_hashes * sizeof(unsigned int));
+	DIE(hashes == NULL, "Error");
+	unsigned int count = hash_index_collect_range(donor->ring_index,
+												  first_hash, last_hash,
+												  hashes, max_hashes);
+
+	detached_entry entry;
+	for (unsigned int i = 0; i < count; i++) {
+		server_memory* recipient = route(hashes[i], arg);
+		server_load_snapshot(recipient);
+		while (server_detach_hash(donor, hashes[i], &entry)) {
+			server_attach(donor, recipient, &entry);
+			(*moved)++;
+		}
+	}
+
+	if (donor->backend == SERVER_BACKEND_CHAINED)
+		server_check_resize(donor);
+	free(hashes);
+	return count;
+}
+
+// function which returns the number of pairs whose key hash is in the
+// interval [first_hash, last_hash]
+unsigned int server_count_range(server_memory* server,
+								unsigned int first_hash,
+								unsigned int last_hash) {
+	server_load_snapshot(server);
+	return hash_index_count_range(server->ring_index, first_hash, last_hash);
+}
+
+// function which moves the pairs of an array of buckets to the servers
+// given by the routing function
+void buckets_move_all(server_memory* donor, entry_list* buckets,
+					  unsigned int hmax, server_route_callback route,
+					  void* arg) {
+	detached_entry entry;
+
+	for (int i = 0; i < (int)hmax; i++) {
+		while (buckets[i].size > 0) {
+			entry.node = entry_list_pop_front(&buckets[i]);
+			entry.hash = entry.node->hash;
+			server_attach(donor, route(entry.hash, arg), &entry);
+		}
+	}
+}
+
+// function which moves all the pairs of the donor to the servers given
+// by the routing function, leaving the donor empty
+void server_move_all(server_memory* donor, server_route_callback route,
+					 void* arg) {
+	server_load_snapshot(donor);
+
+	if (donor->backend == SERVER_BACKEND_FLAT) {
+		flat_table* table = donor->flat;
+		detached_entry entry;
+		entry.node = NULL;
+
+		// the slots are copied as they are and the table is emptied at
+		// the end, so it doesn't shrink while it is visited
+		for (unsigned int i = 0; i < table->capacity; i++) {
+			if (table->meta[i].distance == 0)
+				continue;
+			entry.hash = table->meta[i].hash;
+			entry.slot = table->slots[i];
+			server_attach(donor, route(entry.hash, arg), &entry);
+		}
+		memset(table->meta, 0, table->capacity * sizeof(flat_meta));
+		table->size = 0;
+	} else {
+		if (donor->old_buckets != NULL)
+			buckets_move_all(donor, donor->old_buckets, donor->old_hmax,
+							 route, arg);
+		buckets_move_all(donor, donor->buckets, donor->hmax, route, arg);
+	}
+
+	donor->size = 0;
+	donor->bytes_used = 0;
+	donor->expiring = 0;
+	donor->packed = 0;
+	donor->packed_bytes = 0;
+	donor->unpacked_bytes = 0;
+	free_hash_index(donor->ring_index);
+	donor->ring_index = create_hash_index();
+	key_filter_rebuild(donor->filter, donor->ring_index);
+	if (donor->wheel != NULL) {
+		free_timing_wheel(donor->wheel);
+		donor->wheel = NULL;
+	}
+}
+
+// function which returns the length of the longest bucket of an array
+unsigned int buckets_longest_chain(entry_list* buckets, unsigned int hmax) {
+	unsigned int longest = 0;
+
+	for (int i = 0; i < (int)hmax; i++) {
+		if (buckets[i].size > longest)
+			longest = buckets[i].size;
+	}
+
+	return longest;
+}
+
+// function which calculates the statistics of the server's hashtable
+void server_get_stats(server_memory* server, server_stats* stats) {
+	server_load_snapshot(server);
+
+	stats->size = server->size;
+	stats->bytes_used = server->bytes_used;
+
+	if (server->backend == SERVER_BACKEND_FLAT) {
+		stats->buckets = server->flat->capacity;
+		stats->longest_chain = flat_table_longest_probe(server->flat);
+		stats->rehashing = 0;
+	} else {
+		stats->buckets = server->hmax;
+		stats->longest_chain = buckets_longest_chain(server->buckets,
+													 server->hmax);
+		stats->rehashing = (server->old_buckets != NULL);
+		if (server->old_buckets != NULL) {
+			unsigned int old_longest = buckets_longest_chain(server->
+									   old_buckets, server->old_hmax);
+			if (old_longest > stats->longest_chain)
+				stats->longest_chain = old_longest;
+		}
+	}
+
+	stats->load_factor = (double)server->size / stats->buckets;
+	stats->filter_bytes = (size_t)server->filter->no_blocks * KEY_FILTER_BLOCK;
+	stats->filter_negatives = server->filter->negatives;
+	stats->filter_false_positives = server->filter->false_positives;
+	stats->filter_false_positive_rate =
+		key_filter_false_positive_rate(server->filter);
+	stats->expiring = server->expiring;
+	stats->timers = server->wheel ? server->wheel->size : 0;
+	stats->expired = server->expired;
+	stats->budget = server->budget;
+	stats->evicted = server->evicted;
+	stats->packed = server->packed;
+	stats->packed_bytes = server->packed_bytes;
+	stats->unpacked_bytes = server->unpacked_bytes;
+}
+
+// function which gives an empty server the pairs of a snapshot table
+void server_attach_snapshot(server_memory* server, const char* base,
+							const snapshot_table* table) {
+	DIE(server->size != 0, "the server already has pairs");
+
+	server->snapshot = table;
+	server->snapshot_base = base;
+	// the load balancer counts the pairs of the server before they are
+	// loaded; their bytes are counted when they are loaded
+	server->size = table->no_entries;
+}
+
+// function which loads the pairs of the server's snapshot table in its
+// hashtable; the keys and values are copied in the server's arena
+void server_load_snapshot(server_memory* server) {
+	if (server->snapshot == NULL)
+		return;
+
+	const snapshot_table* table = server->snapshot;
+	const char* base = server->snapshot_base;
+	const snapshot_slot* slots =
+		(const snapshot_slot*)(base + table->slots_offset);
+	server->snapshot = NULL;
+	server->size = 0;
+
+	for (unsigned int i = 0; i < table->no_slots; i++) {
+		if (slots[i].key_offset == 0)
+			continue;
+
+		key_descriptor key = {snapshot_slot_key(base, &slots[i]),
+							  slots[i].key_length, slots[i].hash};
+		server_store_key(server, &key, snapshot_slot_value(base, &slots[i]));
+	}
+}
+
+// function which frees the memory of the server; the stored pairs are
+// owned by the arena, so freeing it only unmaps its chunks
+void free_server_memory(server_memory* server) {
+	if (server->backend == SERVER_BACKEND_FLAT) {
+		free_flat_table(server->flat);
+	} else {
+		// free the arrays of buckets
+		if (server->old_buckets != NULL)
+			free_buckets(server->old_buckets);
+		free_buckets(server->buckets);
 	}
 
-	// free the array of buckets and the server
-	free(server->buckets);
+	free_hash_index(server->ring_index);
+	free_key_filter(server->filter);
+	if (server->wheel != NULL)
+		free_timing_wheel(server->wheel);
+	free(server->codec_buffer);
+	free_arena(server->pool);
+	pthread_mutex_destroy(&server->lock);
 	free(server);
 }
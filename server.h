@@ -5,37 +5,177 @@
 #ifndef SERVER_H_
 #define SERVER_H_
 
-#include "circular_doubly_linked_list.h"
+#include <pthread.h>
 
-#define HMAX 1000
+#include "flat_table.h"
+#include "intrusive_list.h"
+#include "arena.h"
+#include "hash_index.h"
+#include "key_filter.h"
+#include "key_hash.h"
+#include "snapshot.h"
+#include "timing_wheel.h"
+
+// initial (and minimum) number of buckets; the number of buckets
+// is always a power of 2
+#define HMAX 64
 #define MAX_HASH 100000
 
-// key-value data structure which will represent the data of a node within
-// each list of the cdlls array
+// the buckets are doubled when the server stores more than
+// MAX_LOAD_FACTOR keys per bucket and halved when it stores less than
+// one key per MIN_LOAD_FACTOR_DIVISOR buckets
+#define MAX_LOAD_FACTOR 2
+#define MIN_LOAD_FACTOR_DIVISOR 8
+// number of buckets moved by each store or remove while rehashing
+#define REHASH_STEP 4
+
+// key-value data structure which will represent the data of an entry
+// within each bucket
 typedef struct key_value_pair key_value_pair;
 struct key_value_pair {
 	void *key;
 	void *value;
 };
 
+// entry of a stored pair, defined in server.c; the buckets are lists
+// whose links are inside the entries
+typedef struct server_entry server_entry;
+INTRUSIVE_LIST_TYPE(entry_list, server_entry);
+
+// implementations which can be used for storing the data of a server
+typedef enum server_backend server_backend;
+enum server_backend {
+	// array of buckets which chain the entries of their pairs
+	SERVER_BACKEND_CHAINED,
+	// open addressing table which stores the keys inline (flat_table.h)
+	SERVER_BACKEND_FLAT
+};
+
+// statistics about the hashtable of a server
+typedef struct server_stats server_stats;
+struct server_stats {
+	// number of keys stored on the server
+	unsigned int size;
+	// bytes used by the stored keys, values and their metadata
+	size_t bytes_used;
+	// number of buckets (or slots, for the flat backend)
+	unsigned int buckets;
+	// number of keys per bucket
+	double load_factor;
+	// length of the longest bucket (or the longest probe sequence,
+	// for the flat backend)
+	unsigned int longest_chain;
+	// 1 if the buckets are being rehashed
+	int rehashing;
+	// bytes of the filter of the key hashes
+	size_t filter_bytes;
+	// number of lookups of missing keys answered by the filter, number
+	// of lookups of missing keys which passed it and their ratio
+	unsigned long long filter_negatives;
+	unsigned long long filter_false_positives;
+	double filter_false_positive_rate;
+	// number of keys with a deadline, number of their timers (some of
+	// them may belong to keys which were stored again or removed) and
+	// number of keys which expired
+	unsigned int expiring;
+	unsigned int timers;
+	unsigned long long expired;
+	// bytes which the server can use (0 if unlimited) and number of
+	// keys evicted for staying under them
+	size_t budget;
+	unsigned long long evicted;
+	// number of values packed by the value codec, their stored bytes and
+	// their bytes before they were packed
+	unsigned int packed;
+	size_t packed_bytes;
+	size_t unpacked_bytes;
+};
+
+// function called for each key-value pair of a server
+typedef void (*server_entry_callback)(char* key, char* value, void* arg);
+
 // hashtable data structure which stores the data of a server
 typedef struct server_memory server_memory;
+
+// function which returns the server on which a key with the given hash
+// should be moved
+typedef server_memory* (*server_route_callback)(unsigned int hash, void* arg);
 struct server_memory {
-	// array of cdlls; buckets[i] represents the bucket for the i hash and
-	// stores a list of key_value_pair nodes
-	cdll_list **buckets;
-	// total number of nodes stored in all buckets
+	// implementation used for storing the data
+	server_backend backend;
+	// array of lists; buckets[i] represents the bucket for the i hash and
+	// links the entries of its pairs
+	entry_list* buckets;
+	// total number of entries stored in all buckets
 	unsigned int size;
+	// bytes used by the stored keys, values and their metadata
+	size_t bytes_used;
 	// number of buckets
 	unsigned int hmax;
+	// array of buckets which is being rehashed into the current buckets;
+	// NULL if no rehash is in progress
+	entry_list* old_buckets;
+	// number of old buckets
+	unsigned int old_hmax;
+	// index of the next old bucket which has to be moved
+	unsigned int rehash_index;
+	// open addressing table, used instead of the buckets
+	// by the SERVER_BACKEND_FLAT backend
+	flat_table* flat;
+	// arena from which the stored keys, values and bucket entries
+	// are allocated
+	arena* pool;
+	// hashes of the stored keys, ordered by their position on the
+	// hashring, so the keys of a hashring interval can be found
+	// without visiting the whole hashtable
+	hash_index* ring_index;
+	// filter of the hashes of the ring index, checked before the
+	// hashtable is searched
+	key_filter* filter;
+	// table of a mapped snapshot which still holds the pairs of the
+	// server (NULL if there isn't any); the lookups are done in the
+	// snapshot until the server changes, when its pairs are loaded in
+	// the hashtable
+	const snapshot_table* snapshot;
+	const char* snapshot_base;
+	// timers of the keys with a deadline (NULL until a key gets one),
+	// the clock which tells when they expire, the time of the last
+	// expiry and the number of keys which expired
+	timing_wheel* wheel;
+	wheel_clock clock;
+	unsigned long long now;
+	unsigned long long expired;
+	// number of stored pairs with a deadline
+	unsigned int expiring;
+	// bytes_used above which pairs are evicted (0 if unlimited), position
+	// of the eviction hand in the buckets (or in the flat slots) and
+	// number of evicted pairs
+	size_t budget;
+	unsigned int evict_hand;
+	unsigned long long evicted;
+	// values at least this long are packed by the value codec when they
+	// get smaller (0 if the values are never packed)
+	unsigned int pack_threshold;
+	// buffer of VALUE_LENGTH bytes in which the values are packed and
+	// unpacked (NULL until it is needed)
+	char* codec_buffer;
+	// number of packed values, their stored bytes and their bytes
+	// before they were packed
+	unsigned int packed;
+	size_t packed_bytes;
+	size_t unpacked_bytes;
+	// lock taken by the load balancer before using the server, when the
+	// load balancer is shared between threads
+	pthread_mutex_t lock;
 };
 
-// hashs function for keys
-unsigned int hash_function_key(void *a);
-
 // function which initialises and returns a server_memory element
 server_memory* init_server_memory();
 
+// function which initialises and returns a server_memory element
+// which uses the given backend
+server_memory* init_server_memory_backend(server_backend backend);
+
 
 // server_store() - Stores a key-value pair to the server.
 // @arg1: Server which performs the task.
@@ -43,11 +183,59 @@ server_memory* init_server_memory();
 // @arg3: Value represented as a string.
 void server_store(server_memory* server, char* key, char* value);
 
+// server_store_key() - Stores a key-value pair whose key was already
+// hashed (see key_descriptor_init).
+//
+// If the server goes above its budget, pairs are evicted (see
+// server_set_budget).
+void server_store_key(server_memory* server, key_descriptor* key,
+					  char* value);
+
+// server_store_key_deadline() - Stores a key-value pair which expires.
+// @arg1: Server which performs the task.
+// @arg2: Hashed key.
+// @arg3: Value represented as a string.
+// @arg4: Time (in ms of the server's clock) at which the pair expires,
+//        or 0 if it never expires.
+//
+// The deadline replaces the one of the key, if it was already stored.
+void server_store_key_deadline(server_memory* server, key_descriptor* key,
+							   char* value, unsigned long long deadline);
+
+// function which returns the deadline of a stored key, or 0 if the key
+// never expires (or isn't stored)
+unsigned long long server_key_deadline(server_memory* server,
+									   key_descriptor* key);
+
+// server_expire() - Removes the pairs whose deadline passed.
+// @arg1: Server which performs the task.
+//
+// Only the timers which expired since the last call are visited, so the
+// pairs are not scanned. It is called by the stores and retrieves of the
+// server, which also treat an expired pair as missing.
+void server_expire(server_memory* server);
+
+// server_set_budget() - Limits the bytes used by a server.
+// @arg1: Server which performs the task.
+// @arg2: Bytes of keys, values and metadata which the server can use,
+//        or 0 if they are unlimited.
+//
+// While the server is above its budget, pairs are evicted with the CLOCK
+// policy: the stores and the successful lookups only mark their pair as
+// referenced, and a hand which goes round the buckets (or the slots)
+// clears the marks it passes over and evicts the first pair without one.
+// The stores, the pairs moved on the server and this function evict.
+void server_set_budget(server_memory* server, size_t budget);
+
 // server_remove() - Removes a key-pair value from the server.
 // @arg1: Server which performs the task.
 // @arg2: Key represented as a string.
 void server_remove(server_memory* server, char* key);
 
+// server_remove_key() - Removes a key-value pair whose key was already
+// hashed.
+void server_remove_key(server_memory* server, key_descriptor* key);
+
 // server_remove() - Gets the value associated with the key.
 // @arg1: Server which performs the task.
 // @arg2: Key represented as a string.
@@ -56,6 +244,165 @@ void server_remove(server_memory* server, char* key);
 //         or NULL (in case the key does not exist).
 char* server_retrieve(server_memory* server, char* key);
 
+// server_retrieve_key() - Gets the value associated with a key which was
+// already hashed.
+//
+// A packed value is unpacked in the codec buffer of the server, so it
+// stays valid until the next operation of the server.
+//
+// The filter of the server is checked first, so most of the missing keys
+// are not searched in the hashtable; the lookups it answers and its false
+// positives are counted in the filter. The lookups of a server whose
+// pairs are still in a snapshot skip the filter.
+char* server_retrieve_key(server_memory* server, key_descriptor* key);
+
+// server_retrieve_copy() - Copies the value associated with a key.
+// @arg1: Server which performs the task.
+// @arg2: Hashed key.
+// @arg3: Buffer in which the value is copied (unpacked, if it is packed);
+//        a longer value is truncated and the buffer is null terminated.
+// @arg4: Size of the buffer.
+//
+// Return: 1 if the key exists, 0 otherwise.
+int server_retrieve_copy(server_memory* server, key_descriptor* key,
+						 char* buffer, size_t size);
+
+// server_set_pack_threshold() - Packs the long values of a server.
+// @arg1: Server which performs the task.
+// @arg2: Length from which the stored values are packed by the value
+//        codec (0 if they are never packed).
+//
+// A value is packed only if it gets smaller and if it is shorter than
+// VALUE_LENGTH; the values which were already stored are not changed.
+void server_set_pack_threshold(server_memory* server, unsigned int threshold);
+
+// server_for_each() - Calls a function for each key-value pair.
+// @arg1: Server whose pairs are visited.
+// @arg2: Function which is called for each pair.
+// @arg3: Argument given to the function.
+//
+// The function must not modify the visited server. A packed value is
+// given unpacked in the codec buffer of the server, which is reused for
+// the next pair.
+void server_for_each(server_memory* server, server_entry_callback callback,
+					 void* arg);
+
+// server_for_each_in_range() - Calls a function for each key-value pair
+// whose key hash is in the interval [first_hash, last_hash].
+// @arg1: Server whose pairs are visited.
+// @arg2: First hash of the interval.
+// @arg3: Last hash of the interval.
+// @arg4: Function which is called for each pair.
+// @arg5: Argument given to the function.
+//
+// The hashes of the interval are found with the server's ring index, so
+// only the pairs of the interval are visited. The function must not
+// modify the visited server.
+void server_for_each_in_range(server_memory* server, unsigned int first_hash,
+							  unsigned int last_hash,
+							  server_entry_callback callback, void* arg);
+
+// server_move_range() - Moves the key-value pairs whose key hash is in the
+// interval [first_hash, last_hash] from a server to another one.
+// @arg1: Server from which the pairs are moved.
+// @arg2: Server on which the pairs are moved.
+// @arg3: First hash of the interval.
+// @arg4: Last hash of the interval.
+//
+// The ownership of the pairs' memory is transferred: the key and value
+// buffers are neither reallocated nor copied, so they stay in the chunks
+// of the donor's arena, which must live as long as the recipient uses
+// them (see arena_adopt). Both servers must use the same backend.
+void server_move_range(server_memory* donor, server_memory* recipient,
+					   unsigned int first_hash, unsigned int last_hash);
+
+// server_move_all() - Moves all the key-value pairs of a server.
+// @arg1: Server from which the pairs are moved.
+// @arg2: Function which returns the server on which a pair is moved.
+// @arg3: Argument given to the function.
+//
+// The ownership of the pairs' memory is transferred, as for
+// server_move_range; the donor is left empty.
+void server_move_all(server_memory* donor, server_route_callback route,
+					 void* arg);
+
+// server_move_rerouted() - Moves the key-value pairs which are routed
+// on a different server.
+// @arg1: Server from which the pairs are moved.
+// @arg2: Function which returns the server of a key hash.
+// @arg3: Argument given to the function.
+//
+// It is used by the routing strategies which can move keys between any
+// two servers; the ownership of the pairs' memory is transferred, as
+// for server_move_range.
+void server_move_rerouted(server_memory* donor, server_route_callback route,
+						  void* arg);
+
+// server_move_some() - Moves some of the key-value pairs of a server.
+// @arg1: Server from which the pairs are moved.
+// @arg2: Number of pairs which are moved; a few more may be moved when
+//        several keys have the same hash, since they are moved together.
+// @arg3: Function which returns the server on which a pair is moved.
+// @arg4: Argument given to the function.
+//
+// The pairs are taken in the order of their hashes, so the same pairs
+// are moved to the same servers whatever the layout of the hashtable. It
+// is used for taking the objects above its bound off a server, or all
+// the objects of a removed server with bounded loads; the ownership of
+// the pairs' memory is transferred, as for server_move_range.
+void server_move_some(server_memory* donor, unsigned int count,
+					  server_route_callback route, void* arg);
+
+// server_move_range_step() - Moves the key-value pairs of the first key
+// hashes of an interval.
+// @arg1: Server from which the pairs are moved.
+// @arg2: First hash of the interval.
+// @arg3: Last hash of the interval.
+// @arg4: Maximum number of distinct key hashes whose pairs are moved.
+// @arg5: Function which returns the server on which a pair is moved; it
+//        must not return the donor.
+// @arg6: Argument given to the function.
+// @arg7: Counter to which the number of moved pairs is added.
+//
+// It is used for moving an interval a few keys at a time: the moved
+// hashes leave the donor, so the next step starts from the same
+// interval. The ownership of the pairs' memory is transferred, as for
+// server_move_range.
+//
+// Return: Number of moved hashes; it is less than the maximum only if
+//         the interval was emptied.
+unsigned int server_move_range_step(server_memory* donor,
+									unsigned int first_hash,
+									unsigned int last_hash,
+									unsigned int max_hashes,
+									server_route_callback route, void* arg,
+									unsigned int* moved);
+
+// function which returns the number of pairs of the server whose key
+// hash is in the interval [first_hash, last_hash]
+unsigned int server_count_range(server_memory* server,
+								unsigned int first_hash,
+								unsigned int last_hash);
+
+// server_attach_snapshot() - Gives an empty server the pairs of a table
+// of a mapped snapshot.
+// @arg1: Server without pairs.
+// @arg2: Start of the mapped snapshot.
+// @arg3: Table of the server in the snapshot.
+//
+// The pairs are not copied: they are looked up in the snapshot until the
+// server is changed (or its pairs are moved), when they are loaded in
+// the server's hashtable. The snapshot must stay mapped until then.
+void server_attach_snapshot(server_memory* server, const char* base,
+							const snapshot_table* table);
+
+// function which loads the pairs of the server's snapshot table (if it
+// has one) in its hashtable
+void server_load_snapshot(server_memory* server);
+
+// function which calculates the statistics of the server's hashtable
+void server_get_stats(server_memory* server, server_stats* stats);
+
 // function which frees the memory of the server
 void free_server_memory(server_memory* server);
 
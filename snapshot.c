@@ -0,0 +1,94 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the snapshot files of the load balancer
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+
+// function which returns the key of a used slot of a mapped snapshot
+char* snapshot_slot_key(const char* base, const snapshot_slot* slot) {
+	return (char*)base + slot->key_offset;
+}
+
+// function which returns the value of a used slot of a mapped snapshot
+char* snapshot_slot_value(const char* base, const snapshot_slot* slot) {
+	return (char*)base + slot->key_offset + slot->key_length + 1;
+}
+
+// function which finds a key in a table of a mapped snapshot
+const snapshot_slot* snapshot_find(const char* base,
+								   const snapshot_table* table,
+								   key_descriptor* key) {
+	if (table->no_entries == 0)
+		return NULL;
+
+	const snapshot_slot* slots =
+		(const snapshot_slot*)(base + table->slots_offset);
+	unsigned int mask = table->no_slots - 1;
+
+	// the table is at most half full, so an empty slot ends the probe
+	for (unsigned int i = key->hash & mask; slots[i].key_offset != 0;
+		 i = (i + 1) & mask) {
+		if (slots[i].hash == key->hash &&
+			slots[i].key_length == key->length &&
+			!memcmp(base + slots[i].key_offset, key->key, key->length))
+			return &slots[i];
+	}
+
+	return NULL;
+}
+
+// function which writes bytes at the end of a snapshot
+void snapshot_write(FILE* file, size_t* offset, const void* data,
+					size_t size) {
+	DIE(fwrite(data, 1, size, file) != size, "fwrite");
+	*offset += size;
+}
+
+// function which writes the pairs of a server in a snapshot
+void snapshot_write_table(FILE* file, size_t* offset,
+						  snapshot_entry* entries, unsigned int count,
+						  snapshot_table* table) {
+	// the slots are aligned on 8 bytes, as the structures of the file
+	static const char padding[8];
+	snapshot_write(file, offset, padding, (8 - *offset % 8) % 8);
+
+	table->no_entries = count;
+	table->no_slots = 16;
+	while (table->no_slots < 2 * count)
+		table->no_slots *= 2;
+	table->slots_offset = *offset;
+
+	snapshot_slot* slots = calloc(table->no_slots, sizeof(snapshot_slot));
+	DIE(slots == NULL, "Error");
+
+	// the keys and values are written after the slots, in the order of
+	// the entries
+	size_t data_offset = *offset + table->no_slots * sizeof(snapshot_slot);
+	unsigned int mask = table->no_slots - 1;
+	for (unsigned int i = 0; i < count; i++) {
+		key_descriptor key;
+		key_descriptor_init(&key, entries[i].key);
+
+		unsigned int slot = key.hash & mask;
+		while (slots[slot].key_offset != 0)
+			slot = (slot + 1) & mask;
+		slots[slot].hash = key.hash;
+		slots[slot].key_length = key.length;
+		slots[slot].key_offset = data_offset;
+
+		data_offset += key.length + 1 + strlen(entries[i].value) + 1;
+	}
+
+	snapshot_write(file, offset, slots,
+				   table->no_slots * sizeof(snapshot_slot));
+	free(slots);
+
+	for (unsigned int i = 0; i < count; i++) {
+		snapshot_write(file, offset, entries[i].key,
+					   strlen(entries[i].key) + 1);
+		snapshot_write(file, offset, entries[i].value,
+					   strlen(entries[i].value) + 1);
+	}
+}
@@ -0,0 +1,122 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the snapshot files of
+// the load balancer: their format, the tables of the servers' pairs
+// and the lookups done directly in a mapped snapshot
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <stdio.h>
+
+#include "key_hash.h"
+#include "utils.h"
+
+// a snapshot file starts with this magic (the last two characters are
+// the version of the format)
+#define SNAPSHOT_MAGIC "LBSNAP01"
+
+// Layout of a snapshot file; all the positions are offsets from the
+// start of the file, so the file can be mapped at any address and used
+// without being changed:
+//   - snapshot_header
+//   - snapshot_server array, in the order the servers were added to the
+//   router (the routing strategies other than the ring depend on it)
+//   - the buckets of ROUTING_JUMP, if any
+//   - for each server: its snapshot_slot array, then its keys and values
+// The structures are written with the byte order and the alignment of
+// the machine, so a snapshot is read by the machine which wrote it.
+
+typedef struct snapshot_header snapshot_header;
+struct snapshot_header {
+	char magic[8];
+	// options of the load balancer which decide the server of a key
+	unsigned int routing;
+	unsigned int bounded_loads;
+	double load_epsilon;
+	// number of objects, used by bounded loads
+	unsigned int no_objects;
+	unsigned int no_servers;
+	unsigned int no_buckets;
+	// number of servers which store each object (0 or 1 if the objects
+	// are not replicated)
+	unsigned int replication_factor;
+	unsigned long long servers_offset;
+	unsigned long long buckets_offset;
+	// size of the whole file, checked when it is restored
+	unsigned long long size;
+};
+
+// open addressing table (with linear probing) of the pairs of a server;
+// the number of slots is a power of 2, at least twice the number of pairs
+typedef struct snapshot_table snapshot_table;
+struct snapshot_table {
+	unsigned int no_entries;
+	unsigned int no_slots;
+	unsigned long long slots_offset;
+};
+
+// server of a snapshot
+typedef struct snapshot_server snapshot_server;
+struct snapshot_server {
+	unsigned int server_id;
+	// number of labels of the server
+	unsigned int weight;
+	// 1 if the server passed objects on because it was full
+	// (bounded loads)
+	unsigned int overflowed;
+	unsigned int reserved;
+	snapshot_table table;
+};
+
+// slot of a server's table; the key is followed by a null byte and by
+// the value, which is followed by a null byte too
+typedef struct snapshot_slot snapshot_slot;
+struct snapshot_slot {
+	unsigned int hash;
+	unsigned int key_length;
+	// offset of the key, or 0 if the slot is empty
+	unsigned long long key_offset;
+};
+
+// pair written in a snapshot
+typedef struct snapshot_entry snapshot_entry;
+struct snapshot_entry {
+	char* key;
+	char* value;
+};
+
+// function which returns the key of a used slot of a mapped snapshot
+char* snapshot_slot_key(const char* base, const snapshot_slot* slot);
+
+// function which returns the value of a used slot of a mapped snapshot
+char* snapshot_slot_value(const char* base, const snapshot_slot* slot);
+
+// snapshot_find() - Finds a key in a table of a mapped snapshot.
+// @arg1: Start of the mapped snapshot.
+// @arg2: Table of the server which should store the key.
+// @arg3: Key, with its length and its hash.
+//
+// Only the slots which are probed (and their keys) are read, so the
+// pages of the snapshot are faulted in as the keys are looked up.
+//
+// Return: The slot of the key or NULL if the key is not in the table.
+const snapshot_slot* snapshot_find(const char* base,
+								   const snapshot_table* table,
+								   key_descriptor* key);
+
+// snapshot_write_table() - Writes the pairs of a server in a snapshot.
+// @arg1: Snapshot file, positioned at the given offset.
+// @arg2: Offset at which the table is written; this function will
+//        RETURN via this parameter the offset after the table.
+// @arg3: Pairs of the server.
+// @arg4: Number of pairs.
+// @arg5: This function will RETURN the table via this parameter.
+void snapshot_write_table(FILE* file, size_t* offset,
+						  snapshot_entry* entries, unsigned int count,
+						  snapshot_table* table);
+
+// function which writes bytes at the end of a snapshot
+void snapshot_write(FILE* file, size_t* offset, const void* data,
+					size_t size);
+
+#endif  // SNAPSHOT_H_
@@ -0,0 +1,184 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the hierarchical timing wheel of a server
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "timing_wheel.h"
+#include "utils.h"
+
+// function which returns the time of the monotonic clock, in milliseconds
+unsigned long long monotonic_ms() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// function which initialises and returns an empty timing wheel
+timing_wheel* create_timing_wheel() {
+	timing_wheel* wheel = calloc(1, sizeof(timing_wheel));
+	DIE(wheel == NULL, "Error");
+
+	return wheel;
+}
+
+// function which returns a free timer, allocating a chunk of timers
+// if there isn't any
+wheel_timer* wheel_alloc_timer(timing_wheel* wheel) {
+	if (wheel->free_timers == NULL) {
+		wheel_chunk* chunk = malloc(sizeof(wheel_chunk));
+		DIE(chunk == NULL, "Error");
+		chunk->next = wheel->chunks;
+		wheel->chunks = chunk;
+
+		for (int i = 0; i < TIMING_WHEEL_CHUNK; i++) {
+			chunk->timers[i].next = wheel->free_timers;
+			wheel->free_timers = &chunk->timers[i];
+		}
+	}
+
+	wheel_timer* timer = wheel->free_timers;
+	wheel->free_timers = timer->next;
+	return timer;
+}
+
+// function which gives a timer back to the free timers
+void wheel_free_timer(timing_wheel* wheel, wheel_timer* timer) {
+	timer->next = wheel->free_timers;
+	wheel->free_timers = timer;
+}
+
+// function which puts a timer in the slot of the lowest level which tells
+// its tick apart from the current tick
+void wheel_place(timing_wheel* wheel, wheel_timer* timer) {
+	unsigned long long tick = timer->deadline;
+	if (tick < wheel->current)
+		tick = wheel->current;
+
+	// a timer after the levels waits in the last slot of the top level
+	int top_shift = TIMING_WHEEL_BITS * (TIMING_WHEEL_LEVELS - 1);
+	unsigned long long last = ((wheel->current >> top_shift) +
+							   TIMING_WHEEL_SLOTS - 1) << top_shift;
+	if (tick > last)
+		tick = last;
+
+	int level = 0;
+	unsigned long long difference = tick ^ wheel->current;
+	if (difference != 0)
+		level = (63 - __builtin_clzll(difference)) / TIMING_WHEEL_BITS;
+	if (level >= TIMING_WHEEL_LEVELS)
+		level = TIMING_WHEEL_LEVELS - 1;
+
+	int slot = (tick >> (TIMING_WHEEL_BITS * level)) & (TIMING_WHEEL_SLOTS - 1);
+	timer->next = wheel->slots[level][slot];
+	wheel->slots[level][slot] = timer;
+	wheel->used[level] |= 1ULL << slot;
+}
+
+// function which adds a timer to the wheel
+void timing_wheel_add(timing_wheel* wheel, unsigned int hash,
+					  unsigned long long deadline)
+{
+	wheel_timer* timer = wheel_alloc_timer(wheel);
+	timer->hash = hash;
+	timer->deadline = deadline;
+	wheel_place(wheel, timer);
+	wheel->size++;
+}
+
+// function which takes the timers out of a slot
+wheel_timer* wheel_take_slot(timing_wheel* wheel, int level, int slot) {
+	wheel_timer* timers = wheel->slots[level][slot];
+	wheel->slots[level][slot] = NULL;
+	wheel->used[level] &= ~(1ULL << slot);
+	return timers;
+}
+
+// function which returns the first tick starting from the given one at
+// which the wheel has something to do: a slot of level 0 with timers or
+// the start of a slot of a higher level with timers; the empty slots are
+// skipped using the bitmaps of the levels
+unsigned long long wheel_next_tick(timing_wheel* wheel,
+								   unsigned long long tick)
+{
+	for (int level = 0; level < TIMING_WHEEL_LEVELS; level++) {
+		// the tick is the start of a slot of this level
+		int shift = TIMING_WHEEL_BITS * level;
+		int slot = (tick >> shift) & (TIMING_WHEEL_SLOTS - 1);
+		unsigned long long ahead = wheel->used[level] >> slot << slot;
+		if (ahead != 0) {
+			unsigned long long block = tick >> shift >> TIMING_WHEEL_BITS;
+			return ((block << TIMING_WHEEL_BITS) +
+					__builtin_ctzll(ahead)) << shift;
+		}
+
+		// the slots of this level are empty until the next slot of the
+		// level above (which may start at this tick)
+		shift += TIMING_WHEEL_BITS;
+		if (slot != 0)
+			tick = ((tick >> shift) + 1) << shift;
+	}
+
+	return tick;
+}
+
+// function which expires the timers whose deadline passed
+void timing_wheel_advance(timing_wheel* wheel, unsigned long long now,
+						  wheel_callback callback, void* arg)
+{
+	while (wheel->size > 0 && wheel->current <= now) {
+		unsigned long long tick = wheel->current;
+
+		// the slots of the higher levels which start at this tick are
+		// placed again, from the highest one
+		int top = 0;
+		while (top + 1 < TIMING_WHEEL_LEVELS &&
+			   (tick & ((1ULL << (TIMING_WHEEL_BITS * (top + 1))) - 1)) == 0)
+			top++;
+		for (int level = top; level > 0; level--) {
+			int slot = (tick >> (TIMING_WHEEL_BITS * level)) &
+					   (TIMING_WHEEL_SLOTS - 1);
+			wheel_timer* timer = wheel_take_slot(wheel, level, slot);
+			while (timer != NULL) {
+				wheel_timer* next = timer->next;
+				wheel_place(wheel, timer);
+				timer = next;
+			}
+		}
+
+		// the timers of the tick expire, except the ones which waited in
+		// the top level because they were too far
+		wheel_timer* timer = wheel_take_slot(wheel, 0,
+											 tick & (TIMING_WHEEL_SLOTS - 1));
+		while (timer != NULL) {
+			wheel_timer* next = timer->next;
+			if (timer->deadline > tick) {
+				wheel_place(wheel, timer);
+			} else {
+				wheel->size--;
+				callback(timer->hash, arg);
+				wheel_free_timer(wheel, timer);
+			}
+			timer = next;
+		}
+
+		// the wheel never skips past the current time, so the timers
+		// added later are placed from it
+		tick = wheel_next_tick(wheel, tick + 1);
+		wheel->current = tick <= now ? tick : now + 1;
+	}
+
+	if (wheel->current <= now)
+		wheel->current = now + 1;
+}
+
+// function which frees the memory of the wheel and of its timers
+void free_timing_wheel(timing_wheel* wheel) {
+	while (wheel->chunks != NULL) {
+		wheel_chunk* next = wheel->chunks->next;
+		free(wheel->chunks);
+		wheel->chunks = next;
+	}
+
+	free(wheel);
+}
@@ -0,0 +1,88 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the hierarchical timing
+// wheel which finds the expired keys of a server
+
+#ifndef TIMING_WHEEL_H_
+#define TIMING_WHEEL_H_
+
+// the wheel has TIMING_WHEEL_LEVELS levels of TIMING_WHEEL_SLOTS slots; a
+// slot of level 0 holds the timers of one tick (a millisecond) and a slot
+// of level l holds the timers of TIMING_WHEEL_SLOTS^l ticks, so the
+// levels cover 2^30 ms (12 days); a later timer waits in the last slot of
+// the top level and is placed again when its slot is reached
+#define TIMING_WHEEL_BITS 6
+#define TIMING_WHEEL_SLOTS (1 << TIMING_WHEEL_BITS)
+#define TIMING_WHEEL_LEVELS 5
+// number of timers allocated at once
+#define TIMING_WHEEL_CHUNK 256
+
+// function which returns the current time, in milliseconds
+typedef unsigned long long (*wheel_clock)(void);
+
+// function called for each timer which expires, with its hash
+typedef void (*wheel_callback)(unsigned int hash, void* arg);
+
+// timer of a key with a deadline
+typedef struct wheel_timer wheel_timer;
+struct wheel_timer {
+	wheel_timer* next;
+	// time (in ms) at which the key expires
+	unsigned long long deadline;
+	unsigned int hash;
+};
+
+// block of timers, allocated when there are no free timers
+typedef struct wheel_chunk wheel_chunk;
+struct wheel_chunk {
+	wheel_chunk* next;
+	wheel_timer timers[TIMING_WHEEL_CHUNK];
+};
+
+// Hierarchical timing wheel. A timer goes in the slot of the lowest level
+// which tells its tick apart from the current tick; when the current tick
+// reaches the start of a slot of a higher level, its timers are placed
+// again in the lower levels, so each timer is moved at most once per
+// level and adding or expiring a timer is O(1) amortized. A bitmap of the
+// used slots of each level lets the wheel skip over the empty ones, so an
+// idle wheel catches up in a few steps.
+typedef struct timing_wheel timing_wheel;
+struct timing_wheel {
+	wheel_timer* slots[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS];
+	// bit i of used[l] is set if slots[l][i] has timers
+	unsigned long long used[TIMING_WHEEL_LEVELS];
+	// first tick which wasn't processed
+	unsigned long long current;
+	// number of timers in the wheel
+	unsigned int size;
+	wheel_timer* free_timers;
+	wheel_chunk* chunks;
+};
+
+// function which returns the time of the monotonic clock, in milliseconds
+unsigned long long monotonic_ms();
+
+// function which initialises and returns an empty timing wheel
+timing_wheel* create_timing_wheel();
+
+// timing_wheel_add() - Adds a timer.
+// @arg1: Timing wheel.
+// @arg2: Hash of the key which expires.
+// @arg3: Time (in ms) at which the key expires; a time which passed
+//        expires at the next advance.
+void timing_wheel_add(timing_wheel* wheel, unsigned int hash,
+					  unsigned long long deadline);
+
+// timing_wheel_advance() - Expires the timers whose deadline passed.
+// @arg1: Timing wheel.
+// @arg2: Current time, in ms.
+// @arg3: Function called with the hash of each expired timer.
+// @arg4: Argument given to the function.
+//
+// The function must not add timers and must not advance the wheel.
+void timing_wheel_advance(timing_wheel* wheel, unsigned long long now,
+						  wheel_callback callback, void* arg);
+
+// function which frees the memory of the wheel and of its timers
+void free_timing_wheel(timing_wheel* wheel);
+
+#endif  // TIMING_WHEEL_H_
@@ -0,0 +1,236 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the compressor of the values stored by the
+// servers
+
+#include <string.h>
+
+#include "value_codec.h"
+#include "utils.h"
+
+// function which reads 4 bytes, whatever their alignment
+unsigned int codec_read32(const unsigned char* bytes) {
+	unsigned int value;
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+// function which returns the position of a sequence in the hashtable
+unsigned int codec_hash(unsigned int sequence) {
+	return (sequence * 2654435761u) >> (32 - CODEC_HASH_BITS);
+}
+
+// function which writes the part of a length which didn't fit in its
+// token, as bytes of 255 and a last smaller byte; it returns 0 if the
+// buffer is full
+int codec_put_length(unsigned char* output, unsigned int* written,
+					 unsigned int capacity, unsigned int length)
+{
+	while (length >= 255) {
+		if (*written >= capacity)
+			return 0;
+		output[(*written)++] = 255;
+		length -= 255;
+	}
+
+	if (*written >= capacity)
+		return 0;
+	output[(*written)++] = length;
+	return 1;
+}
+
+// function which writes a block: its token, its literals and its match
+// (the last block has no match, which is given with a null offset); it
+// returns 0 if the buffer is full
+int codec_put_block(unsigned char* output, unsigned int* written,
+					unsigned int capacity, const unsigned char* literals,
+					unsigned int no_literals, unsigned int offset,
+					unsigned int match)
+{
+	if (*written >= capacity)
+		return 0;
+
+	unsigned int literal_code = no_literals < 15 ? no_literals : 15;
+	match -= offset ? CODEC_MIN_MATCH : 0;
+	unsigned int match_code = match < 15 ? match : 15;
+	output[(*written)++] = literal_code << 4 | match_code;
+
+	if (literal_code == 15 &&
+		!codec_put_length(output, written, capacity, no_literals - 15))
+		return 0;
+	if (no_literals > capacity - *written)
+		return 0;
+	memcpy(output + *written, literals, no_literals);
+	*written += no_literals;
+
+	if (offset == 0)
+		return 1;
+	if (capacity - *written < 2)
+		return 0;
+	output[(*written)++] = offset & 255;
+	output[(*written)++] = offset >> 8;
+
+	return match_code < 15 ||
+		   codec_put_length(output, written, capacity, match - 15);
+}
+
+// function which compresses a buffer: each position is looked up in a
+// hashtable of the last positions of its first CODEC_MIN_MATCH bytes and
+// a match found there is extended as far as it goes
+unsigned int codec_compress(const char* source, unsigned int length,
+							char* destination, unsigned int capacity)
+{
+	const unsigned char* input = (const unsigned char*)source;
+	unsigned char* output = (unsigned char*)destination;
+	// positions + 1, so 0 marks an empty entry
+	unsigned int table[1 << CODEC_HASH_BITS];
+	memset(table, 0, sizeof(table));
+
+	unsigned int position = 0, anchor = 0, written = 0, misses = 0;
+	while (position + CODEC_MIN_MATCH <= length) {
+		unsigned int sequence = codec_read32(input + position);
+		unsigned int hash = codec_hash(sequence);
+		unsigned int candidate = table[hash];
+		table[hash] = position + 1;
+
+		if (candidate == 0 ||
+			position - (candidate - 1) > CODEC_MAX_OFFSET ||
+			codec_read32(input + candidate - 1) != sequence) {
+			// the step grows by one every 2^CODEC_SKIP_TRIGGER misses
+			position += 1 + (misses++ >> CODEC_SKIP_TRIGGER);
+			continue;
+		}
+
+		unsigned int reference = candidate - 1;
+		unsigned int match = CODEC_MIN_MATCH;
+		while (position + match < length &&
+			   input[reference + match] == input[position + match])
+			match++;
+
+		if (!codec_put_block(output, &written, capacity, input + anchor,
+							 position - anchor, position - reference, match))
+			return 0;
+		position += match;
+		anchor = position;
+		misses = 0;
+	}
+
+	if (!codec_put_block(output, &written, capacity, input + anchor,
+						 length - anchor, 0, 0))
+		return 0;
+	return written;
+}
+
+// function which reads the part of a length which didn't fit in its
+// token; it returns 0 if the compressed bytes end before it
+int codec_get_length(const unsigned char* input, unsigned int* read,
+					 unsigned int size, unsigned int* length)
+{
+	unsigned int byte;
+
+	do {
+		if (*read >= size)
+			return 0;
+		byte = input[(*read)++];
+		*length += byte;
+	} while (byte == 255);
+
+	return 1;
+}
+
+// function which decompresses the blocks written by codec_compress,
+// checking that every length and offset stays inside the buffers
+int codec_decompress(const char* source, unsigned int size,
+					 char* destination, unsigned int capacity)
+{
+	const unsigned char* input = (const unsigned char*)source;
+	unsigned int read = 0, written = 0;
+
+	while (read < size) {
+		unsigned int token = input[read++];
+		unsigned int literals = token >> 4;
+		if (literals == 15 &&
+			!codec_get_length(input, &read, size, &literals))
+			return -1;
+		if (literals > size - read || literals > capacity - written)
+			return -1;
+		memcpy(destination + written, input + read, literals);
+		read += literals;
+		written += literals;
+
+		// the last block has no match
+		if (read == size)
+			return written;
+
+		if (size - read < 2)
+			return -1;
+		unsigned int offset = input[read] | input[read + 1] << 8;
+		read += 2;
+		unsigned int match = token & 15;
+		if (match == 15 && !codec_get_length(input, &read, size, &match))
+			return -1;
+		match += CODEC_MIN_MATCH;
+		if (offset == 0 || offset > written || match > capacity - written)
+			return -1;
+
+		// a match may overlap the bytes it writes (a repeated pattern
+		// shorter than the match), so it is copied byte by byte then
+		char* copy = destination + written;
+		if (offset >= match) {
+			memcpy(copy, copy - offset, match);
+		} else {
+			for (unsigned int i = 0; i < match; i++)
+				copy[i] = copy[(int)i - (int)offset];
+		}
+		written += match;
+	}
+
+	return -1;
+}
+
+// function which compresses a value behind its header
+unsigned int codec_pack(const char* value, unsigned int length,
+						char* destination, unsigned int capacity)
+{
+	if (capacity <= sizeof(codec_header))
+		return 0;
+
+	codec_header header;
+	header.length = length;
+	header.size = codec_compress(value, length,
+								 destination + sizeof(codec_header),
+								 capacity - sizeof(codec_header));
+	if (header.size == 0)
+		return 0;
+
+	// a stored value has no alignment, so the header is copied
+	memcpy(destination, &header, sizeof(codec_header));
+	return sizeof(codec_header) + header.size;
+}
+
+// function which returns the length of a packed value
+unsigned int codec_length(const char* packed) {
+	codec_header header;
+	memcpy(&header, packed, sizeof(codec_header));
+	return header.length;
+}
+
+// function which decompresses a packed value as a string
+void codec_unpack(const char* packed, char* destination) {
+	codec_header header;
+	memcpy(&header, packed, sizeof(codec_header));
+
+	int length = codec_decompress(packed + sizeof(codec_header), header.size,
+								  destination, header.length);
+	DIE(length != (int)header.length, "corrupt compressed value");
+	destination[length] = '\0';
+}
+
+// function which returns the number of bytes of a stored value
+size_t codec_stored_size(const char* value, int packed) {
+	if (!packed)
+		return strlen(value) + 1;
+
+	codec_header header;
+	memcpy(&header, value, sizeof(codec_header));
+	return sizeof(codec_header) + header.size;
+}
@@ -0,0 +1,80 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the compressor of the
+// values stored by the servers
+
+#ifndef VALUE_CODEC_H_
+#define VALUE_CODEC_H_
+
+#include <stddef.h>
+
+// the sequences of CODEC_MIN_MATCH bytes are found with a hashtable of
+// 2^CODEC_HASH_BITS positions; a match is at most CODEC_MAX_OFFSET bytes
+// behind, so its offset fits on 2 bytes
+#define CODEC_HASH_BITS 12
+#define CODEC_MIN_MATCH 4
+#define CODEC_MAX_OFFSET 65535
+// the search step grows by one byte every 2^CODEC_SKIP_TRIGGER positions
+// without a match, so incompressible data is passed over quickly
+#define CODEC_SKIP_TRIGGER 6
+
+// header of a compressed value, followed by its compressed bytes
+typedef struct codec_header codec_header;
+struct codec_header {
+	// number of compressed bytes
+	unsigned int size;
+	// length of the value, without the terminating null byte
+	unsigned int length;
+};
+
+// codec_compress() - Compresses a buffer with an LZ77 compressor.
+// @arg1: Bytes which are compressed.
+// @arg2: Number of bytes.
+// @arg3: Buffer in which the compressed bytes are written.
+// @arg4: Size of the buffer.
+//
+// The output is a sequence of blocks: a token (4 bits for the number of
+// literals, 4 bits for the match length minus CODEC_MIN_MATCH, each one
+// followed by bytes of 255 and a last byte when it doesn't fit), the
+// literals, then the 2-byte offset of the match; the last block has no
+// match.
+//
+// Return: Number of compressed bytes, or 0 if they don't fit in the
+//         buffer.
+unsigned int codec_compress(const char* source, unsigned int length,
+							char* destination, unsigned int capacity);
+
+// codec_decompress() - Decompresses the output of codec_compress.
+// @arg1: Compressed bytes.
+// @arg2: Number of compressed bytes.
+// @arg3: Buffer in which the bytes are written.
+// @arg4: Size of the buffer.
+//
+// Return: Number of decompressed bytes, or -1 if the compressed bytes are
+//         corrupt or don't fit in the buffer.
+int codec_decompress(const char* source, unsigned int size,
+					 char* destination, unsigned int capacity);
+
+// codec_pack() - Compresses a value behind a codec_header.
+// @arg1: Value represented as a string.
+// @arg2: Length of the value.
+// @arg3: Buffer in which the header and the compressed bytes are written.
+// @arg4: Size of the buffer.
+//
+// Return: Number of bytes written, or 0 if they don't fit in the buffer.
+unsigned int codec_pack(const char* value, unsigned int length,
+						char* destination, unsigned int capacity);
+
+// function which returns the length of a packed value
+unsigned int codec_length(const char* packed);
+
+// codec_unpack() - Decompresses a packed value as a string.
+// @arg1: Packed value.
+// @arg2: Buffer in which the value and its null byte are written; it
+//        must have room for codec_length(packed) + 1 bytes.
+void codec_unpack(const char* packed, char* destination);
+
+// function which returns the number of bytes of a stored value, which
+// is either packed or a string
+size_t codec_stored_size(const char* value, int packed);
+
+#endif  // VALUE_CODEC_H_
@@ -0,0 +1,199 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing the write-ahead log of the load balancer
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "wal.h"
+#include "command_log.h"
+#include "utils.h"
+
+// function which fills a configuration with the default options
+void default_wal_config(wal_config* config, const char* path) {
+	config->path = path;
+	config->sync = WAL_SYNC_GROUP;
+	config->group_size = DEFAULT_WAL_GROUP_SIZE;
+	config->interval_us = DEFAULT_WAL_INTERVAL_US;
+}
+
+// function which writes and syncs the appended records; it is called
+// with the lock held, which is released while the file is synced, so the
+// other threads keep appending records meanwhile
+void wal_sync_locked(write_ahead_log* log) {
+	unsigned long long target = log->appended;
+	log->syncing = 1;
+	output_flush(&log->output);
+	DIE(fflush(log->file) != 0, "fflush");
+
+	pthread_mutex_unlock(&log->lock);
+	DIE(fdatasync(fileno(log->file)) != 0, "fdatasync");
+	pthread_mutex_lock(&log->lock);
+
+	log->synced = target;
+	log->syncing = 0;
+	log->syncs++;
+	pthread_cond_broadcast(&log->synced_cond);
+}
+
+// function which waits until the given record is synced; the thread
+// syncs the records itself if no other thread does it
+void wal_wait_synced(write_ahead_log* log, unsigned long long record) {
+	while (log->synced < record) {
+		if (log->syncing)
+			pthread_cond_wait(&log->synced_cond, &log->lock);
+		else
+			wal_sync_locked(log);
+	}
+}
+
+// function run by the thread which syncs the groups of records, when
+// a group is complete or when the interval passes
+void* wal_group_thread(void* arg) {
+	write_ahead_log* log = arg;
+
+	pthread_mutex_lock(&log->lock);
+	while (!log->stopping) {
+		if (log->appended - log->synced < log->config.group_size) {
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			long long nanoseconds = deadline.tv_nsec +
+									log->config.interval_us * 1000LL;
+			deadline.tv_sec += nanoseconds / 1000000000;
+			deadline.tv_nsec = nanoseconds % 1000000000;
+			pthread_cond_timedwait(&log->group_cond, &log->lock, &deadline);
+		}
+
+		wal_wait_synced(log, log->appended);
+	}
+	pthread_mutex_unlock(&log->lock);
+
+	return NULL;
+}
+
+// function which returns the size of the complete records of an existing
+// log, or 0 if the file doesn't exist (or is empty)
+size_t wal_valid_size(const char* path) {
+	if (access(path, F_OK) != 0)
+		return 0;
+
+	command_file input;
+	open_command_file(&input, path);
+	size_t size = command_log_valid_size(input.data, input.size);
+	DIE(input.size > 0 && size == 0, "not a command log");
+	close_command_file(&input);
+
+	return size;
+}
+
+// function which opens a write-ahead log
+write_ahead_log* create_wal(wal_config* config) {
+	write_ahead_log* log = malloc(sizeof(write_ahead_log));
+	DIE(log == NULL, "Error");
+	log->config = *config;
+	if (log->config.group_size == 0)
+		log->config.group_size = 1;
+
+	// an incomplete record at the end of the file (the log was being
+	// written when the program stopped) is cut off
+	size_t size = wal_valid_size(config->path);
+	if (size > 0)
+		DIE(truncate(config->path, size) != 0, "truncate");
+
+	// the records are buffered by the output writer only, so what it
+	// writes reaches the kernel at once and a checkpoint which truncates
+	// the file leaves nothing behind in a stdio buffer
+	log->file = fopen(config->path, "ab");
+	DIE(log->file == NULL, "fopen");
+	DIE(setvbuf(log->file, NULL, _IONBF, 0) != 0, "setvbuf");
+	init_output_writer(&log->output, log->file);
+	if (size == 0)
+		write_log_header(&log->output);
+
+	log->appended = 0;
+	log->synced = 0;
+	log->syncing = 0;
+	log->stopping = 0;
+	log->syncs = 0;
+	pthread_mutex_init(&log->lock, NULL);
+	pthread_cond_init(&log->synced_cond, NULL);
+	pthread_cond_init(&log->group_cond, NULL);
+
+	if (log->config.sync == WAL_SYNC_GROUP)
+		DIE(pthread_create(&log->group_thread, NULL, wal_group_thread, log),
+			"pthread_create");
+
+	return log;
+}
+
+// function which appends a command to the log
+unsigned long long wal_append(write_ahead_log* log, command* request) {
+	pthread_mutex_lock(&log->lock);
+	write_log_command(&log->output, request, 1);
+	unsigned long long record = ++log->appended;
+
+	// without syncs, the record is given to the kernel before the
+	// operation is acknowledged, so only a crash of the system loses it
+	if (log->config.sync == WAL_SYNC_NONE)
+		output_flush(&log->output);
+
+	if (log->config.sync == WAL_SYNC_GROUP &&
+		record - log->synced == log->config.group_size)
+		pthread_cond_signal(&log->group_cond);
+	pthread_mutex_unlock(&log->lock);
+
+	return record;
+}
+
+// function which waits until a record can be acknowledged
+void wal_commit(write_ahead_log* log, unsigned long long record) {
+	if (log->config.sync != WAL_SYNC_ALWAYS)
+		return;
+
+	pthread_mutex_lock(&log->lock);
+	wal_wait_synced(log, record);
+	pthread_mutex_unlock(&log->lock);
+}
+
+// function which syncs all the appended records
+void wal_sync(write_ahead_log* log) {
+	pthread_mutex_lock(&log->lock);
+	wal_wait_synced(log, log->appended);
+	pthread_mutex_unlock(&log->lock);
+}
+
+// function which empties the log, leaving only its header
+void wal_reset(write_ahead_log* log) {
+	pthread_mutex_lock(&log->lock);
+	while (log->syncing)
+		pthread_cond_wait(&log->synced_cond, &log->lock);
+
+	// the buffered records are in the snapshot too, so they are dropped
+	// (the file itself isn't buffered)
+	log->output.size = 0;
+	DIE(fflush(log->file) != 0, "fflush");
+	DIE(ftruncate(fileno(log->file), 0) != 0, "ftruncate");
+	write_log_header(&log->output);
+	wal_sync_locked(log);
+	pthread_mutex_unlock(&log->lock);
+}
+
+// function which syncs the appended records and closes the log
+void free_wal(write_ahead_log* log) {
+	if (log->config.sync == WAL_SYNC_GROUP) {
+		pthread_mutex_lock(&log->lock);
+		log->stopping = 1;
+		pthread_cond_signal(&log->group_cond);
+		pthread_mutex_unlock(&log->lock);
+		pthread_join(log->group_thread, NULL);
+	}
+
+	wal_sync(log);
+	free_output_writer(&log->output);
+	DIE(fclose(log->file) != 0, "fclose");
+	pthread_cond_destroy(&log->synced_cond);
+	pthread_cond_destroy(&log->group_cond);
+	pthread_mutex_destroy(&log->lock);
+	free(log);
+}
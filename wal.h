@@ -0,0 +1,112 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// header linked to the source file containing the write-ahead log of
+// the load balancer, whose records are synced to the disk in groups
+
+#ifndef WAL_H_
+#define WAL_H_
+
+#include <pthread.h>
+
+#include "command_io.h"
+
+// default options of the group commit: the records are synced when
+// DEFAULT_WAL_GROUP_SIZE of them are waiting, or after
+// DEFAULT_WAL_INTERVAL_US microseconds
+#define DEFAULT_WAL_GROUP_SIZE 1024
+#define DEFAULT_WAL_INTERVAL_US 10000
+
+// moments when the records of the log are synced to the disk
+typedef enum wal_sync_policy {
+	// each record is written in the file (handed to the kernel) before
+	// its operation returns, but never synced, so the system decides when
+	// it reaches the disk; a crash of the process loses nothing
+	WAL_SYNC_NONE,
+	// the records are synced in groups, by a thread which syncs them when
+	// group_size records are waiting or every interval_us microseconds;
+	// an operation returns before it is synced, so a crash loses at most
+	// the records of the last group
+	WAL_SYNC_GROUP,
+	// an operation returns after its record is synced; the operations of
+	// the threads which wait for a sync are covered by the next one
+	WAL_SYNC_ALWAYS
+} wal_sync_policy;
+
+// options of the write-ahead log
+typedef struct wal_config wal_config;
+struct wal_config {
+	// path of the log, or NULL if the load balancer has no log
+	const char* path;
+	wal_sync_policy sync;
+	unsigned int group_size;
+	unsigned int interval_us;
+};
+
+// write-ahead log, written as a command log (command_log.h) whose records
+// carry the hashes of their keys, so the recovery doesn't hash them
+typedef struct write_ahead_log write_ahead_log;
+struct write_ahead_log {
+	wal_config config;
+	FILE* file;
+	// buffer of the records which weren't written in the file yet
+	output_writer output;
+	// number of records appended and number of records synced
+	unsigned long long appended;
+	unsigned long long synced;
+	// 1 while a thread syncs the file (without holding the lock)
+	int syncing;
+	pthread_mutex_t lock;
+	// signalled when records are synced
+	pthread_cond_t synced_cond;
+	// signalled when a group is complete (or the log is freed), for the
+	// thread which syncs the groups
+	pthread_cond_t group_cond;
+	pthread_t group_thread;
+	int stopping;
+	// number of times the file was synced
+	unsigned long long syncs;
+};
+
+// function which fills a configuration with the default options
+// (a log with group commit at the given path)
+void default_wal_config(wal_config* config, const char* path);
+
+// create_wal() - Opens a write-ahead log.
+// @arg1: Options of the log.
+//
+// The records are appended after the complete records of the file, which
+// is created (with the header of a command log) if it doesn't exist.
+//
+// Return: The opened log.
+write_ahead_log* create_wal(wal_config* config);
+
+// wal_append() - Appends a command to the log.
+// @arg1: Write-ahead log.
+// @arg2: Command which is appended (store, add_server or remove_server).
+//
+// Return: The number of the record, given to wal_commit.
+unsigned long long wal_append(write_ahead_log* log, command* request);
+
+// wal_commit() - Waits until a record can be acknowledged.
+// @arg1: Write-ahead log.
+// @arg2: Number of the record, returned by wal_append.
+//
+// With WAL_SYNC_ALWAYS, it returns once the record is synced: the first
+// waiting thread syncs all the appended records while the others wait
+// for it, so one sync covers the records of all of them. With the other
+// policies, it returns at once.
+void wal_commit(write_ahead_log* log, unsigned long long record);
+
+// function which syncs all the appended records
+void wal_sync(write_ahead_log* log);
+
+// wal_reset() - Empties the log.
+// @arg1: Write-ahead log.
+//
+// It is called after a snapshot was written, when the snapshot contains
+// the effects of all the records; the operations must not run meanwhile.
+void wal_reset(write_ahead_log* log);
+
+// function which syncs the appended records and closes the log
+void free_wal(write_ahead_log* log);
+
+#endif  // WAL_H_
@@ -0,0 +1,487 @@
+// Copyright 2021 @Profeanu Ioana, 313CA
+// source file containing a workload generator which measures the
+// throughput and the latency of the load balancer's operations
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "load_balancer.h"
+#include "utils.h"
+
+// types of measured operations
+#define WORKLOAD_STORE 0
+#define WORKLOAD_RETRIEVE 1
+#define WORKLOAD_ADD_SERVER 2
+#define WORKLOAD_REMOVE_SERVER 3
+#define WORKLOAD_OPERATIONS 4
+
+// options of the workload
+typedef struct workload_options workload_options;
+struct workload_options {
+	unsigned int keys;
+	unsigned int operations;
+	// the key and value sizes are chosen uniformly from [min, max]
+	unsigned int min_key_size;
+	unsigned int max_key_size;
+	unsigned int min_value_size;
+	unsigned int max_value_size;
+	// percentage of the operations which are retrieves
+	unsigned int read_percentage;
+	// skew of the key popularity; 0 means uniform popularity
+	double zipf_theta;
+	// a server is added and the oldest one is removed every
+	// churn_interval operations; 0 means no churn
+	unsigned int churn_interval;
+	unsigned int servers;
+	unsigned int vnodes;
+	server_backend backend;
+	routing_strategy routing;
+	// bounded loads are used if load_epsilon is not negative
+	double load_epsilon;
+	// keys moved per migration step; 0 moves them during the change
+	unsigned int migration_step;
+	unsigned long long seed;
+};
+
+// latencies and counters of one type of operation
+typedef struct workload_results workload_results;
+struct workload_results {
+	// latency of each operation, in nanoseconds
+	double* latencies;
+	unsigned int count;
+	unsigned int capacity;
+	// keys moved by the topology changes
+	unsigned long keys_moved;
+	unsigned int max_keys_moved;
+};
+
+// generator of keys following a Zipfian distribution (Gray et al.,
+// "Quickly generating billion-record synthetic databases")
+typedef struct zipf_generator zipf_generator;
+struct zipf_generator {
+	unsigned int items;
+	double theta;
+	double alpha;
+	double zetan;
+	double eta;
+};
+
+// names of the routing strategies, in the order of routing_strategy
+char* routing_names[] = {"ring", "maglev", "jump", "rendezvous"};
+
+// state of the pseudo-random generator (xorshift64*)
+unsigned long long workload_state;
+
+// the retrieved values are added here, so the compiler can't optimise
+// the retrieves away
+volatile unsigned long workload_sink;
+
+// function which returns a pseudo-random 64 bit number
+unsigned long long workload_random() {
+	workload_state ^= workload_state >> 12;
+	workload_state ^= workload_state << 25;
+	workload_state ^= workload_state >> 27;
+	return workload_state * 2685821657736338717ULL;
+}
+
+// function which returns a pseudo-random number from [min, max]
+unsigned int workload_uniform(unsigned int min, unsigned int max) {
+	return min + workload_random() % (max - min + 1);
+}
+
+// function which returns a pseudo-random number from [0, 1)
+double workload_real() {
+	return (workload_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// function which returns the current time in nanoseconds
+double workload_now() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+// function which initialises the Zipfian generator for the given number
+// of items; the first items are the most popular ones
+void init_zipf_generator(zipf_generator* zipf, unsigned int items,
+						 double theta) {
+	zipf->items = items;
+	zipf->theta = theta;
+	zipf->alpha = 1 / (1 - theta);
+
+	zipf->zetan = 0;
+	for (unsigned int i = 1; i <= items; i++)
+		zipf->zetan += 1 / pow(i, theta);
+	double zeta2 = 1 + 1 / pow(2, theta);
+
+	zipf->eta = (1 - pow(2.0 / items, 1 - theta)) / (1 - zeta2 / zipf->zetan);
+}
+
+// function which returns the index of the next Zipfian key
+unsigned int zipf_next(zipf_generator* zipf) {
+	double u = workload_real();
+	double uz = u * zipf->zetan;
+
+	if (uz < 1)
+		return 0;
+	if (uz < 1 + pow(0.5, zipf->theta))
+		return 1;
+
+	unsigned int item = zipf->items * pow(zipf->eta * u - zipf->eta + 1,
+										  zipf->alpha);
+	return item < zipf->items ? item : zipf->items - 1;
+}
+
+// function which adds a latency to the results of an operation type
+void record_latency(workload_results* results, double latency) {
+	if (results->count == results->capacity) {
+		results->capacity = results->capacity ? 2 * results->capacity : 1024;
+		results->latencies = realloc(results->latencies,
+									 results->capacity * sizeof(double));
+		DIE(results->latencies == NULL, "Error");
+	}
+	results->latencies[results->count++] = latency;
+}
+
+// comparison function used for sorting the latencies
+int compare_latencies(const void* a, const void* b) {
+	double latency_a = *(double*)a, latency_b = *(double*)b;
+
+	return (latency_a > latency_b) - (latency_a < latency_b);
+}
+
+// function which returns a percentile of sorted latencies
+double latency_percentile(workload_results* results, double percentile) {
+	if (results->count == 0)
+		return 0;
+
+	unsigned int index = percentile * results->count;
+	if (index >= results->count)
+		index = results->count - 1;
+
+	return results->latencies[index];
+}
+
+// function which generates the keys; each key starts with its index,
+// so all the keys are different, and it is padded to its size
+char** generate_keys(workload_options* options) {
+	char** keys = malloc(options->keys * sizeof(char*));
+	DIE(keys == NULL, "Error");
+
+	for (unsigned int i = 0; i < options->keys; i++) {
+		unsigned int size = workload_uniform(options->min_key_size,
+											 options->max_key_size);
+		char prefix[32];
+		int length = snprintf(prefix, sizeof(prefix), "%u_", i);
+		if ((unsigned int)length > size)
+			size = length;
+
+		keys[i] = malloc(size + 1);
+		DIE(keys[i] == NULL, "Error");
+		memcpy(keys[i], prefix, length);
+		memset(keys[i] + length, 'k', size - length);
+		keys[i][size] = 0;
+	}
+
+	return keys;
+}
+
+// function which stores a key with a value of random size; the values
+// are prefixes of a buffer filled with the same character
+void store_random_value(load_balancer* main_server, char* key, char* values,
+						workload_options* options) {
+	unsigned int size = workload_uniform(options->min_value_size,
+										 options->max_value_size);
+	int server_id = 0;
+
+	values[size] = 0;
+	loader_store(main_server, key, values, &server_id);
+	values[size] = 'v';
+}
+
+// function which adds a server, recording the time of the change and the
+// number of keys it moved
+void churn_add_server(load_balancer* main_server, workload_options* options,
+					  unsigned int first_server, workload_results* results) {
+	unsigned int new_server = first_server + options->servers;
+
+	double start = workload_now();
+	loader_add_server_weighted(main_server, new_server, options->vnodes);
+	record_latency(&results[WORKLOAD_ADD_SERVER], workload_now() - start);
+
+	// the added server only has the keys moved on it; with incremental
+	// migration, they are the keys which the migration will move
+	unsigned int moved = loader_get_server(main_server, new_server)->size;
+	if (options->migration_step) {
+		migration_stats stats;
+		loader_migration_stats(main_server, &stats);
+		moved = stats.active ? stats.total_keys : moved;
+	}
+	results[WORKLOAD_ADD_SERVER].keys_moved += moved;
+	if (moved > results[WORKLOAD_ADD_SERVER].max_keys_moved)
+		results[WORKLOAD_ADD_SERVER].max_keys_moved = moved;
+}
+
+// function which removes the oldest server, recording the time of the
+// change and the number of keys it moved
+void churn_remove_server(load_balancer* main_server,
+						 unsigned int* first_server,
+						 workload_results* results) {
+	// all the keys of the removed server are moved
+	unsigned int moved = loader_get_server(main_server, *first_server)->size;
+	double start = workload_now();
+	loader_remove_server(main_server, *first_server);
+	record_latency(&results[WORKLOAD_REMOVE_SERVER], workload_now() - start);
+	results[WORKLOAD_REMOVE_SERVER].keys_moved += moved;
+	if (moved > results[WORKLOAD_REMOVE_SERVER].max_keys_moved)
+		results[WORKLOAD_REMOVE_SERVER].max_keys_moved = moved;
+
+	(*first_server)++;
+}
+
+// function which prints the pauses of the migration steps
+void print_migration(load_balancer* main_server) {
+	migration_stats stats;
+	loader_migration_stats(main_server, &stats);
+
+	printf("migration steps %llu, mean pause %.0f ns, max pause %.0f ns, "
+		   "retrieves from the old servers %llu\n", stats.steps,
+		   stats.steps ? stats.total_pause_ns / stats.steps : 0,
+		   stats.max_pause_ns, stats.fallbacks);
+}
+
+// function which prints the results of the workload
+void print_results(workload_options* options, workload_results* results,
+				   double total_time, double preload_time) {
+	char* names[] = {"store", "retrieve", "add_server", "remove_server"};
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	printf("keys %u, operations %u, key size %u-%u, value size %u-%u, "
+		   "reads %u%%, zipf %.2f, churn every %u, servers %u x %u labels, "
+		   "%s backend, %s routing\n", options->keys, options->operations,
+		   options->min_key_size, options->max_key_size,
+		   options->min_value_size, options->max_value_size,
+		   options->read_percentage, options->zipf_theta,
+		   options->churn_interval, options->servers, options->vnodes,
+		   options->backend == SERVER_BACKEND_FLAT ? "flat" : "chained",
+		   routing_names[options->routing]);
+	if (options->load_epsilon >= 0)
+		printf("bounded loads, epsilon %.2f\n", options->load_epsilon);
+	if (options->migration_step)
+		printf("incremental migration, %u keys per step\n",
+			   options->migration_step);
+	printf("preload %.3f s, run %.3f s, %.0f ops/s, peak RSS %ld KB\n",
+		   preload_time / 1e9, total_time / 1e9,
+		   options->operations / (total_time / 1e9), usage.ru_maxrss);
+
+	printf("%14s %10s %12s %12s %12s %12s %12s\n", "operation", "count",
+		   "p50 ns", "p99 ns", "p999 ns", "moved/op", "max moved");
+	for (int i = 0; i < WORKLOAD_OPERATIONS; i++) {
+		workload_results* current = &results[i];
+		if (current->count == 0)
+			continue;
+
+		qsort(current->latencies, current->count, sizeof(double),
+			  compare_latencies);
+		printf("%14s %10u %12.0f %12.0f %12.0f", names[i], current->count,
+			   latency_percentile(current, 0.5),
+			   latency_percentile(current, 0.99),
+			   latency_percentile(current, 0.999));
+		if (i >= WORKLOAD_ADD_SERVER)
+			printf(" %12.1f %12u", (double)current->keys_moved /
+				   current->count, current->max_keys_moved);
+		printf("\n");
+	}
+}
+
+// function which runs the workload
+void run_workload(workload_options* options) {
+	workload_results results[WORKLOAD_OPERATIONS];
+	memset(results, 0, sizeof(results));
+	workload_state = options->seed;
+
+	zipf_generator zipf;
+	if (options->zipf_theta > 0)
+		init_zipf_generator(&zipf, options->keys, options->zipf_theta);
+
+	char** keys = generate_keys(options);
+	char* values = malloc(options->max_value_size + 1);
+	DIE(values == NULL, "Error");
+	memset(values, 'v', options->max_value_size + 1);
+
+	load_balancer_config config;
+	default_load_balancer_config(&config);
+	config.backend = options->backend;
+	config.routing = options->routing;
+	if (options->load_epsilon >= 0) {
+		config.bounded_loads = 1;
+		config.load_epsilon = options->load_epsilon;
+	}
+	config.migration_step = options->migration_step;
+	load_balancer* main_server = init_load_balancer_config(&config);
+	for (unsigned int i = 0; i < options->servers; i++)
+		loader_add_server_weighted(main_server, i, options->vnodes);
+
+	// every key is stored once before the measured operations
+	double start = workload_now();
+	for (unsigned int i = 0; i < options->keys; i++)
+		store_random_value(main_server, keys[i], values, options);
+	double preload_time = workload_now() - start;
+
+	unsigned int first_server = 0;
+	double total_start = workload_now();
+	for (unsigned int i = 0; i < options->operations; i++) {
+		// with incremental migration, the removal is half an interval
+		// after the addition, so the addition's keys can move in between
+		unsigned int churn = options->churn_interval;
+		unsigned int removal = options->migration_step ? churn / 2 : 0;
+		if (churn && i > 0 && i % churn == 0)
+			churn_add_server(main_server, options, first_server, results);
+		if (churn && i > removal && i % churn == removal)
+			churn_remove_server(main_server, &first_server, results);
+
+		unsigned int index = options->zipf_theta > 0 ? zipf_next(&zipf) :
+							 workload_uniform(0, options->keys - 1);
+		int server_id = 0;
+
+		if (workload_uniform(0, 99) < options->read_percentage) {
+			start = workload_now();
+			workload_sink += (unsigned long)loader_retrieve(main_server,
+															keys[index],
+															&server_id);
+			record_latency(&results[WORKLOAD_RETRIEVE],
+						   workload_now() - start);
+		} else {
+			start = workload_now();
+			store_random_value(main_server, keys[index], values, options);
+			record_latency(&results[WORKLOAD_STORE], workload_now() - start);
+		}
+	}
+	double total_time = workload_now() - total_start;
+
+	print_results(options, results, total_time, preload_time);
+	if (options->migration_step)
+		print_migration(main_server);
+
+	free_load_balancer(main_server);
+	for (unsigned int i = 0; i < options->keys; i++)
+		free(keys[i]);
+	free(keys);
+	free(values);
+	for (int i = 0; i < WORKLOAD_OPERATIONS; i++)
+		free(results[i].latencies);
+}
+
+// function which parses a size given as "size" or as "min-max"
+void parse_size_range(char* text, unsigned int* min, unsigned int* max) {
+	char* separator = strchr(text, '-');
+
+	*min = atoi(text);
+	*max = separator ? (unsigned int)atoi(separator + 1) : *min;
+	DIE(*min == 0 || *max < *min, "invalid size range");
+}
+
+// function which returns the routing strategy with the given name
+routing_strategy parse_routing(char* name) {
+	for (int i = 0; i < (int)(sizeof(routing_names) / sizeof(char*)); i++) {
+		if (!strcmp(name, routing_names[i]))
+			return (routing_strategy)i;
+	}
+
+	DIE(1, "unknown routing strategy");
+	return ROUTING_RING;
+}
+
+// function which prints the usage of the program
+void print_usage(char* program) {
+	printf("Usage:%s [--keys N] [--operations N] [--key-size MIN-MAX] "
+		   "[--value-size MIN-MAX] [--reads PERCENT] [--zipf THETA] "
+		   "[--churn N] [--servers N] [--vnodes N] [--flat] "
+		   "[--routing ring|maglev|jump|rendezvous] [--bounded EPSILON] "
+		   "[--migration-step N] [--seed N]\n",
+		   program);
+}
+
+// in main, parse the options and run the workload
+int main(int argc, char* argv[]) {
+	workload_options options;
+	options.keys = 100000;
+	options.operations = 1000000;
+	options.min_key_size = 16;
+	options.max_key_size = 16;
+	options.min_value_size = 64;
+	options.max_value_size = 64;
+	options.read_percentage = 90;
+	options.zipf_theta = 0;
+	options.churn_interval = 0;
+	options.servers = 10;
+	options.vnodes = DEFAULT_VNODES;
+	options.backend = SERVER_BACKEND_CHAINED;
+	options.routing = ROUTING_RING;
+	options.load_epsilon = -1;
+	options.migration_step = 0;
+	options.seed = 42;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--flat")) {
+			options.backend = SERVER_BACKEND_FLAT;
+			continue;
+		}
+
+		// the other options have a value
+		if (i + 1 == argc) {
+			print_usage(argv[0]);
+			return -1;
+		}
+		char* value = argv[++i];
+
+		if (!strcmp(argv[i - 1], "--keys")) {
+			options.keys = atoi(value);
+		} else if (!strcmp(argv[i - 1], "--operations")) {
+			options.operations = atoi(value);
+		} else if (!strcmp(argv[i - 1], "--key-size")) {
+			parse_size_range(value, &options.min_key_size,
+							 &options.max_key_size);
+		} else if (!strcmp(argv[i - 1], "--value-size")) {
+			parse_size_range(value, &options.min_value_size,
+							 &options.max_value_size);
+		} else if (!strcmp(argv[i - 1], "--reads")) {
+			options.read_percentage = atoi(value);
+		} else if (!strcmp(argv[i - 1], "--zipf")) {
+			options.zipf_theta = atof(value);
+		} else if (!strcmp(argv[i - 1], "--churn")) {
+			options.churn_interval = atoi(value);
+		} else if (!strcmp(argv[i - 1], "--servers")) {
+			options.servers = atoi(value);
+		} else if (!strcmp(argv[i - 1], "--vnodes")) {
+			options.vnodes = atoi(value);
+		} else if (!strcmp(argv[i - 1], "--routing")) {
+			options.routing = parse_routing(value);
+		} else if (!strcmp(argv[i - 1], "--bounded")) {
+			options.load_epsilon = atof(value);
+		} else if (!strcmp(argv[i - 1], "--migration-step")) {
+			options.migration_step = atoi(value);
+		} else if (!strcmp(argv[i - 1], "--seed")) {
+			options.seed = strtoull(value, NULL, 10);
+		} else {
+			print_usage(argv[0]);
+			return -1;
+		}
+	}
+
+	DIE(options.keys == 0 || options.servers == 0 || options.vnodes == 0,
+		"invalid options");
+	DIE(options.read_percentage > 100, "invalid read percentage");
+	DIE(options.zipf_theta < 0 || options.zipf_theta == 1,
+		"the zipf parameter must be positive and different from 1");
+	DIE(options.seed == 0, "the seed must not be 0");
+
+	run_workload(&options);
+
+	return 0;
+}